@@ -1,2 +1,3 @@
 .\package-builder\x64\Release\package-builder.exe res -c resources.hop
+.\package-builder\x64\Release\package-builder.exe res -c -l core_resources.list -e src\core_package.inl core.hop
 pause
\ No newline at end of file
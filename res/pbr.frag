@@ -13,13 +13,6 @@ layout(set = 2, binding = 0) uniform MaterialInfo
 layout(set = 2, binding = 1) uniform sampler2D albedo;
 layout(set = 2, binding = 2) uniform sampler2D normal_map;
 
-
-vec3 to_linear(vec3 srgb)
-{
-    return (pow(srgb, vec3(1.0f / 2.4f)) * 1.055f) -0.055f;
-    //pow((srgb + 0.055f) / 1.055f, vec3(2.4f));
-}
-
 float saturate(float f) { return clamp(f, 0, 1); }
 
 void main()
@@ -30,7 +23,9 @@ void main()
     pixel_to_light = normalize(pixel_to_light);
 
     vec4 albedo_val = texture(albedo, frag.uv);
-    vec3 normal_val = normalize((to_linear(texture(normal_map, frag.uv).rgb) * 2.0f - 1.0f));
+    // normal maps may only store x and y (BC5), so z is always reconstructed
+    vec2 normal_xy = (texture(normal_map, frag.uv).rg * 2.0f) - 1.0f;
+    vec3 normal_val = vec3(normal_xy, sqrt(saturate(1.0f - dot(normal_xy, normal_xy))));
     vec3 bitangent = normalize(cross(frag.tangent.xyz, frag.normal.xyz));
     mat3 tbn = mat3(frag.tangent.xyz, bitangent, frag.normal.xyz);
     vec3 perturbed_normal = normalize(tbn * normal_val.xyz);
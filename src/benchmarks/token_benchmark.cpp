@@ -0,0 +1,83 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+
+#include "../token_file.h"
+
+using namespace std;
+
+// a scene with a bit of everything the tokeniser sees: keywords, identifiers, strings, ints, floats,
+// vectors, comments, and nested children
+string generateScene(size_t node_count)
+{
+	stringstream scene;
+	scene << "Resource(mesh, \"res://engine/mesh/suzanne.obj\") : suzanne;\n";
+	scene << "Resource(material, \"res://test_mat.hmat\") : material;\n\n";
+	for (size_t i = 0; i < node_count; ++i)
+	{
+		scene << "// node " << i << "\n";
+		scene << "Node() : parent_" << i << "\n{\n";
+		scene << "    MeshNode(data = @suzanne, material = @material, position = [" << (i % 100) * 0.5f << ", 1.0, -" << i % 7 << "], scale = [ 1.0, 1.0, 1.0 ]) : mesh_" << i << ";\n";
+		scene << "    LightNode(colour = [ 1.0, 0.85, 0.75 ], rotation = [0.129, 0.163, 0.810, 0.548], directional = " << i % 2 << ", brightness = 5.0) : light_" << i << ";\n";
+		scene << "    TextNode(text = \"node number " << i << ", with a label long enough to be worth skipping over\", line_width = 64);\n";
+		scene << "};\n";
+	}
+	return scene.str();
+}
+
+int main(const int nargs, const char** vargs)
+{
+	vector<pair<string, string>> documents;
+	for (int i = 1; i < nargs; ++i)
+	{
+		ifstream file(vargs[i], ios::binary);
+		if (!file.is_open())
+		{
+			cout << "failed to read '" << vargs[i] << '\'' << endl;
+			return -1;
+		}
+		documents.push_back({ vargs[i], string(istreambuf_iterator<char>(file), istreambuf_iterator<char>()) });
+	}
+	if (documents.empty())
+		documents.push_back({ "generated scene", generateScene(5000) });
+
+	for (const auto& document : documents)
+	{
+		// the best of several runs, so page faults and frequency scaling don't count
+		double best_tokenise_ms = 0;
+		double best_parse_ms = 0;
+		double best_load_ms = 0;
+		size_t token_count = 0;
+		size_t statement_count = 0;
+		for (int run = 0; run < 10; ++run)
+		{
+			auto start_time = chrono::steady_clock::now();
+			auto tokens = HopEngine::TokenReader::tokenise(document.second);
+			auto tokenised_time = chrono::steady_clock::now();
+			auto syntax_tree = HopEngine::TokenReader::extractSyntaxTree(tokens, document.second);
+			auto parsed_time = chrono::steady_clock::now();
+			double tokenise_ms = chrono::duration<double, milli>(tokenised_time - start_time).count();
+			double parse_ms = chrono::duration<double, milli>(parsed_time - tokenised_time).count();
+
+			// what the engine does with files package-builder has compiled
+			vector<uint8_t> compiled = HopEngine::TokenReader::compile(syntax_tree);
+			start_time = chrono::steady_clock::now();
+			auto loaded_tree = HopEngine::TokenReader::read(HopEngine::DataView(compiled.data(), compiled.size()));
+			double load_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start_time).count();
+			token_count = tokens.size();
+			statement_count = syntax_tree.size();
+			best_tokenise_ms = (run == 0) ? tokenise_ms : min(best_tokenise_ms, tokenise_ms);
+			best_parse_ms = (run == 0) ? parse_ms : min(best_parse_ms, parse_ms);
+			best_load_ms = (run == 0) ? load_ms : min(best_load_ms, load_ms);
+		}
+		double megabytes = document.second.size() / (1024.0 * 1024.0);
+		cout << document.first << ": " << megabytes << " MB, " << token_count << " tokens, tokenised in " << best_tokenise_ms << " ms (" << (megabytes / (best_tokenise_ms / 1000.0)) << " MB/s)" << endl;
+		cout << document.first << ": " << statement_count << " top level statements, parsed in " << best_parse_ms << " ms (" << (megabytes / (best_parse_ms / 1000.0)) << " MB/s)" << endl;
+		cout << document.first << ": compiled, read in " << best_load_ms << " ms, " << ((best_tokenise_ms + best_parse_ms) / best_load_ms) << "x faster than the text" << endl;
+	}
+	return 0;
+}
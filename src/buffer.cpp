@@ -10,7 +10,9 @@
 using namespace HopEngine;
 using namespace std;
 
-Buffer::Buffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties)
+// preferred properties are used if there's a suitable memory type with them, e.g. HOST_CACHED for staging
+// buffers which are decompressed into, since decompressors read back what they have written
+Buffer::Buffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkMemoryPropertyFlags preferred_properties)
 {
     if (size == 0)
     {
@@ -33,7 +35,15 @@ Buffer::Buffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlag
     VkMemoryAllocateInfo allocate_info{ };
     allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
     allocate_info.allocationSize = memory_requirements.size;
-    allocate_info.memoryTypeIndex = Buffer::findMemoryType(memory_requirements.memoryTypeBits, properties);
+    allocate_info.memoryTypeIndex = UINT32_MAX;
+    if (preferred_properties != 0)
+    {
+        allocate_info.memoryTypeIndex = Buffer::findMemoryType(memory_requirements.memoryTypeBits, properties | preferred_properties, false);
+        if (allocate_info.memoryTypeIndex != UINT32_MAX)
+            properties |= preferred_properties;
+    }
+    if (allocate_info.memoryTypeIndex == UINT32_MAX)
+        allocate_info.memoryTypeIndex = Buffer::findMemoryType(memory_requirements.memoryTypeBits, properties);
 
     if (vkAllocateMemory(RenderServer::getDevice(), &allocate_info, nullptr, &memory) != VK_SUCCESS)
         DBG_FAULT("vkAllocateMemory failed");
@@ -49,6 +59,8 @@ Buffer::~Buffer()
 {
     DBG_VERBOSE("destroying buffer " + PTR(this));
     unmapMemory();
+    if (buffer == VK_NULL_HANDLE)
+        return;
 
     RenderServer::waitIdle();
     vkDestroyBuffer(RenderServer::getDevice(), buffer, nullptr);
@@ -72,7 +84,8 @@ void Buffer::unmapMemory()
     mapped = nullptr;
 }
 
-uint32_t Buffer::findMemoryType(uint32_t type_bits, VkMemoryPropertyFlags properties)
+// returns UINT32_MAX if there's no suitable memory type and it isn't required
+uint32_t Buffer::findMemoryType(uint32_t type_bits, VkMemoryPropertyFlags properties, bool required)
 {
     VkPhysicalDeviceMemoryProperties memory_properties;
     vkGetPhysicalDeviceMemoryProperties(RenderServer::getPhysicalDevice(), &memory_properties);
@@ -82,20 +95,44 @@ uint32_t Buffer::findMemoryType(uint32_t type_bits, VkMemoryPropertyFlags proper
         if ((type_bits & (1 << i)) && (memory_properties.memoryTypes[i].propertyFlags & properties) == properties)
             return i;
     }
+    if (!required)
+        return UINT32_MAX;
     DBG_FAULT("failed to find suitable memory type");
     return 0;
 }
 
 void Buffer::copyToBuffer(Ref<Buffer> other)
+{
+    copyToBuffer(other, 0, 0, buffer_size);
+}
+
+void Buffer::copyToBuffer(Ref<Buffer> other, VkDeviceSize src_offset, VkDeviceSize dst_offset, VkDeviceSize size, Ref<CommandBuffer> cmd_buf)
 {
     DBG_VERBOSE("copying from " + PTR(this) + " to buffer " + PTR(other.get()));
-    Ref<CommandBuffer> cmd_buf = new CommandBuffer();
+    bool recording = cmd_buf;
+    if (!recording)
+        cmd_buf = new CommandBuffer();
 
     VkBufferCopy buffer_copy{ };
-    buffer_copy.srcOffset = 0;
-    buffer_copy.dstOffset = 0;
-    buffer_copy.size = buffer_size;
+    buffer_copy.srcOffset = src_offset;
+    buffer_copy.dstOffset = dst_offset;
+    buffer_copy.size = size;
     vkCmdCopyBuffer(cmd_buf->getBuffer(), buffer, other->buffer, 1, &buffer_copy);
 
-    cmd_buf->submit();
+    if (!recording)
+        cmd_buf->submit();
+}
+
+void Buffer::retire()
+{
+    unmapMemory();
+    DBG_VERBOSE("retiring buffer " + PTR(this));
+    RenderServer::retire([retired_buffer = buffer, retired_memory = memory]()
+    {
+        vkDestroyBuffer(RenderServer::getDevice(), retired_buffer, nullptr);
+        vkFreeMemory(RenderServer::getDevice(), retired_memory, nullptr);
+    });
+    buffer = VK_NULL_HANDLE;
+    memory = VK_NULL_HANDLE;
+    buffer_size = 0;
 }
@@ -18,15 +18,20 @@ private:
 public:
 	DELETE_CONSTRUCTORS(Buffer);
 
-	Buffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties);
+	Buffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkMemoryPropertyFlags preferred_properties = 0);
 	~Buffer();
 
 	void* mapMemory();
 	void unmapMemory();
 	inline VkBuffer getBuffer() { return buffer; }
 	inline VkDeviceSize getSize() { return buffer_size; }
-	static uint32_t findMemoryType(uint32_t type_bits, VkMemoryPropertyFlags properties);
+	static uint32_t findMemoryType(uint32_t type_bits, VkMemoryPropertyFlags properties, bool required = true);
 	void copyToBuffer(Ref<Buffer> other);
+	// records into cmd_buf if there is one, otherwise the copy is submitted straight away
+	void copyToBuffer(Ref<Buffer> other, VkDeviceSize src_offset, VkDeviceSize dst_offset, VkDeviceSize size, Ref<CommandBuffer> cmd_buf = nullptr);
+	// hands the buffer over to RenderServer::retire, so it's destroyed once frames which might be using it have
+	// finished, rather than idling the device. it mustn't be used afterwards
+	void retire();
 };
 
 }
@@ -5,8 +5,10 @@
 using namespace HopEngine;
 using namespace std;
 
-CommandBuffer::CommandBuffer()
+CommandBuffer::CommandBuffer(bool _wait_on_submit)
 {
+    wait_on_submit = _wait_on_submit;
+
     VkCommandBufferAllocateInfo allocate_info{ };
     allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
     allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
@@ -27,6 +29,11 @@ CommandBuffer::~CommandBuffer()
 {
     submit();
     DBG_BABBLE("destroying command buffer " + PTR(this));
+    if (!wait_on_submit)
+    {
+        RenderServer::retire([cmd_buf = buffer]() { vkFreeCommandBuffers(RenderServer::getDevice(), RenderServer::getCommandPool(), 1, &cmd_buf); });
+        return;
+    }
     vkFreeCommandBuffers(RenderServer::getDevice(), RenderServer::getCommandPool(), 1, &buffer);
 }
 
@@ -45,5 +52,6 @@ void CommandBuffer::submit()
     submit_info.pCommandBuffers = &buffer;
 
     vkQueueSubmit(RenderServer::getGraphicsQueue(), 1, &submit_info, VK_NULL_HANDLE);
-    vkQueueWaitIdle(RenderServer::getGraphicsQueue());
+    if (wait_on_submit)
+        vkQueueWaitIdle(RenderServer::getGraphicsQueue());
 }
@@ -12,11 +12,14 @@ class CommandBuffer
 private:
 	VkCommandBuffer buffer = VK_NULL_HANDLE;
 	bool already_submitted = false;
+	bool wait_on_submit = true;
 
 public:
 	DELETE_NOT_ALL_CONSTRUCTORS(CommandBuffer);
 
-	CommandBuffer();
+	// a command buffer which doesn't wait on submit lets the GPU carry on with it in the background. it's freed
+	// through RenderServer::retire, so anything recorded into it (e.g. a staging buffer) must be retired as well
+	CommandBuffer(bool wait_on_submit = true);
 	~CommandBuffer();
 
 	inline VkCommandBuffer getBuffer() { return buffer; }
@@ -0,0 +1,214 @@
+#include "compression.h"
+
+#include <cstring>
+
+using namespace HopEngine;
+using namespace std;
+
+// block format (compatible with the LZ4 block format):
+// a series of sequences, each of which is
+//   token: high nibble is the literal length, low nibble is the match length - MIN_MATCH
+//   optional extra literal length bytes (while the nibble is 15; each byte 255 means 'keep reading')
+//   literals
+//   match offset (2 bytes, little endian)
+//   optional extra match length bytes
+// the final sequence contains only literals
+
+constexpr size_t MIN_MATCH = 4;
+constexpr size_t LAST_LITERALS = 5;
+constexpr size_t MATCH_SAFE_DISTANCE = 12;
+constexpr size_t MAX_OFFSET = 65535;
+constexpr uint32_t HASH_BITS = 16;
+
+static inline uint32_t read32(const uint8_t* ptr)
+{
+	uint32_t value;
+	memcpy(&value, ptr, sizeof(uint32_t));
+	return value;
+}
+
+static inline uint32_t hashSequence(uint32_t sequence)
+{
+	return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+vector<uint8_t> Compression::compress(DataView input)
+{
+	const uint8_t* source = input.data();
+	const size_t size = input.size();
+
+	vector<uint8_t> output;
+	output.reserve(compressBound(size));
+
+	size_t anchor = 0;
+	if (size > MATCH_SAFE_DISTANCE)
+	{
+		vector<uint32_t> table(1 << HASH_BITS, 0);
+		const size_t match_limit = size - MATCH_SAFE_DISTANCE;
+		const size_t end_limit = size - LAST_LITERALS;
+		size_t position = 1;
+
+		while (position < match_limit)
+		{
+			uint32_t sequence = read32(source + position);
+			uint32_t hash = hashSequence(sequence);
+			size_t candidate = table[hash];
+			table[hash] = (uint32_t)position;
+
+			if (position - candidate > MAX_OFFSET || read32(source + candidate) != sequence)
+			{
+				// skip faster through data that isn't matching
+				position += 1 + ((position - anchor) >> 6);
+				continue;
+			}
+
+			// extend the match backwards into the pending literals, then forwards as far as possible
+			while (position > anchor && candidate > 0 && source[position - 1] == source[candidate - 1])
+			{
+				--position;
+				--candidate;
+			}
+			size_t match_length = MIN_MATCH;
+			while (position + match_length < end_limit && source[position + match_length] == source[candidate + match_length])
+				++match_length;
+
+			writeSequence(output, source + anchor, position - anchor, position - candidate, match_length);
+			position += match_length;
+			anchor = position;
+
+			// keep the table up to date with the end of the match so that runs chain together
+			if (position - 2 < match_limit)
+				table[hashSequence(read32(source + position - 2))] = (uint32_t)(position - 2);
+		}
+	}
+
+	// final literal-only sequence
+	size_t literal_length = size - anchor;
+	output.push_back((uint8_t)(min(literal_length, (size_t)15) << 4));
+	if (literal_length >= 15)
+		writeLength(output, literal_length - 15);
+	output.insert(output.end(), source + anchor, source + size);
+
+	return output;
+}
+
+bool Compression::decompress(DataView input, uint8_t* output, size_t output_size)
+{
+	return decompressBlock(input, output, output_size, false);
+}
+
+// decompresses only the first output_size bytes of a block, e.g. to read a header without unpacking the rest
+bool Compression::decompressPrefix(DataView input, uint8_t* output, size_t output_size)
+{
+	return decompressBlock(input, output, output_size, true);
+}
+
+bool Compression::decompressBlock(DataView input, uint8_t* output, size_t output_size, bool prefix)
+{
+	const uint8_t* in = input.data();
+	const uint8_t* in_end = in + input.size();
+	uint8_t* out = output;
+	uint8_t* out_end = output + output_size;
+
+	while (in < in_end)
+	{
+		uint8_t token = *in++;
+
+		size_t literal_length = token >> 4;
+		if (literal_length == 15)
+		{
+			uint8_t extra;
+			do
+			{
+				if (in >= in_end)
+					return false;
+				extra = *in++;
+				literal_length += extra;
+			} while (extra == 255);
+		}
+		if (literal_length > (size_t)(in_end - in))
+			return false;
+		if (literal_length > (size_t)(out_end - out))
+		{
+			if (!prefix)
+				return false;
+			memcpy(out, in, out_end - out);
+			return true;
+		}
+		if (literal_length != 0)
+			memcpy(out, in, literal_length);
+		in += literal_length;
+		out += literal_length;
+		if (prefix && out == out_end)
+			return true;
+
+		// the last sequence has no match
+		if (in == in_end)
+			break;
+
+		if (in_end - in < 2)
+			return false;
+		size_t offset = (size_t)in[0] | ((size_t)in[1] << 8);
+		in += 2;
+		if (offset == 0 || offset > (size_t)(out - output))
+			return false;
+
+		size_t match_length = token & 0xF;
+		if (match_length == 15)
+		{
+			uint8_t extra;
+			do
+			{
+				if (in >= in_end)
+					return false;
+				extra = *in++;
+				match_length += extra;
+			} while (extra == 255);
+		}
+		match_length += MIN_MATCH;
+		if (match_length > (size_t)(out_end - out))
+		{
+			if (!prefix)
+				return false;
+			match_length = out_end - out;
+		}
+
+		const uint8_t* match = out - offset;
+		if (offset >= match_length)
+			memcpy(out, match, match_length);
+		else
+		{
+			// overlapping match, repeats the last 'offset' bytes
+			for (size_t i = 0; i < match_length; ++i)
+				out[i] = match[i];
+		}
+		out += match_length;
+		if (prefix && out == out_end)
+			return true;
+	}
+
+	return out == out_end;
+}
+
+void Compression::writeLength(vector<uint8_t>& output, size_t length)
+{
+	while (length >= 255)
+	{
+		output.push_back(255);
+		length -= 255;
+	}
+	output.push_back((uint8_t)length);
+}
+
+void Compression::writeSequence(vector<uint8_t>& output, const uint8_t* literals, size_t literal_length, size_t offset, size_t match_length)
+{
+	size_t match_code = match_length - MIN_MATCH;
+	output.push_back((uint8_t)((min(literal_length, (size_t)15) << 4) | min(match_code, (size_t)15)));
+	if (literal_length >= 15)
+		writeLength(output, literal_length - 15);
+	output.insert(output.end(), literals, literals + literal_length);
+	output.push_back((uint8_t)(offset & 0xFF));
+	output.push_back((uint8_t)((offset >> 8) & 0xFF));
+	if (match_code >= 15)
+		writeLength(output, match_code - 15);
+}
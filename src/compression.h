@@ -0,0 +1,30 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "common.h"
+#include "package.h"
+
+namespace HopEngine
+{
+
+// LZ4-style block codec. each call compresses a single independent block, so any block can be
+// decompressed on its own without touching the others
+class Compression
+{
+public:
+	DELETE_CONSTRUCTORS(Compression);
+
+	static std::vector<uint8_t> compress(DataView input);
+	static bool decompress(DataView input, uint8_t* output, size_t output_size);
+	static bool decompressPrefix(DataView input, uint8_t* output, size_t output_size);
+	static inline size_t compressBound(size_t input_size) { return input_size + (input_size / 255) + 16; }
+
+private:
+	static bool decompressBlock(DataView input, uint8_t* output, size_t output_size, bool prefix);
+	static void writeLength(std::vector<uint8_t>& output, size_t length);
+	static void writeSequence(std::vector<uint8_t>& output, const uint8_t* literals, size_t literal_length, size_t offset, size_t match_length);
+};
+
+}
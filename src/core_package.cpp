@@ -0,0 +1,19 @@
+#include "core_package.h"
+
+using namespace HopEngine;
+using namespace std;
+
+// generated by package-builder (see the Makefile, or compile_resources.bat)
+#if __has_include("core_package.inl")
+#include "core_package.inl"
+#define CORE_PACKAGE_EMBEDDED
+#endif
+
+DataView CorePackage::getData()
+{
+#if defined(CORE_PACKAGE_EMBEDDED)
+	return DataView(embedded_package, sizeof(embedded_package));
+#else
+	return { };
+#endif
+}
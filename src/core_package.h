@@ -0,0 +1,20 @@
+#pragma once
+
+#include "common.h"
+#include "package.h"
+
+namespace HopEngine
+{
+
+// the resources the engine can't start without (the default and post process shaders, and the node view's textures
+// and font), compiled into the executable from core_resources.list so that they don't have to be read from disk
+class CorePackage
+{
+public:
+	DELETE_CONSTRUCTORS(CorePackage);
+
+	// empty if the build didn't generate core_package.inl
+	static DataView getData();
+};
+
+}
@@ -107,6 +107,7 @@ public:
 
 	inline bool isValid() const { return payload != nullptr; }
 	inline operator bool() const { return isValid(); }
+	inline size_t getReferenceCount() const { return (ref_counter == nullptr) ? 0 : *ref_counter; }
 	inline bool operator==(const Ref<T>& other) { return other.payload == payload; }
 	inline T* operator->() { return payload; }
 	inline T* get() { return payload; }
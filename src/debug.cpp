@@ -5,6 +5,7 @@
 #include <ctime>
 #include <iostream>
 #include <filesystem>
+#include <mutex>
 
 using namespace HopEngine;
 using namespace std;
@@ -13,6 +14,8 @@ static Debug* application_debug = nullptr;
 #if defined(DEBUG_LOGFILE)
 static ofstream file_output;
 #endif
+// messages can come from package worker threads as well as the main thread
+static mutex output_mutex;
 
 void Debug::init(DebugLevel crash_level)
 {
@@ -70,6 +73,7 @@ void Debug::write(string description, DebugLevel severity)
 		break;
 	}
 
+	lock_guard lock(output_mutex);
 	auto time_now = std::time(0);
 	tm time;
 #if defined(_WIN32)
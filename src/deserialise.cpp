@@ -4,84 +4,186 @@
 #include "token_file.h"
 #include "package.h"
 #include "sampler.h"
+#include "scene.h"
+#include "object.h"
+#include "mesh.h"
+#include "resource_cache.h"
+
+#include <functional>
+#include <unordered_map>
 
 using namespace HopEngine;
 using namespace std;
 
-int getArgument(string name, string& result, TokenReader::TokenType type, const vector<pair<string, TokenReader::Token>>& args)
+int getArgument(string name, string& result, TokenReader::TokenType type, span<const TokenReader::Argument> args)
 {
 	for (const auto& arg : args)
 	{
-		if (arg.first != name)
+		if (arg.name != name)
 			continue;
-		if (arg.second.type != type)
+		if (arg.value.type != type)
 			return 2;
-		result = arg.second.s_value;
+		result = arg.value.s_value;
 		return 0;
 	}
 	return 1;
 }
 
-bool getAnonArgument(int index, string& result, TokenReader::TokenType type, const vector<pair<string, TokenReader::Token>>& args)
+bool getAnonArgument(int index, string& result, TokenReader::TokenType type, span<const TokenReader::Argument> args)
 {
 	if (index >= args.size())
 		return false;
-	if (args[index].first != "")
+	if (!args[index].name.empty())
 		return false;
-	if (args[index].second.type != type)
+	if (args[index].value.type != type)
 		return false;
-	result = args[index].second.s_value;
+	result = args[index].value.s_value;
 	return true;
 }
 
-bool getAnonArgument(int index, glm::vec4 result, const vector<pair<string, TokenReader::Token>>& args)
+bool getAnonArgument(int index, glm::vec4 result, span<const TokenReader::Argument> args)
 {
 	if (index >= args.size())
 		return false;
-	if (args[index].first != "")
+	if (!args[index].name.empty())
 		return false;
-	if (args[index].second.type != TokenReader::VECTOR)
+	if (args[index].value.type != TokenReader::VECTOR)
 		return false;
-	result = args[index].second.c_value;
+	result = args[index].value.c_value;
 	return true;
 }
 
-bool getAnonArgument(int index, float result, const vector<pair<string, TokenReader::Token>>& args)
+bool getAnonArgument(int index, float result, span<const TokenReader::Argument> args)
 {
 	if (index >= args.size())
 		return false;
-	if (args[index].first != "")
+	if (!args[index].name.empty())
 		return false;
-	if (args[index].second.type == TokenReader::FLOAT)
+	if (args[index].value.type == TokenReader::FLOAT)
 	{
-		result = args[index].second.f_value;
+		result = args[index].value.f_value;
 		return true;
 	}
-	else if (args[index].second.type == TokenReader::INT)
+	else if (args[index].value.type == TokenReader::INT)
 	{
-		result = (float)args[index].second.i_value;
+		result = (float)args[index].value.i_value;
 		return true;
 	}
 	return false;
 }
 
+bool getCompareOp(TokenReader::Symbol value, VkCompareOp& result)
+{
+	switch (value)
+	{
+	case TokenReader::VALUE_ALWAYS: result = VK_COMPARE_OP_ALWAYS; return true;
+	case TokenReader::VALUE_EQUAL: result = VK_COMPARE_OP_EQUAL; return true;
+	case TokenReader::VALUE_GREATER: result = VK_COMPARE_OP_GREATER; return true;
+	case TokenReader::VALUE_GREATER_EQUAL: result = VK_COMPARE_OP_GREATER_OR_EQUAL; return true;
+	case TokenReader::VALUE_LESS: result = VK_COMPARE_OP_LESS; return true;
+	case TokenReader::VALUE_LESS_EQUAL: result = VK_COMPARE_OP_LESS_OR_EQUAL; return true;
+	case TokenReader::VALUE_NEVER: result = VK_COMPARE_OP_NEVER; return true;
+	case TokenReader::VALUE_NOT_EQUAL: result = VK_COMPARE_OP_NOT_EQUAL; return true;
+	default: return false;
+	}
+}
+
+bool getBool(TokenReader::Symbol value, VkBool32& result)
+{
+	switch (value)
+	{
+	case TokenReader::VALUE_TRUE: result = VK_TRUE; return true;
+	case TokenReader::VALUE_FALSE: result = VK_FALSE; return true;
+	default: return false;
+	}
+}
+
+bool getCullMode(TokenReader::Symbol value, VkCullModeFlags& result)
+{
+	switch (value)
+	{
+	case TokenReader::VALUE_NONE: result = VK_CULL_MODE_NONE; return true;
+	case TokenReader::VALUE_FRONT: result = VK_CULL_MODE_FRONT_BIT; return true;
+	case TokenReader::VALUE_BACK: result = VK_CULL_MODE_BACK_BIT; return true;
+	default: return false;
+	}
+}
+
+bool getPolygonMode(TokenReader::Symbol value, VkPolygonMode& result)
+{
+	switch (value)
+	{
+	case TokenReader::VALUE_FILL: result = VK_POLYGON_MODE_FILL; return true;
+	case TokenReader::VALUE_LINE: result = VK_POLYGON_MODE_LINE; return true;
+	case TokenReader::VALUE_POINT: result = VK_POLYGON_MODE_POINT; return true;
+	default: return false;
+	}
+}
+
+bool getFilter(TokenReader::Symbol value, VkFilter& result)
+{
+	switch (value)
+	{
+	case TokenReader::VALUE_LINEAR: result = VK_FILTER_LINEAR; return true;
+	case TokenReader::VALUE_NEAREST: result = VK_FILTER_NEAREST; return true;
+	default: return false;
+	}
+}
+
+bool getAddressMode(TokenReader::Symbol value, VkSamplerAddressMode& result)
+{
+	switch (value)
+	{
+	case TokenReader::VALUE_REPEAT: result = VK_SAMPLER_ADDRESS_MODE_REPEAT; return true;
+	case TokenReader::VALUE_MIRROR: result = VK_SAMPLER_ADDRESS_MODE_MIRRORED_REPEAT; return true;
+	case TokenReader::VALUE_CLAMP: result = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE; return true;
+	default: return false;
+	}
+}
+
+static constexpr StatementSchema DEPTH_STATEMENT(false, false, true,
+{
+	{ TokenReader::ARGUMENT_OPERATION, TokenReader::TEXT, false },
+	{ TokenReader::ARGUMENT_TEST, TokenReader::TEXT, false },
+	{ TokenReader::ARGUMENT_WRITE, TokenReader::TEXT, false }
+});
+
+static constexpr StatementSchema MODE_STATEMENT(false, false, true,
+{
+	{ TokenReader::ARGUMENT_MODE, TokenReader::TEXT, false }
+});
+
+static constexpr StatementSchema SHADER_STATEMENT(false, false, true,
+{
+	{ TokenReader::ARGUMENT_RESOURCE, TokenReader::IDENTIFIER, true }
+});
+
+static constexpr StatementSchema TEXTURE_STATEMENT(false, false, true,
+{
+	{ TokenReader::ARGUMENT_RESOURCE, TokenReader::IDENTIFIER, true },
+	{ TokenReader::ARGUMENT_BINDING, TokenReader::STRING, true },
+	{ TokenReader::ARGUMENT_FILTER, TokenReader::TEXT, false },
+	{ TokenReader::ARGUMENT_ADDRESS, TokenReader::TEXT, false }
+});
+
 Ref<Material> Material::deserialise(string name)
 {
-	auto raw_data = Package::tryLoadFile(name);
-	if (raw_data.empty())
-		return nullptr;
+	// get everything the material loads reading in at once, rather than one resource statement at a time
+	if (name.starts_with("res://"))
+		Package::preload(string_view(name).substr(6));
 
-	std::string token_str((char*)raw_data.data(), raw_data.size());
-	auto tokens = TokenReader::tokenise(token_str);
-	if (tokens.empty())
+	vector<uint8_t> file_storage;
+	DataView raw_data = Package::tryLoadView(name, file_storage);
+	if (raw_data.empty())
 		return nullptr;
 
-	auto syntax_tree = TokenReader::extractSyntaxTree(tokens, token_str);
+	// package-builder compiles materials, but they can also be read as text
+	auto syntax_tree = TokenReader::read(raw_data);
 	if (syntax_tree.empty())
 		return nullptr;
 
-	map<string, Ref<Shader>> shaders;
-	map<string, Ref<Texture>> textures;
+	map<string, Ref<Shader>, less<>> shaders;
+	map<string, Ref<Texture>, less<>> textures;
 
 	VkCompareOp operation = VK_COMPARE_OP_LESS;
 	VkBool32 test = VK_TRUE;
@@ -90,180 +192,111 @@ Ref<Material> Material::deserialise(string name)
 	VkPolygonMode polygon = VK_POLYGON_MODE_FILL;
 	Ref<Shader> main_shader;
 
-	static map<string, VkCompareOp> op_map =
-	{
-		{ "ALWAYS", VK_COMPARE_OP_ALWAYS },
-		{ "EQUAL", VK_COMPARE_OP_EQUAL },
-		{ "GREATER", VK_COMPARE_OP_GREATER },
-		{ "GREATER_EQUAL", VK_COMPARE_OP_GREATER_OR_EQUAL },
-		{ "LESS", VK_COMPARE_OP_LESS },
-		{ "LESS_EQUAL", VK_COMPARE_OP_LESS_OR_EQUAL },
-		{ "NEVER", VK_COMPARE_OP_NEVER },
-		{ "NOT_EQUAL", VK_COMPARE_OP_NOT_EQUAL }
-	};
-
-	static map<string, VkBool32> bool_map =
-	{
-		{ "TRUE", VK_TRUE },
-		{ "FALSE", VK_FALSE }
-	};
-
-	static map<string, VkCullModeFlags> cull_map =
-	{
-		{ "NONE", VK_CULL_MODE_NONE },
-		{ "FRONT", VK_CULL_MODE_FRONT_BIT },
-		{ "BACK", VK_CULL_MODE_BACK_BIT }
-	};
-
-	static map<string, VkPolygonMode> polygon_map =
-	{
-		{ "FILL", VK_POLYGON_MODE_FILL },
-		{ "LINE", VK_POLYGON_MODE_LINE },
-		{ "POINT", VK_POLYGON_MODE_POINT }
-	};
-
-	static map<string, VkFilter> filter_map =
-	{
-		{ "LINEAR", VK_FILTER_LINEAR },
-		{ "NEAREST", VK_FILTER_NEAREST },
-	};
-
-	static map<string, VkSamplerAddressMode> address_map =
-	{
-		{ "REPEAT", VK_SAMPLER_ADDRESS_MODE_REPEAT },
-		{ "MIRROR", VK_SAMPLER_ADDRESS_MODE_MIRRORED_REPEAT },
-		{ "CLAMP", VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE }
-	};
-
 	vector<TokenReader::Statement> uniforms;
-	vector<map<string, TokenReader::Token>> texture_bindings;
+	vector<StatementArguments> texture_bindings;
+	const string error_base = "error deserialising material '" + name + "'";
 
 	for (const TokenReader::Statement& statement : syntax_tree)
 	{
-		if (statement.keyword == "Resource")
+		switch (statement.keyword_symbol)
 		{
-			vector<TokenReader::Token> args;
-			if (!TokenReader::readStatement(statement, false, true,
-				{
-					TokenReader::TEXT,
-					TokenReader::STRING
-				}, args, "error deserialising material '" + name + "'"))
+		case TokenReader::KEYWORD_RESOURCE:
+		{
+			StatementArguments args;
+			if (!TokenReader::readStatement(statement, RESOURCE_STATEMENT, args, error_base))
 				return nullptr;
-			if (args[0].s_value == "shader")
-				shaders[statement.identifier] = new Shader(args[1].s_value, false);
-			else if (args[0].s_value == "texture")
-				textures[statement.identifier] = new Texture(args[1].s_value);
+			if (args[0].symbol == TokenReader::VALUE_SHADER)
+				shaders[string(statement.identifier)] = ResourceCache::getShader(string(args[1].s_value), false);
+			else if (args[0].symbol == TokenReader::VALUE_TEXTURE)
+				textures[string(statement.identifier)] = ResourceCache::getTexture(string(args[1].s_value));
 			else
 			{
 				DBG_ERROR("error deserialising material '" + name + "': invalid resource type");
 				return nullptr;
 			}
+			break;
 		}
-		else if (statement.keyword == "Depth")
+		case TokenReader::KEYWORD_DEPTH:
 		{
-			map<string, TokenReader::Token> args;
-			if (!TokenReader::readStatement(statement, false, false,
-				{
-					{ "operation", { TokenReader::TEXT, false } },
-					{ "test", { TokenReader::TEXT, false } },
-					{ "write", { TokenReader::TEXT, false } }
-				}, args, "error deserialising material '" + name + "'"))
+			StatementArguments args;
+			if (!TokenReader::readStatement(statement, DEPTH_STATEMENT, args, error_base))
 				return nullptr;
-			auto it = args.find("operation");
-			if (it != args.end())
+			const TokenReader::Token* value = args.find(TokenReader::ARGUMENT_OPERATION);
+			if (value != nullptr)
 			{
-				if (op_map.contains(it->second.s_value))
-					operation = op_map[it->second.s_value];
-				else
+				if (!getCompareOp(value->symbol, operation))
 				{
 					DBG_ERROR("error deserialising material '" + name + "': invalid depth operation value");
 					return nullptr;
 				}
 			}
-			it = args.find("test");
-			if (it != args.end())
+			value = args.find(TokenReader::ARGUMENT_TEST);
+			if (value != nullptr)
 			{
-				if (bool_map.contains(it->second.s_value))
-					test = bool_map[it->second.s_value];
-				else
+				if (!getBool(value->symbol, test))
 				{
 					DBG_ERROR("error deserialising material '" + name + "': invalid depth test value");
 					return nullptr;
 				}
 			}
-			it = args.find("write");
-			if (it != args.end())
+			value = args.find(TokenReader::ARGUMENT_WRITE);
+			if (value != nullptr)
 			{
-				if (bool_map.contains(it->second.s_value))
-					write = bool_map[it->second.s_value];
-				else
+				if (!getBool(value->symbol, write))
 				{
 					DBG_ERROR("error deserialising material '" + name + "': invalid depth write value");
 					return nullptr;
 				}
 			}
+			break;
 		}
-		else if (statement.keyword == "Culling")
+		case TokenReader::KEYWORD_CULLING:
 		{
-			map<string, TokenReader::Token> args;
-			if (!TokenReader::readStatement(statement, false, false,
-				{
-					{ "mode", { TokenReader::TEXT, false } },
-				}, args, "error deserialising material '" + name + "'"))
+			StatementArguments args;
+			if (!TokenReader::readStatement(statement, MODE_STATEMENT, args, error_base))
 				return nullptr;
-			auto it = args.find("mode");
-			if (it != args.end())
+			const TokenReader::Token* value = args.find(TokenReader::ARGUMENT_MODE);
+			if (value != nullptr)
 			{
-				if (cull_map.contains(it->second.s_value))
-					cull = cull_map[it->second.s_value];
-				else
+				if (!getCullMode(value->symbol, cull))
 				{
 					DBG_ERROR("error deserialising material '" + name + "': invalid culling mode value");
 					return nullptr;
 				}
 			}
+			break;
 		}
-		else if (statement.keyword == "Polygon")
+		case TokenReader::KEYWORD_POLYGON:
 		{
-			map<string, TokenReader::Token> args;
-			if (!TokenReader::readStatement(statement, false, false,
-				{
-					{ "mode", { TokenReader::TEXT, false } },
-				}, args, "error deserialising material '" + name + "'"))
+			StatementArguments args;
+			if (!TokenReader::readStatement(statement, MODE_STATEMENT, args, error_base))
 				return nullptr;
-			auto it = args.find("mode");
-			if (it != args.end())
+			const TokenReader::Token* value = args.find(TokenReader::ARGUMENT_MODE);
+			if (value != nullptr)
 			{
-				if (polygon_map.contains(it->second.s_value))
-					polygon = polygon_map[it->second.s_value];
-				else
+				if (!getPolygonMode(value->symbol, polygon))
 				{
 					DBG_ERROR("error deserialising material '" + name + "': invalid polygon mode value");
 					return nullptr;
 				}
 			}
+			break;
 		}
-		else if (statement.keyword == "Shader")
+		case TokenReader::KEYWORD_SHADER:
 		{
-			map<string, TokenReader::Token> args;
-			if (!TokenReader::readStatement(statement, false, false,
-				{
-					{ "resource", { TokenReader::IDENTIFIER, true } },
-				}, args, "error deserialising material '" + name + "'"))
+			StatementArguments args;
+			if (!TokenReader::readStatement(statement, SHADER_STATEMENT, args, error_base))
 				return nullptr;
-			auto it = args.find("resource");
-			if (it != args.end())
+			auto shader_it = shaders.find(args.find(TokenReader::ARGUMENT_RESOURCE)->s_value);
+			if (shader_it == shaders.end())
 			{
-				auto shader_it = shaders.find(it->second.s_value);
-				if (shader_it == shaders.end())
-				{
-					DBG_ERROR("error deserialising material '" + name + "': invalid shader descriptor, no such resource loaded");
-					return nullptr;
-				}
-				main_shader = shader_it->second;
+				DBG_ERROR("error deserialising material '" + name + "': invalid shader descriptor, no such resource loaded");
+				return nullptr;
 			}
+			main_shader = shader_it->second;
+			break;
 		}
-		else if (statement.keyword == "Uniform")
+		case TokenReader::KEYWORD_UNIFORM:
 		{
 			if (statement.arguments.size() > 0)
 			{
@@ -274,23 +307,18 @@ Ref<Material> Material::deserialise(string name)
 			{
 				uniforms.push_back(uniform);
 			}
+			break;
 		}
-		else if (statement.keyword == "Texture")
+		case TokenReader::KEYWORD_TEXTURE:
 		{
-			map<string, TokenReader::Token> args;
-			if (!TokenReader::readStatement(statement, false, false,
-				{
-					{ "resource", { TokenReader::IDENTIFIER, true } },
-					{ "binding", { TokenReader::STRING, true } },
-					{ "filter", { TokenReader::TEXT, false } },
-					{ "address", { TokenReader::TEXT, false } },
-				}, args, "error deserialising material '" + name + "'"))
+			StatementArguments args;
+			if (!TokenReader::readStatement(statement, TEXTURE_STATEMENT, args, error_base))
 				return nullptr;
 			texture_bindings.push_back(args);
+			break;
 		}
-		else
-		{
-			DBG_ERROR("error deserialising material '" + name + "': invalid keyword '" + statement.keyword + "'");;
+		default:
+			DBG_ERROR("error deserialising material '" + name + "': invalid keyword '" + string(statement.keyword) + "'");
 			return nullptr;
 		}
 	}
@@ -301,51 +329,45 @@ Ref<Material> Material::deserialise(string name)
 	if (!material)
 		return nullptr;
 
-	for (const auto args : texture_bindings)
+	for (const StatementArguments& args : texture_bindings)
 	{
-		auto it = args.find("resource");
-		auto texture_it = textures.find(it->second.s_value);
+		auto texture_it = textures.find(args.find(TokenReader::ARGUMENT_RESOURCE)->s_value);
 		if (texture_it == textures.end())
 		{
 			DBG_ERROR("error deserialising material '" + name + "': texture descriptor resource is not loaded");
 			return nullptr;
 		}
-		string binding;
-		binding = args.find("binding")->second.s_value;
+		string binding(args.find(TokenReader::ARGUMENT_BINDING)->s_value);
 		VkFilter filter = VK_FILTER_LINEAR;
-		it = args.find("filter");
-		if (it != args.end())
+		const TokenReader::Token* value = args.find(TokenReader::ARGUMENT_FILTER);
+		if (value != nullptr)
 		{
-			auto filter_it = filter_map.find(it->second.s_value);
-			if (filter_it == filter_map.end())
+			if (!getFilter(value->symbol, filter))
 			{
 				DBG_ERROR("error deserialising material '" + name + "': invalid texture descriptor filter value");
 				return nullptr;
 			}
-			else
-				filter = filter_it->second;
 		}
 		VkSamplerAddressMode address = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-		it = args.find("address");
-		if (it != args.end())
+		value = args.find(TokenReader::ARGUMENT_ADDRESS);
+		if (value != nullptr)
 		{
-			auto address_it = address_map.find(it->second.s_value);
-			if (address_it == address_map.end())
+			if (!getAddressMode(value->symbol, address))
 			{
 				DBG_ERROR("error deserialising material '" + name + "': invalid texture descriptor address value");
 				return nullptr;
 			}
-			else
-				address = address_it->second;
 		}
 		material->setTexture(binding, texture_it->second);
 		if (address != VK_SAMPLER_ADDRESS_MODE_REPEAT || filter != VK_FILTER_LINEAR)
-			material->setSampler(binding, new Sampler(filter, address));
+			material->setSampler(binding, ResourceCache::getSampler(filter, address));
 	}
 
 	for (const TokenReader::Statement& statement : uniforms)
 	{
-		if (statement.keyword == "vec4")
+		switch (statement.keyword_symbol)
+		{
+		case TokenReader::KEYWORD_VEC4:
 		{
 			string binding;
 			if (!getAnonArgument(0, binding, TokenReader::STRING, statement.arguments))
@@ -360,8 +382,9 @@ Ref<Material> Material::deserialise(string name)
 				return nullptr;
 			}
 			material->setVec4Uniform(binding, value);
+			break;
 		}
-		else if (statement.keyword == "float")
+		case TokenReader::KEYWORD_FLOAT:
 		{
 			string binding;
 			if (!getAnonArgument(0, binding, TokenReader::STRING, statement.arguments))
@@ -376,13 +399,245 @@ Ref<Material> Material::deserialise(string name)
 				return nullptr;
 			}
 			material->setFloatUniform(binding, value);
+			break;
 		}
-		else
-		{
-			DBG_ERROR("error deserialising material '" + name + "': invalid uniform keyword '" + statement.keyword + "'");
+		default:
+			DBG_ERROR("error deserialising material '" + name + "': invalid uniform keyword '" + string(statement.keyword) + "'");
 			return nullptr;
 		}
 	}
 
 	return material;
 }
+
+// transforms are local to the parent node. rotations are quaternions, [x, y, z, w]
+static constexpr StatementSchema NODE_STATEMENT(true, false, true,
+{
+	{ TokenReader::ARGUMENT_POSITION, TokenReader::VECTOR, false },
+	{ TokenReader::ARGUMENT_ROTATION, TokenReader::VECTOR, false },
+	{ TokenReader::ARGUMENT_SCALE, TokenReader::VECTOR, false }
+});
+
+static constexpr StatementSchema MESH_NODE_STATEMENT(true, false, true,
+{
+	{ TokenReader::ARGUMENT_DATA, TokenReader::IDENTIFIER, true },
+	{ TokenReader::ARGUMENT_MATERIAL, TokenReader::IDENTIFIER, false },
+	{ TokenReader::ARGUMENT_POSITION, TokenReader::VECTOR, false },
+	{ TokenReader::ARGUMENT_ROTATION, TokenReader::VECTOR, false },
+	{ TokenReader::ARGUMENT_SCALE, TokenReader::VECTOR, false }
+});
+
+static constexpr StatementSchema LIGHT_NODE_STATEMENT(true, false, true,
+{
+	{ TokenReader::ARGUMENT_POSITION, TokenReader::VECTOR, false },
+	{ TokenReader::ARGUMENT_ROTATION, TokenReader::VECTOR, false },
+	{ TokenReader::ARGUMENT_SCALE, TokenReader::VECTOR, false },
+	{ TokenReader::ARGUMENT_COLOUR, TokenReader::VECTOR, false },
+	{ TokenReader::ARGUMENT_DIRECTIONAL, TokenReader::INT, false },
+	{ TokenReader::ARGUMENT_HALF_ANGLE, TokenReader::FLOAT, false },
+	{ TokenReader::ARGUMENT_BRIGHTNESS, TokenReader::FLOAT, false }
+});
+
+static constexpr StatementSchema TEXT_NODE_STATEMENT(true, false, true,
+{
+	{ TokenReader::ARGUMENT_POSITION, TokenReader::VECTOR, false },
+	{ TokenReader::ARGUMENT_ROTATION, TokenReader::VECTOR, false },
+	{ TokenReader::ARGUMENT_SCALE, TokenReader::VECTOR, false },
+	{ TokenReader::ARGUMENT_TEXT, TokenReader::STRING, false },
+	{ TokenReader::ARGUMENT_LINE_WIDTH, TokenReader::INT, false },
+	{ TokenReader::ARGUMENT_TEXT_COLOUR, TokenReader::VECTOR, false }
+});
+
+static constexpr StatementSchema CAMERA_NODE_STATEMENT(false, false, true,
+{
+	{ TokenReader::ARGUMENT_POSITION, TokenReader::VECTOR, false },
+	{ TokenReader::ARGUMENT_ROTATION, TokenReader::VECTOR, false }
+});
+
+// a resource declared by a scene
+struct SceneResource
+{
+	TokenReader::Symbol type = TokenReader::NO_SYMBOL;
+	string path;
+	Ref<Mesh> mesh;
+	Ref<Material> material;
+};
+
+static bool declareResources(span<const TokenReader::Statement> statements, vector<SceneResource>& resources, unordered_map<string_view, size_t>& resource_indices, string_view error_base)
+{
+	for (const TokenReader::Statement& statement : statements)
+	{
+		if (!declareResources(statement.children, resources, resource_indices, error_base))
+			return false;
+		if (statement.keyword_symbol != TokenReader::KEYWORD_RESOURCE)
+			continue;
+
+		StatementArguments args;
+		if (!TokenReader::readStatement(statement, RESOURCE_STATEMENT, args, error_base))
+			return false;
+		if (args[0].symbol != TokenReader::VALUE_MESH && args[0].symbol != TokenReader::VALUE_MATERIAL)
+		{
+			DBG_ERROR(string(error_base) + ": invalid resource type");
+			return false;
+		}
+		if (!resource_indices.insert({ statement.identifier, resources.size() }).second)
+		{
+			DBG_ERROR(string(error_base) + ": duplicate resource '" + string(statement.identifier) + "'");
+			return false;
+		}
+		SceneResource resource;
+		resource.type = args[0].symbol;
+		resource.path = string(args[1].s_value);
+		resources.push_back(std::move(resource));
+	}
+	return true;
+}
+
+static void setLocalTransform(Transform& transform, const StatementArguments& args)
+{
+	glm::vec3 position = { 0, 0, 0 };
+	glm::vec3 euler = { 0, 0, 0 };
+	glm::vec3 scale = { 1, 1, 1 };
+	const TokenReader::Token* value = args.find(TokenReader::ARGUMENT_POSITION);
+	if (value != nullptr)
+		position = glm::vec3(value->c_value);
+	value = args.find(TokenReader::ARGUMENT_ROTATION);
+	if (value != nullptr)
+		euler = glm::eulerAngles(glm::normalize(glm::quat(value->c_value.w, value->c_value.x, value->c_value.y, value->c_value.z)));
+	value = args.find(TokenReader::ARGUMENT_SCALE);
+	if (value != nullptr)
+		scale = glm::vec3(value->c_value);
+	transform.setLocalPosition(position);
+	transform.setLocalEuler(euler);
+	transform.setLocalScale(scale);
+}
+
+Ref<Scene> Scene::deserialise(string name)
+{
+	if (name.starts_with("res://"))
+		Package::preload(string_view(name).substr(6));
+
+	vector<uint8_t> file_storage;
+	DataView raw_data = Package::tryLoadView(name, file_storage);
+	if (raw_data.empty())
+		return nullptr;
+
+	auto syntax_tree = TokenReader::read(raw_data);
+	if (syntax_tree.empty())
+		return nullptr;
+	const string error_base = "error deserialising scene '" + name + "'";
+
+	// every resource is declared before any node is built, so they can all load at once
+	vector<SceneResource> resources;
+	unordered_map<string_view, size_t> resource_indices;
+	if (!declareResources(span<const TokenReader::Statement>(syntax_tree.begin(), syntax_tree.end()), resources, resource_indices, error_base))
+		return nullptr;
+
+	// meshes, and the textures used by materials, are streamed in on the package's io workers, so nodes are built
+	// with placeholders which the real resources replace over the next few frames
+	for (SceneResource& resource : resources)
+	{
+		if (resource.type == TokenReader::VALUE_MESH)
+			resource.mesh = ResourceCache::getMesh(resource.path);
+		else if (resource.type == TokenReader::VALUE_MATERIAL)
+		{
+			resource.material = ResourceCache::getMaterial(resource.path);
+			if (!resource.material)
+				DBG_WARNING("failed to load material '" + resource.path + "' for scene '" + name + "'");
+		}
+	}
+
+	auto findResource = [&](const TokenReader::Token* reference, TokenReader::Symbol type) -> const SceneResource*
+	{
+		auto it = resource_indices.find(reference->s_value);
+		if (it == resource_indices.end() || resources[it->second].type != type)
+			return nullptr;
+		return &resources[it->second];
+	};
+
+	// nodes are built parents first, so each one is placed relative to its parent as it's created. nodes
+	// which use the same resource share it
+	Ref<Scene> scene = new Scene();
+	array<bool, TokenReader::SYMBOL_COUNT> warned = { };
+	function<bool(span<const TokenReader::Statement>, Ref<Object>)> build = [&](span<const TokenReader::Statement> statements, Ref<Object> parent)
+	{
+		for (const TokenReader::Statement& statement : statements)
+		{
+			StatementArguments args;
+			Ref<Object> object;
+			switch (statement.keyword_symbol)
+			{
+			case TokenReader::KEYWORD_RESOURCE:
+				continue;
+			case TokenReader::KEYWORD_NODE:
+				if (!TokenReader::readStatement(statement, NODE_STATEMENT, args, error_base))
+					return false;
+				object = new Object(nullptr, nullptr);
+				break;
+			case TokenReader::KEYWORD_MESH_NODE:
+			{
+				if (!TokenReader::readStatement(statement, MESH_NODE_STATEMENT, args, error_base))
+					return false;
+				const SceneResource* mesh = findResource(args.find(TokenReader::ARGUMENT_DATA), TokenReader::VALUE_MESH);
+				if (mesh == nullptr)
+				{
+					DBG_ERROR(error_base + ": invalid mesh node data, no such mesh resource declared");
+					return false;
+				}
+				Ref<Material> material;
+				const TokenReader::Token* material_reference = args.find(TokenReader::ARGUMENT_MATERIAL);
+				if (material_reference != nullptr)
+				{
+					const SceneResource* resource = findResource(material_reference, TokenReader::VALUE_MATERIAL);
+					if (resource == nullptr)
+					{
+						DBG_ERROR(error_base + ": invalid mesh node material, no such material resource declared");
+						return false;
+					}
+					material = resource->material;
+				}
+				object = new Object(mesh->mesh, material);
+				break;
+			}
+			case TokenReader::KEYWORD_LIGHT_NODE:
+			case TokenReader::KEYWORD_GIZMO_NODE:
+			case TokenReader::KEYWORD_TEXT_NODE:
+			{
+				const StatementSchema& schema = (statement.keyword_symbol == TokenReader::KEYWORD_LIGHT_NODE) ? LIGHT_NODE_STATEMENT
+					: ((statement.keyword_symbol == TokenReader::KEYWORD_TEXT_NODE) ? TEXT_NODE_STATEMENT : NODE_STATEMENT);
+				if (!TokenReader::readStatement(statement, schema, args, error_base))
+					return false;
+				// the engine can't draw these yet, but they keep their place in the hierarchy
+				if (!warned[statement.keyword_symbol])
+				{
+					DBG_WARNING("'" + string(statement.keyword) + "' nodes in scene '" + name + "' aren't supported yet, and are loaded as empty nodes");
+					warned[statement.keyword_symbol] = true;
+				}
+				object = new Object(nullptr, nullptr);
+				break;
+			}
+			case TokenReader::KEYWORD_FLY_CAMERA_NODE:
+				if (!TokenReader::readStatement(statement, CAMERA_NODE_STATEMENT, args, error_base))
+					return false;
+				setLocalTransform(scene->camera->transform, args);
+				continue;
+			default:
+				DBG_ERROR(error_base + ": invalid keyword '" + string(statement.keyword) + "'");
+				return false;
+			}
+
+			object->name = string(statement.identifier);
+			scene->objects.push_back(object);
+			object->setParent(parent);
+			setLocalTransform(object->transform, args);
+			if (!build(statement.children, object))
+				return false;
+		}
+		return true;
+	};
+	if (!build(span<const TokenReader::Statement>(syntax_tree.begin(), syntax_tree.end()), nullptr))
+		return nullptr;
+
+	DBG_INFO("deserialised scene '" + name + "' with " + to_string(scene->objects.size()) + " objects and " + to_string(resources.size()) + " resources");
+	return scene;
+}
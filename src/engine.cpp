@@ -1,11 +1,15 @@
 #include "engine.h"
 
 #include <chrono>
+#include <filesystem>
+#include <algorithm>
+#include <limits>
 #include <imgui/imgui.h>
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_vulkan.h>
 
 #include "hop_engine.h"
+#include "core_package.h"
 
 using namespace HopEngine;
 using namespace std;
@@ -25,6 +29,8 @@ void Engine::setup(void(* init_func)(Ref<Scene>), void(* _update_func)(Ref<Scene
     engine->imgui_func = _imgui_func;
     engine->update_func = _update_func;
     engine->scene = new Scene();
+    // whatever only the previous scene was using can go now
+    ResourceCache::releaseUnused();
     if (init_func)
         init_func(engine->scene);
 }
@@ -53,6 +59,7 @@ void Engine::mainLoop()
 
             ImGui::Render();
         }
+        ResourceStreamer::update();
         RenderServer::draw(delta.count());
         if (engine->update_func)
             engine->update_func(engine->scene, delta.count());
@@ -77,7 +84,25 @@ Engine::Engine()
     window = new Window(1024, 1024, "hop!");
     Input::init(window);
     Package::init();
+#if defined(PACKAGE_TRACE)
+    Package::startTrace();
+#endif
+    // the core package sits underneath everything else, so the engine can start without any package files
+    DataView core_package = CorePackage::getData();
+    if (!core_package.empty())
+        Package::loadPackage(core_package, "<core>", numeric_limits<int>::min());
     Package::loadPackage("resources.hop");
+    // patch packages are mounted over the base package in name order, so later patches override earlier ones
+    vector<string> patches;
+    error_code error;
+    for (const auto& file : filesystem::directory_iterator("patches", error))
+    {
+        if (file.path().extension() == ".hop")
+            patches.push_back(file.path().string());
+    }
+    sort(patches.begin(), patches.end());
+    for (size_t i = 0; i < patches.size(); i++)
+        Package::loadPackage(patches[i], (int)i + 1);
     RenderServer::init(window);
 }
 
@@ -85,7 +110,12 @@ Engine::~Engine()
 {
     scene = nullptr;
 
+    ResourceStreamer::destroy();
+    ResourceCache::destroy();
     RenderServer::destroy();
+#if defined(PACKAGE_TRACE)
+    Package::storeTrace(PACKAGE_TRACE);
+#endif
     Package::destroy();
     Input::destroy();
     window = nullptr;
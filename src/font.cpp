@@ -10,11 +10,24 @@ using namespace std;
 Font::Font(string atlas_name, glm::ivec2 character_texture_size)
 {
     atlas = new Texture(atlas_name);
+    setupCharacters(character_texture_size);
+
+    DBG_INFO("created font using " + atlas_name + " atlas with character size " + to_string(character_size.x) + "x" + to_string(character_size.y));
+}
+
+Font::Font(ResId atlas_resource, glm::ivec2 character_texture_size)
+{
+    atlas = new Texture(atlas_resource);
+    setupCharacters(character_texture_size);
+
+    DBG_INFO("created font using " + atlas_resource.getPath() + " atlas with character size " + to_string(character_size.x) + "x" + to_string(character_size.y));
+}
+
+void Font::setupCharacters(glm::ivec2 character_texture_size)
+{
     character_size = character_texture_size;
     chars_resolution = atlas->getSize() / character_size;
     char_uv_size = 1.0f / glm::vec2(chars_resolution);
-
-    DBG_INFO("created font using " + atlas_name + " atlas with character size " + to_string(character_size.x) + "x" + to_string(character_size.y));
 }
 
 Font::~Font()
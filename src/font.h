@@ -4,6 +4,7 @@
 #include <glm/vec2.hpp>
 
 #include "common.h"
+#include "package.h"
 
 namespace HopEngine
 {
@@ -20,12 +21,16 @@ public:
 	DELETE_CONSTRUCTORS(Font);
 
 	Font(std::string atlas, glm::ivec2 character_bitmap_size);
+	Font(ResId atlas, glm::ivec2 character_bitmap_size);
 	~Font();
 
 	inline glm::vec2 getCharacterSize() { return character_size; }
 	Ref<Texture> getAtlas();
 	glm::vec2 getCharUVOffset(char c);
 	inline glm::vec2 getCharUVSize() { return char_uv_size; }
+
+private:
+	void setupCharacters(glm::ivec2 character_bitmap_size);
 };
 
 }
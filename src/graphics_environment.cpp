@@ -74,6 +74,17 @@ void RenderServer::waitIdle()
     vkDeviceWaitIdle(environment->device);
 }
 
+void RenderServer::retire(function<void()> destroy)
+{
+    // once the environment is being torn down the device is already idle, so there's nothing to wait for
+    if (environment == nullptr || environment->destroying)
+    {
+        destroy();
+        return;
+    }
+    environment->retiring.push_back(std::move(destroy));
+}
+
 Ref<RenderPass> RenderServer::getMainRenderPass()
 {
     return environment->offscreen_pass;
@@ -113,6 +124,11 @@ VkDevice RenderServer::getDevice()
     return environment->device;
 }
 
+bool RenderServer::supportsBlockCompression()
+{
+    return environment->block_compression_supported;
+}
+
 VkDescriptorSetLayout RenderServer::getSceneDescriptorSetLayout()
 {
     return environment->scene_descriptor_set_layout;
@@ -172,7 +188,7 @@ RenderServer::RenderServer(Ref<Window> main_window)
 
 #if defined(_WIN32)
     auto data = Package::tryLoadFile("res://glslc.exe");
-    Package::tryWriteFile(Shader::compiler_path, data);
+    Package::tryWriteFile(ShaderCooker::compiler_path, data);
 #endif
 
     createInstance();
@@ -199,7 +215,7 @@ RenderServer::RenderServer(Ref<Window> main_window)
     // TODO: system for associating material with render pass, and for controlling render pass execution
     // TODO: offscreen pass needs its own scene uniform buffers since viewport size is different!
     offscreen_pass = new RenderPass(framebuffer_size.first, framebuffer_size.second, { 3, true });
-    post_process = new Material(new Shader("res://post_process", false), VK_CULL_MODE_NONE, VK_POLYGON_MODE_FILL, VK_FALSE, VK_FALSE, VK_COMPARE_OP_ALWAYS, render_pass);
+    post_process = new Material(new Shader("res://post_process"_res, false), VK_CULL_MODE_NONE, VK_POLYGON_MODE_FILL, VK_FALSE, VK_FALSE, VK_COMPARE_OP_ALWAYS, render_pass);
     Ref<Sampler> clamped_sampler = new Sampler(VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
     post_process->setSampler("screen_texture", clamped_sampler);
     post_process->setSampler("normal_texture", clamped_sampler);
@@ -232,9 +248,14 @@ RenderServer::RenderServer(Ref<Window> main_window)
 RenderServer::~RenderServer()
 {
 #if defined(_WIN32)
-    filesystem::remove(Shader::compiler_path);
+    filesystem::remove(ShaderCooker::compiler_path);
 #endif
     vkDeviceWaitIdle(device);
+    destroying = true;
+    DBG_VERBOSE("destroying retired resources");
+    for (vector<function<void()>>& destroyers : retired)
+        destroyRetired(destroyers);
+    destroyRetired(retiring);
 
     DBG_VERBOSE("\033[31mkilling imgui with a gun\033[0m");
     ImGui_ImplVulkan_Shutdown();
@@ -444,10 +465,16 @@ void RenderServer::createDevice()
         queue_create_infos.push_back(queue_create_info);
     }
 
+    // block compressed textures are optional, Texture decompresses them itself if they aren't supported
+    VkPhysicalDeviceFeatures supported_features;
+    vkGetPhysicalDeviceFeatures(physical_device, &supported_features);
+    block_compression_supported = supported_features.textureCompressionBC == VK_TRUE;
+
     VkPhysicalDeviceFeatures features{ };
     features.fillModeNonSolid = VK_TRUE;
     features.samplerAnisotropy = VK_TRUE;
     features.independentBlend = VK_TRUE;
+    features.textureCompressionBC = block_compression_supported ? VK_TRUE : VK_FALSE;
     
     // actually create the logical device
     VkDeviceCreateInfo device_create_info{ };
@@ -542,6 +569,7 @@ void RenderServer::createSyncObjects()
     image_available_semaphores.resize(MAX_FRAMES_IN_FLIGHT);
     render_finished_semaphores.resize(MAX_FRAMES_IN_FLIGHT);
     in_flight_fences.resize(MAX_FRAMES_IN_FLIGHT);
+    retired.resize(MAX_FRAMES_IN_FLIGHT);
 
     for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
     {
@@ -578,6 +606,16 @@ void RenderServer::initImGui()
     ImGui_ImplVulkan_Init(&init_info);
 }
 
+void RenderServer::destroyRetired(vector<function<void()>>& destroyers)
+{
+    if (destroyers.empty())
+        return;
+    DBG_BABBLE("destroying " + to_string(destroyers.size()) + " retired resources");
+    for (function<void()>& destroy : destroyers)
+        destroy();
+    destroyers.clear();
+}
+
 void RenderServer::drawFrame(float delta_time)
 {
     static size_t frame_index = 0;
@@ -591,6 +629,7 @@ void RenderServer::drawFrame(float delta_time)
 
     vkWaitForFences(device, 1, &in_flight_fences[frame_index % MAX_FRAMES_IN_FLIGHT], VK_TRUE, UINT64_MAX);
     vkResetFences(device, 1, &in_flight_fences[frame_index % MAX_FRAMES_IN_FLIGHT]);
+    destroyRetired(retired[frame_index % MAX_FRAMES_IN_FLIGHT]);
 
     uint32_t image_index;
     vkAcquireNextImageKHR(device, swapchain->getSwapchain(), UINT64_MAX, image_available_semaphores[frame_index % MAX_FRAMES_IN_FLIGHT], VK_NULL_HANDLE, &image_index);
@@ -605,7 +644,8 @@ void RenderServer::drawFrame(float delta_time)
         for (Ref<Object>& object : scene->getAllObjects())
         {
             object->pushToDescriptorSet(image_index);
-            object->material->pushToDescriptorSet(image_index);
+            if (object->material)
+                object->material->pushToDescriptorSet(image_index);
         }
     }
     else
@@ -631,6 +671,8 @@ void RenderServer::drawFrame(float delta_time)
     DBG_BABBLE("submitting command buffer");
     if (vkQueueSubmit(graphics_queue, 1, &submit_info, in_flight_fences[frame_index % MAX_FRAMES_IN_FLIGHT]) != VK_SUCCESS)
         DBG_FAULT("vkQueueSubmit failed");
+    // everything retired up to now waits for this frame's fence
+    swap(retired[frame_index % MAX_FRAMES_IN_FLIGHT], retiring);
 
     VkPresentInfoKHR present_info{ };
     present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -707,6 +749,9 @@ void RenderServer::recordRenderCommands(VkCommandBuffer command_buffer, uint32_t
                 DBG_WARNING("object " + PTR(object.get()) + " had invalid material or mesh");
                 continue;
             }
+            // meshes which are still being streamed in have nothing to draw yet
+            if (object->mesh->getIndexCount() == 0)
+                continue;
 
             vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, object->material->getPipeline());
 
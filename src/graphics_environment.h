@@ -2,6 +2,7 @@
 
 #include <optional>
 #include <vector>
+#include <functional>
 #include <vulkan/vulkan.hpp>
 #include <glm/vec2.hpp>
 
@@ -50,6 +51,7 @@ private:
 #endif
 	VkPhysicalDevice physical_device = VK_NULL_HANDLE;
 	VkDevice device = VK_NULL_HANDLE;
+	bool block_compression_supported = false;
 	VkQueue graphics_queue = VK_NULL_HANDLE;
 	VkQueue present_queue = VK_NULL_HANDLE;
 	VkCommandPool command_pool = VK_NULL_HANDLE;
@@ -57,6 +59,11 @@ private:
 	std::vector<VkSemaphore> image_available_semaphores;
 	std::vector<VkSemaphore> render_finished_semaphores;
 	std::vector<VkFence> in_flight_fences;
+	// destroyers of GPU resources which frames might still be using. retire collects them until the next frame
+	// is submitted, and they're run once that frame's fence has signalled, which covers everything submitted before it
+	std::vector<std::function<void()>> retiring;
+	std::vector<std::vector<std::function<void()>>> retired;
+	bool destroying = false;
 	VkSurfaceKHR surface = VK_NULL_HANDLE;
 
 	Ref<Swapchain> swapchain;
@@ -77,10 +84,13 @@ public:
 	static void destroy();
 
 	static void waitIdle();
+	// destroys something (by calling destroy) once the GPU is done with it, without waiting for the GPU now
+	static void retire(std::function<void()> destroy);
 	static Ref<RenderPass> getMainRenderPass();
 	static QueueFamilies getQueueFamilies(VkPhysicalDevice device);
 	static VkPhysicalDevice getPhysicalDevice();
 	static VkDevice getDevice();
+	static bool supportsBlockCompression();
 	static VkDescriptorSetLayout getSceneDescriptorSetLayout();
 	static VkDescriptorSetLayout getObjectDescriptorSetLayout();
 	static size_t getFramesInFlight();
@@ -104,6 +114,7 @@ private:
 	void createSyncObjects();
 	void initImGui();
 
+	void destroyRetired(std::vector<std::function<void()>>& destroyers);
 	void drawFrame(float delta_time);
 	void resizeSwapchain();
 
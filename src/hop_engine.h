@@ -14,6 +14,8 @@
 #include "window.h"
 #include "uniform_block.h"
 #include "package.h"
+#include "resource_cache.h"
+#include "resource_streamer.h"
 #include "input.h"
 #include "debug.h"
 #include "font.h"
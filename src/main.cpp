@@ -7,8 +7,6 @@
 #include <imgui.h>
 #include <vulkan/vulkan.h>
 #include <iostream>
-#include <chrono>
-#include <thread>
 #include <string>
 #if defined(_WIN32)
 #include <Windows.h>
@@ -55,32 +53,37 @@ Spline camera_spline;
 
 void initScene(Ref<Scene> scene)
 {
-    Ref<Shader> shader = new Shader("res://psx", false);
+    // read the scene's resources in on the package workers while the shader compiles. they're only touched, not
+    // unpacked, since the streamed loads below unpack them on the workers themselves
+    for (std::string_view resource : { "asha/asha.obj", "asha/asha.png", "bunny.obj", "bunny.png", "tux.obj", "tux.png" })
+        Package::preload(resource);
+
+    Ref<Shader> shader = new Shader("res://psx"_res, false);
     Ref<Sampler> sampler = new Sampler(VK_FILTER_NEAREST, VK_SAMPLER_ADDRESS_MODE_REPEAT);
     asha = scene->insertObject<Object>(new Object(
-        new Mesh("res://asha/asha.obj"),
+        Mesh::loadAsync("res://asha/asha.obj"_res),
         new Material(
             shader, VK_CULL_MODE_NONE, VK_POLYGON_MODE_FILL
         )));
-    asha->material->setTexture("albedo", new Texture("res://asha/asha.png"));
+    asha->material->setTexture("albedo", Texture::loadAsync("res://asha/asha.png"_res));
     asha->material->setSampler("albedo", sampler);
     asha->transform.setLocalPosition({ 0, 0, -0.9f });
 
     Ref<Object> bunny = scene->insertObject<Object>(new Object(
-        new Mesh("res://bunny.obj"),
+        Mesh::loadAsync("res://bunny.obj"_res),
         new Material(shader, VK_CULL_MODE_NONE, VK_POLYGON_MODE_FILL)
     ));
-    bunny->material->setTexture("albedo", new Texture("res://bunny.png"));
+    bunny->material->setTexture("albedo", Texture::loadAsync("res://bunny.png"_res));
     bunny->material->setSampler("albedo", sampler);
     bunny->setParent(asha);
     bunny->transform.setLocalPosition({ 0, -0.5f, 0.9f });
     bunny->transform.scaleLocal({ 2, 2, 2 });
 
     Ref<Object> tux = scene->insertObject<Object>(new Object(
-        new Mesh("res://tux.obj"),
+        Mesh::loadAsync("res://tux.obj"_res),
         new Material(shader, VK_CULL_MODE_NONE, VK_POLYGON_MODE_FILL)
     ));
-    tux->material->setTexture("albedo", new Texture("res://tux.png"));
+    tux->material->setTexture("albedo", Texture::loadAsync("res://tux.png"_res));
     tux->material->setSampler("albedo", sampler);
     tux->transform.translateLocal({ 2, 0, 0 });
 
@@ -88,11 +91,11 @@ void initScene(Ref<Scene> scene)
     camera_spline.points = { { 0, -1, 0.5f }, { 1, 0, 0.5f }, { 0, 1, 0.5f }, { -1, 0, 0.5f } };
 
     /*cube = new Object(
-        new Mesh("res://cube.obj"), 
-        new Material(new Shader("res://split", false), VK_CULL_MODE_BACK_BIT, VK_POLYGON_MODE_FILL)
+        new Mesh("res://cube.obj"_res), 
+        new Material(new Shader("res://split"_res, false), VK_CULL_MODE_BACK_BIT, VK_POLYGON_MODE_FILL)
     );
-    cube->material->setTexture("tex", new Texture("res://stone.png"));
-    cube->material->setTexture("tex2", new Texture("res://tex2.png"));
+    cube->material->setTexture("tex", new Texture("res://stone.png"_res));
+    cube->material->setTexture("tex2", new Texture("res://tex2.png"_res));
     cube->transform.scaleLocal({ 0.5f, 0.5f, 0.5f });
     MaterialParams material;
     LightParams light;
@@ -265,15 +268,18 @@ void updateNodeScene(Ref<Scene> scene, float delta_time)
 
 void initMaterialScene(Ref<Scene> scene)
 {
-    Ref<Shader> shader = new Shader("res://pbr", false);
+    for (std::string_view resource : { "crt_monitor.obj", "crt_monitor_t.png", "crt_monitor_n.png" })
+        Package::preload(resource);
+
+    Ref<Shader> shader = new Shader("res://pbr"_res, false);
     Ref<Sampler> sampler = new Sampler(VK_FILTER_NEAREST, VK_SAMPLER_ADDRESS_MODE_REPEAT);
     Ref<Object> obj = scene->insertObject<Object>(new Object(
-        new Mesh("res://crt_monitor.obj"),
+        Mesh::loadAsync("res://crt_monitor.obj"_res),
         new Material(
             shader, VK_CULL_MODE_BACK_BIT, VK_POLYGON_MODE_FILL
         )));
-    obj->material->setTexture("albedo", new Texture("res://crt_monitor_t.png"));
-    obj->material->setTexture("normal_map", new Texture("res://crt_monitor_n.png"));
+    obj->material->setTexture("albedo", Texture::loadAsync("res://crt_monitor_t.png"_res));
+    obj->material->setTexture("normal_map", Texture::loadAsync("res://crt_monitor_n.png"_res));
     MaterialParams material;
     LightParams light;
     light.position = { 1, 1, 1, 0 };
@@ -347,7 +353,6 @@ int main()
 #if defined(_WIN32)
     system(".\\package-builder\\bin\\x64\\Release\\package-builder.exe res -c resources.hop");
 #endif
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
 
     while (true)
     {
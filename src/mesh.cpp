@@ -2,27 +2,48 @@
 
 #include <stdexcept>
 #include <fstream>
-#include <glm/gtc/matrix_access.hpp>
-#include <sstream>
 
 #include "graphics_environment.h"
 #include "buffer.h"
+#include "command_buffer.h"
 #include "package.h"
+#include "mesh_cooker.h"
+#include "resource_streamer.h"
 
 using namespace HopEngine;
 using namespace std;
 
+// reads only the header of packaged data, so that data which isn't cooked is turned away before anything is unpacked
+template <typename Identifier>
+static bool isCookedInPackage(Identifier identifier)
+{
+    CookedMeshHeader header;
+    span<uint8_t> destination((uint8_t*)&header, sizeof(header));
+    return Package::peekData(identifier, destination) && MeshCooker::isCooked(destination);
+}
+
 Mesh::Mesh(string path)
 {
-    vector<Vertex> verts;
-    vector<uint16_t> inds;
+    constexpr string_view res_prefix = "res://";
+    if (path.starts_with(res_prefix))
+    {
+        string_view identifier = string_view(path).substr(res_prefix.size());
+        if (isCookedInPackage(identifier) && createFromCooked(Package::getDataSize(identifier), [identifier](span<uint8_t> destination) { return Package::unpackDataInto(identifier, destination); }, path))
+            return;
+    }
 
-    if (readFileToArrays(path, verts, inds))
-        createFromArrays(verts, inds);
-    else
-        DBG_ERROR("failed to load mesh " + path);
+    vector<uint8_t> file_data = Package::tryLoadFile(path);
+    createFromData(DataView(file_data.data(), file_data.size()), path);
+}
+
+Mesh::Mesh(ResId resource)
+{
+    if (isCookedInPackage(resource) && createFromCooked(Package::getDataSize(resource), [resource](span<uint8_t> destination) { return Package::unpackDataInto(resource, destination); }, resource.getPath()))
+        return;
 
-    DBG_INFO("created mesh from " + path + " with " + to_string(verts.size()) + " vertices and " + to_string(inds.size()) + " indices");
+    vector<uint8_t> file_data(Package::getDataSize(resource));
+    Package::unpackDataInto(resource, file_data);
+    createFromData(DataView(file_data.data(), file_data.size()), resource.getPath());
 }
 
 Mesh::Mesh(vector<Vertex> vertices, vector<uint16_t> indices, bool keep_accessible)
@@ -52,6 +73,9 @@ Mesh::Mesh(vector<Vertex> vertices, vector<uint16_t> indices, bool keep_accessib
     DBG_INFO("created mesh from arrays with " + to_string(vertices.size()) + " vertices and " + to_string(indices.size()) + " indices");
 }
 
+Mesh::Mesh()
+{ }
+
 Mesh::~Mesh()
 {
     DBG_INFO("destroying mesh " + PTR(this));
@@ -59,6 +83,99 @@ Mesh::~Mesh()
     index_buffer = nullptr;
 }
 
+Ref<Mesh> Mesh::loadAsync(string path)
+{
+    return stream(Package::getFileSize(path), [path](span<uint8_t> destination) { return Package::peekFile(path, destination); },
+        [path](span<uint8_t> destination) { return Package::tryLoadFileInto(path, destination); }, path);
+}
+
+Ref<Mesh> Mesh::loadAsync(ResId resource)
+{
+    return stream(Package::getDataSize(resource), [resource](span<uint8_t> destination) { return Package::peekData(resource, destination); },
+        [resource](span<uint8_t> destination) { return Package::unpackDataInto(resource, destination); }, resource.getPath());
+}
+
+// the header of cooked data is peeked here, so the staging buffer can be allocated and mapped before the load is
+// queued. the io workers then decode straight into it, and only the copy happens on the main thread, at the start
+// of a frame. OBJ files are read and parsed into arrays belonging to the load instead, since their size isn't known
+// until they've been parsed. until the mesh arrives the placeholder has no indices, which the renderer skips
+Ref<Mesh> Mesh::stream(size_t size, const function<bool(span<uint8_t>)>& peek, function<bool(span<uint8_t>)> unpack, string name)
+{
+    struct DecodedMesh
+    {
+        CookedMeshHeader header;
+        uint8_t* staging = nullptr;
+        bool cooked = false;
+        vector<Vertex> vertices;
+        vector<uint16_t> indices;
+        bool loaded = false;
+    };
+
+    Ref<Mesh> mesh = new Mesh();
+    auto decoded = make_shared<DecodedMesh>();
+
+    uint8_t header_data[sizeof(CookedMeshHeader)];
+    decoded->cooked = size >= sizeof(header_data) && peek(header_data) && MeshCooker::readCookedHeader(DataView(header_data, sizeof(header_data)), size, decoded->header)
+        && decoded->header.index_count != 0;
+    Ref<Buffer> staging_buffer;
+    if (decoded->cooked)
+    {
+        staging_buffer = new Buffer((decoded->header.vertex_count * sizeof(Vertex)) + (decoded->header.index_count * sizeof(uint16_t)),
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        decoded->staging = (uint8_t*)staging_buffer->mapMemory();
+    }
+
+    // as with textures, the workers only see the mapped pointer, and the finish step holds the staging buffer
+    ResourceStreamer::queue([decoded, size, unpack = std::move(unpack)]()
+    {
+        vector<uint8_t> file_data(size);
+        if (!unpack(file_data))
+            return;
+        if (!decoded->cooked)
+        {
+            decoded->loaded = MeshCooker::readObj(DataView(file_data.data(), file_data.size()), decoded->vertices, decoded->indices);
+            return;
+        }
+
+        // the data could have been replaced since it was peeked, in which case the staging buffer no longer fits it
+        CookedMeshHeader header;
+        DataView vertex_stream;
+        DataView index_stream;
+        if (!MeshCooker::readCooked(DataView(file_data.data(), file_data.size()), header, vertex_stream, index_stream)
+            || memcmp(&header, &decoded->header, sizeof(CookedMeshHeader)) != 0)
+            return;
+        decoded->loaded = MeshCooker::decode(header, vertex_stream, index_stream, (Vertex*)decoded->staging, (uint16_t*)(decoded->staging + (header.vertex_count * sizeof(Vertex))));
+    },
+    [mesh, decoded, staging_buffer, name]() mutable
+    {
+        bool loaded = decoded->loaded && (decoded->cooked || !decoded->indices.empty());
+        if (mesh.getReferenceCount() <= 1 || !loaded)
+        {
+            if (!loaded)
+                DBG_ERROR("failed to load mesh " + name);
+            if (staging_buffer)
+                staging_buffer->retire();
+            return;
+        }
+
+        // the upload is submitted without waiting, and the next frame is submitted after it
+        Ref<CommandBuffer> cmd_buf = new CommandBuffer(false);
+        if (decoded->cooked)
+        {
+            VkDeviceSize vertex_size = decoded->header.vertex_count * sizeof(Vertex);
+            mesh->createBuffers(staging_buffer, 0, vertex_size, vertex_size, decoded->header.index_count * sizeof(uint16_t), cmd_buf);
+            staging_buffer->retire();
+        }
+        else
+            mesh->createFromArrays(std::move(decoded->vertices), std::move(decoded->indices), cmd_buf);
+        DBG_INFO("streamed mesh from " + name + " with " + to_string(mesh->vertex_space) + " vertices and " + to_string(mesh->index_count) + " indices into " + PTR(mesh.get()));
+    });
+
+    DBG_INFO("created placeholder mesh " + PTR(mesh.get()) + " for " + name);
+    return mesh;
+}
+
 VkBuffer Mesh::getVertexBuffer()
 {
     return vertex_buffer->getBuffer();
@@ -146,252 +263,96 @@ array<VkVertexInputAttributeDescription, 5> Mesh::getAttributeDescriptions()
     return attributes;
 }
 
-struct FaceCorner { uint16_t co; uint16_t uv; uint16_t vn; };
-
-// splits a formatted OBJ face corner into its component indices
-static inline FaceCorner splitOBJFaceCorner(string str)
-{
-    FaceCorner fci = { 0,0,0 };
-    size_t first_break_ind = str.find('/');
-    fci.co = static_cast<uint16_t>(stoi(str.substr(0, first_break_ind)) - 1);
-    if (first_break_ind == string::npos) return fci;
-    size_t second_break_ind = str.find('/', first_break_ind + 1);
-    if (second_break_ind != first_break_ind + 1)
-        fci.uv = static_cast<uint16_t>(stoi(str.substr(first_break_ind + 1, second_break_ind - first_break_ind)) - 1);
-    fci.vn = static_cast<uint16_t>(stoi(str.substr(second_break_ind + 1, str.find('/', second_break_ind + 1) - second_break_ind)) - 1);
-
-    return fci;
-}
-
-struct FaceCornerReference
-{
-    uint16_t normal_index;
-    uint16_t uv_index;
-    uint16_t transferred_vert_index;
-};
-
-static glm::vec3 computeTangent(glm::vec3 co_a, glm::vec3 co_b, glm::vec3 co_c, glm::vec2 uv_a, glm::vec2 uv_b, glm::vec2 uv_c)
-{
-    // vector from the target vertex to the second vertex
-    glm::vec3 ab = { co_b.x - co_a.x, co_b.y - co_a.y, co_b.z - co_a.z };
-    // vector from the target vertex to the third vertex
-    glm::vec3 ac = { co_c.x - co_a.x, co_c.y - co_a.y, co_c.z - co_a.z };
-    // delta uv between target and second
-    glm::vec2 uv_ab = { uv_b.x - uv_a.x, uv_b.y - uv_a.y };
-    // delta uv between target and third
-    glm::vec2 uv_ac = { uv_c.x - uv_a.x, uv_c.y - uv_a.y };
-    // matrix representing UVs
-    glm::mat3 uv_mat = glm::mat3(glm::vec3(uv_ab, 0), glm::vec3(uv_ac, 0), { 0, 0, 1 });
-    // matrix representing vectors between vertices
-    glm::mat3 vec_mat = glm::mat3(ab, ac, { 0,0,0 });
-
-    // we should be able to express the vectors from A->B and A->C with reference to the difference in UV coordinate and the tangent and bitangent:
-    //
-    // AB = (duv_ab.x * T) + (duv_ab.y * B)
-    // AC = (duv_ac.x * T) + (duv_ac.y * B)
-    // 
-    // this gives us 6 simultaneous equations for the XYZ coordinates of the tangent and bitangent
-    // these can be expressed and solved with matrices:
-    // 
-    // [ AB.x  AC.x  0 ]     [ T.x  B.x  N.x ]   [ duv_ab.x  duv_ac.x  0 ]
-    // [ AB.y  AC.y  0 ]  =  [ T.y  B.y  N.y ] * [ duv_ab.y  duv_ac.y  0 ]
-    // [ AB.z  AC.z  0 ]     [ T.z  B.z  N.z ]   [ 0         0         1 ]
-    //
-
-    vec_mat = (vec_mat) * glm::inverse((uv_mat));
-
-    return glm::normalize(glm::vec3{ vec_mat[0] }); // extract tangent
-}
-
-bool Mesh::readFileToArrays(string path, vector<Vertex>& verts, vector<uint16_t>& inds)
+void Mesh::createFromData(DataView file_data, string name)
 {
-    auto file_data = Package::tryLoadFile(path);
-    auto string_data = string((char*)(file_data.data()));
-    string_data.push_back('\0');
-    auto stream = stringstream(string_data);
-
-    // vectors to load data into
-    vector<glm::vec3> tmp_co;
-    vector<glm::vec3> tmp_cl;
-    vector<FaceCorner> tmp_fc;
-    vector<glm::vec2> tmp_uv;
-    vector<glm::vec3> tmp_vn;
-
-    // temporary locations for reading data to
-    string tmps;
-    glm::vec3 tmp3;
-    glm::vec3 tmp2;
-
-    // repeat for every line in the file
-    string line;
-    while (getline(stream, line))
+    // cooked meshes go straight to the GPU, anything else is parsed as OBJ
+    if (MeshCooker::isCooked(file_data))
     {
-        auto file = stringstream(line);
-        file >> tmps;
-        if (tmps == "v")
-        {
-            // read a vertex coordinate
-            file >> tmp3.x;
-            file >> tmp3.y;
-            file >> tmp3.z;
-            tmp_co.push_back(tmp3);
-            auto peeked = file.peek();
-            if (peeked != -1)
-            {
-                file >> tmp3.x;
-                file >> tmp3.y;
-                file >> tmp3.z;
-                tmp_cl.push_back(tmp3);
-            }
-            else
-            {
-                tmp_cl.push_back({ 0, 0, 0 });
-            }
-        }
-        else if (tmps == "vn")
-        {
-            // read a face corner normal
-            file >> tmp3.x;
-            file >> tmp3.y;
-            file >> tmp3.z;
-            tmp_vn.push_back(tmp3);
-        }
-        else if (tmps == "vt")
-        {
-            // read a face corner uv (texture coordinate)
-            file >> tmp2.x;
-            file >> tmp2.y;
-            tmp_uv.push_back(tmp2);
-        }
-        else if (tmps == "f")
-        {
-            // read a face (only supports triangles)
-            file >> tmps;
-            tmp_fc.push_back(splitOBJFaceCorner(tmps));
-            file >> tmps;
-            tmp_fc.push_back(splitOBJFaceCorner(tmps));
-            file >> tmps;
-            tmp_fc.push_back(splitOBJFaceCorner(tmps));
-        }
-    }
-
-    // for each coordinate, stores a list of all the times it has been used by a face corner, and what the normal/uv index was for that face corner
-    // this allows us to tell when we should split a vertex (i.e. if it has already been used by another face corner but which had a different normal and/or a different uv)
-    vector<vector<FaceCornerReference>> fc_normal_uses(tmp_co.size(), vector<FaceCornerReference>());
-
-    verts.clear();
-    inds.clear();
-
-    for (FaceCorner fc : tmp_fc)
-    {
-        bool found_matching_vertex = false;
-        uint16_t match = 0;
-        for (FaceCornerReference existing : fc_normal_uses[fc.co])
-        {
-            if (existing.normal_index == fc.vn && existing.uv_index == fc.uv)
-            {
-                found_matching_vertex = true;
-                match = existing.transferred_vert_index;
-                break;
-            }
-        }
-
-        if (found_matching_vertex)
-        {
-            inds.push_back(match);
-        }
-        else
-        {
-            Vertex new_vert;
-            new_vert.position = glm::vec4(tmp_co[fc.co], 1);
-            new_vert.colour = glm::vec4(tmp_cl[fc.co], 0);
-            if (fc.vn < tmp_vn.size())
-                new_vert.normal = glm::vec4(tmp_vn[fc.vn], 0);
-            if (fc.uv < tmp_uv.size())
-                new_vert.uv = tmp_uv[fc.uv];
-
-            uint16_t new_index = static_cast<uint16_t>(verts.size());
-            fc_normal_uses[fc.co].push_back(FaceCornerReference{ fc.vn, fc.uv, new_index });
-
-            inds.push_back(new_index);
-            verts.push_back(new_vert);
-        }
-    }
-
-    if (tmp_vn.size() == 0)
-    {
-        for (size_t i = 0; i < inds.size() - 2; i += 3)
-        {
-            const uint16_t i0 = inds[i];
-            const uint16_t i1 = inds[i + 1];
-            const uint16_t i2 = inds[i + 2];
-
-            const glm::vec3 v0 = verts[i0].position;
-            const glm::vec3 v1 = verts[i1].position;
-            const glm::vec3 v2 = verts[i2].position;
-
-            glm::vec3 e01 = v1 - v0;
-            glm::vec3 e02 = v2 - v0;
-            glm::vec4 normal = glm::vec4(glm::cross(e01, e02), 0);
-
-            verts[i0].normal += normal;
-            verts[i1].normal += normal;
-            verts[i2].normal += normal;
-        }
-
-        for (Vertex& vert : verts)
-            vert.normal = glm::normalize(vert.normal);
+        auto copy = [file_data](span<uint8_t> destination) { memcpy(destination.data(), file_data.data(), destination.size()); return true; };
+        if (!createFromCooked(file_data.size(), copy, name))
+            DBG_ERROR("failed to load mesh " + name);
+        return;
     }
 
-    // compute tangents
-    vector<bool> touched = vector<bool>(verts.size(), false);
-    for (uint32_t tri = 0; tri < inds.size() / 3; tri++)
-    {
-        uint16_t v0 = inds[(tri * 3) + 0]; Vertex f0 = verts[v0];
-        uint16_t v1 = inds[(tri * 3) + 1]; Vertex f1 = verts[v1];
-        uint16_t v2 = inds[(tri * 3) + 2]; Vertex f2 = verts[v2];
+    vector<Vertex> verts;
+    vector<uint16_t> inds;
 
-        if (!touched[v1]) verts[v1].tangent = glm::vec4(computeTangent(f1.position, f0.position, f2.position, f1.uv, f0.uv, f2.uv), 1);
-        if (!touched[v2]) verts[v2].tangent = glm::vec4(computeTangent(f2.position, f0.position, f1.position, f2.uv, f0.uv, f1.uv), 1);
-        if (!touched[v0]) verts[v0].tangent = glm::vec4(computeTangent(f0.position, f1.position, f2.position, f0.uv, f1.uv, f2.uv), 1);
+    if (MeshCooker::readObj(file_data, verts, inds))
+        createFromArrays(verts, inds);
+    else
+        DBG_ERROR("failed to load mesh " + name);
 
-        touched[v0] = true; touched[v1] = true; touched[v2] = true;
-    }
+    DBG_INFO("created mesh from " + name + " with " + to_string(verts.size()) + " vertices and " + to_string(inds.size()) + " indices");
+}
 
-    // transform from Z back Y up space into Z up Y forward space
-    for (Vertex& fv : verts)
-    {
-        fv.position = { fv.position.x, -fv.position.z, fv.position.y, 1 };
-        fv.normal = { fv.normal.x, -fv.normal.z, fv.normal.y, 0 };
-        fv.tangent = { fv.tangent.x, -fv.tangent.z, fv.tangent.y, 0 };
-    }
+// cooked meshes are unpacked and then decoded straight into a staging buffer, which the vertex and index arrays
+// are copied to the GPU from. data which isn't cooked makes this return false before the mesh's buffers are created
+bool Mesh::createFromCooked(size_t size, const function<bool(span<uint8_t>)>& unpack, string name)
+{
+    if (size < sizeof(CookedMeshHeader))
+        return false;
+
+    vector<uint8_t> cooked(size);
+    CookedMeshHeader header;
+    DataView vertex_stream;
+    DataView index_stream;
+    if (!unpack(cooked) || !MeshCooker::readCooked(DataView(cooked.data(), cooked.size()), header, vertex_stream, index_stream))
+        return false;
+
+    VkDeviceSize vertex_size = header.vertex_count * sizeof(Vertex);
+    VkDeviceSize index_size = header.index_count * sizeof(uint16_t);
+    Ref<Buffer> staging_buffer = new Buffer(vertex_size + index_size,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    uint8_t* mapped = (uint8_t*)staging_buffer->mapMemory();
+    bool decoded = MeshCooker::decode(header, vertex_stream, index_stream, (Vertex*)mapped, (uint16_t*)(mapped + vertex_size));
+    staging_buffer->unmapMemory();
+    if (!decoded)
+        return false;
 
+    createBuffers(staging_buffer, 0, vertex_size, vertex_size, index_size);
+    DBG_INFO("created mesh from cooked " + name + " with " + to_string(header.vertex_count) + " vertices and " + to_string(header.index_count) + " indices");
     return true;
 }
 
-void Mesh::createFromArrays(vector<Vertex> verts, vector<uint16_t> inds)
+// with cmd_buf, the upload is only recorded, and the staging buffer is retired rather than destroyed
+void Mesh::createFromArrays(vector<Vertex> verts, vector<uint16_t> inds, Ref<CommandBuffer> cmd_buf)
 {
-    Ref<Buffer> staging_buffer = new Buffer(sizeof(Vertex) * verts.size(),
+    // both arrays share one staging buffer
+    VkDeviceSize vertex_size = verts.size() * sizeof(Vertex);
+    VkDeviceSize index_size = inds.size() * sizeof(uint16_t);
+    Ref<Buffer> staging_buffer = new Buffer(vertex_size + index_size,
         VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-    memcpy(staging_buffer->mapMemory(), verts.data(), staging_buffer->getSize());
+    uint8_t* mapped = (uint8_t*)staging_buffer->mapMemory();
+    memcpy(mapped, verts.data(), vertex_size);
+    memcpy(mapped + vertex_size, inds.data(), index_size);
     staging_buffer->unmapMemory();
-    vertex_buffer = new Buffer(staging_buffer->getSize(),
+
+    createBuffers(staging_buffer, 0, vertex_size, vertex_size, index_size, cmd_buf);
+    if (cmd_buf)
+        staging_buffer->retire();
+}
+
+void Mesh::createBuffers(Ref<Buffer> staging_buffer, VkDeviceSize vertex_offset, VkDeviceSize vertex_size, VkDeviceSize index_offset, VkDeviceSize index_size, Ref<CommandBuffer> cmd_buf)
+{
+    // frames which are still in flight may be drawing the old buffers
+    if (vertex_buffer)
+        vertex_buffer->retire();
+    if (index_buffer)
+        index_buffer->retire();
+
+    vertex_buffer = new Buffer(vertex_size,
         VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-    staging_buffer->copyToBuffer(vertex_buffer);
+    staging_buffer->copyToBuffer(vertex_buffer, vertex_offset, 0, vertex_size, cmd_buf);
 
-    staging_buffer = new Buffer(sizeof(uint16_t) * inds.size(),
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-    memcpy(staging_buffer->mapMemory(), inds.data(), staging_buffer->getSize());
-    staging_buffer->unmapMemory();
-    index_buffer = new Buffer(staging_buffer->getSize(),
+    index_buffer = new Buffer(index_size,
         VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-    staging_buffer->copyToBuffer(index_buffer);
+    staging_buffer->copyToBuffer(index_buffer, index_offset, 0, index_size, cmd_buf);
 
-    vertex_space = verts.size();
-    index_space = inds.size();
+    vertex_space = vertex_size / sizeof(Vertex);
+    index_space = index_size / sizeof(uint16_t);
     index_count = index_space;
 }
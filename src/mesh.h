@@ -3,23 +3,18 @@
 #include <array>
 #include <string>
 #include <vector>
+#include <span>
+#include <functional>
 #include <vulkan/vulkan.hpp>
 #include <glm/glm.hpp>
 
 #include "common.h"
+#include "package.h"
+#include "mesh_cooker.h"
 
 namespace HopEngine
 {
 
-struct Vertex
-{
-	glm::vec4 position;
-	glm::vec4 colour;
-	glm::vec4 normal;
-	glm::vec4 tangent;
-	glm::vec2 uv;
-};
-
 class Mesh
 {
 private:
@@ -31,12 +26,17 @@ private:
 	bool accessible = false;
 
 public:
-	DELETE_CONSTRUCTORS(Mesh);
+	DELETE_NOT_ALL_CONSTRUCTORS(Mesh);
 
 	Mesh(std::string path);
+	Mesh(ResId resource);
 	Mesh(std::vector<Vertex> vertices, std::vector<uint16_t> indices, bool keep_accessible = false);
 	~Mesh();
 
+	// returns an empty placeholder straight away, which isn't drawn until the mesh has been streamed into it
+	static Ref<Mesh> loadAsync(std::string path);
+	static Ref<Mesh> loadAsync(ResId resource);
+
 	VkBuffer getVertexBuffer();
 	VkBuffer getIndexBuffer();
 	inline size_t getIndexCount() { return index_count; }
@@ -46,8 +46,13 @@ public:
 	static std::array<VkVertexInputAttributeDescription, 5> getAttributeDescriptions();
 
 private:
-	bool readFileToArrays(std::string path, std::vector<Vertex>& verts, std::vector<uint16_t>& inds);
-	void createFromArrays(std::vector<Vertex> verts, std::vector<uint16_t> inds);
+	Mesh();
+
+	void createFromData(DataView file_data, std::string name);
+	bool createFromCooked(size_t size, const std::function<bool(std::span<uint8_t>)>& unpack, std::string name);
+	void createFromArrays(std::vector<Vertex> verts, std::vector<uint16_t> inds, Ref<CommandBuffer> cmd_buf = nullptr);
+	void createBuffers(Ref<Buffer> staging_buffer, VkDeviceSize vertex_offset, VkDeviceSize vertex_size, VkDeviceSize index_offset, VkDeviceSize index_size, Ref<CommandBuffer> cmd_buf = nullptr);
+	static Ref<Mesh> stream(size_t size, const std::function<bool(std::span<uint8_t>)>& peek, std::function<bool(std::span<uint8_t>)> unpack, std::string name);
 };
 
 }
@@ -0,0 +1,299 @@
+#include "mesh_compression.h"
+
+#include <cstring>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MESH_COMPRESSION_SSE2
+#endif
+
+using namespace HopEngine;
+using namespace std;
+
+// byte stream format:
+//   a header of 2 bits per group of 16 values (4 groups per byte, first group in the low bits), giving
+//   the number of bits each value in the group is stored with: 0, 2, 4 or 8
+//   the data for each group in turn: 0, 4, 8 or 16 bytes. with 2 and 4 bits, value i is stored in
+//   byte i % (bytes in the group), shifted up by the width once for every time the bytes wrap round,
+//   so the decoder can unpack a whole group with a few shifts rather than a shuffle
+// vertex stream format: for each block of up to block_size vertices, one byte stream for each byte of
+// the vertex, holding the zigzag coded difference from that byte in the previous vertex
+// index stream format: the zigzag coded difference of each index from the previous one, split into
+// a byte stream of the low bytes followed by a byte stream of the high bytes
+
+enum GroupWidth : uint8_t
+{
+	GROUP_0BIT = 0,
+	GROUP_2BIT = 1,
+	GROUP_4BIT = 2,
+	GROUP_8BIT = 3
+};
+
+static constexpr size_t GROUP_BYTES[] = { 0, 4, 8, 16 };
+
+static inline uint8_t zigzag8(uint8_t delta)
+{
+	return (uint8_t)((delta << 1) ^ (uint8_t)((int8_t)delta >> 7));
+}
+
+static inline uint8_t unzigzag8(uint8_t value)
+{
+	return (uint8_t)((value >> 1) ^ (uint8_t)(0 - (value & 1)));
+}
+
+static inline uint16_t zigzag16(uint16_t delta)
+{
+	return (uint16_t)((delta << 1) ^ (uint16_t)((int16_t)delta >> 15));
+}
+
+static inline uint16_t unzigzag16(uint16_t value)
+{
+	return (uint16_t)((value >> 1) ^ (uint16_t)(0 - (value & 1)));
+}
+
+static inline size_t roundToGroup(size_t count)
+{
+	return (count + MeshCompression::group_size - 1) & ~(MeshCompression::group_size - 1);
+}
+
+static inline void unpackGroup(GroupWidth width, const uint8_t* data, uint8_t* values)
+{
+#if defined(MESH_COMPRESSION_SSE2)
+	__m128i unpacked;
+	switch (width)
+	{
+	case GROUP_2BIT:
+	{
+		uint32_t packed;
+		memcpy(&packed, data, sizeof(uint32_t));
+		unpacked = _mm_and_si128(_mm_set_epi32((int)(packed >> 6), (int)(packed >> 4), (int)(packed >> 2), (int)packed), _mm_set1_epi8(0x03));
+		break;
+	}
+	case GROUP_4BIT:
+	{
+		uint64_t packed;
+		memcpy(&packed, data, sizeof(uint64_t));
+		unpacked = _mm_and_si128(_mm_set_epi64x((long long)(packed >> 4), (long long)packed), _mm_set1_epi8(0x0F));
+		break;
+	}
+	case GROUP_8BIT:
+		unpacked = _mm_loadu_si128((const __m128i*)data);
+		break;
+	default:
+		unpacked = _mm_setzero_si128();
+		break;
+	}
+	_mm_storeu_si128((__m128i*)values, unpacked);
+#else
+	size_t bytes = GROUP_BYTES[width];
+	if (bytes == 0)
+	{
+		memset(values, 0, MeshCompression::group_size);
+		return;
+	}
+	size_t bits = (bytes * 8) / MeshCompression::group_size;
+	uint8_t mask = (uint8_t)((1 << bits) - 1);
+	for (size_t i = 0; i < MeshCompression::group_size; ++i)
+		values[i] = (data[i % bytes] >> ((i / bytes) * bits)) & mask;
+#endif
+}
+
+void MeshCompression::encodeBytes(vector<uint8_t>& output, const uint8_t* values, size_t count)
+{
+	size_t group_count = count / group_size;
+	size_t header_offset = output.size();
+	output.resize(output.size() + ((group_count + 3) / 4), 0);
+	for (size_t group = 0; group < group_count; ++group)
+	{
+		const uint8_t* group_values = values + (group * group_size);
+		uint8_t largest = *max_element(group_values, group_values + group_size);
+		GroupWidth width = GROUP_8BIT;
+		if (largest == 0)
+			width = GROUP_0BIT;
+		else if (largest < 4)
+			width = GROUP_2BIT;
+		else if (largest < 16)
+			width = GROUP_4BIT;
+		output[header_offset + (group / 4)] |= (uint8_t)(width << ((group % 4) * 2));
+
+		size_t bytes = GROUP_BYTES[width];
+		if (bytes == 0)
+			continue;
+		size_t bits = (bytes * 8) / group_size;
+		size_t data_offset = output.size();
+		output.resize(output.size() + bytes, 0);
+		for (size_t i = 0; i < group_size; ++i)
+			output[data_offset + (i % bytes)] |= (uint8_t)(group_values[i] << ((i / bytes) * bits));
+	}
+}
+
+// decodes count values (a multiple of group_size), returning where the stream ends or nullptr if it's truncated
+const uint8_t* MeshCompression::decodeBytes(const uint8_t* input, const uint8_t* input_end, uint8_t* values, size_t count)
+{
+	size_t group_count = count / group_size;
+	const uint8_t* header = input;
+	const uint8_t* data = input + ((group_count + 3) / 4);
+	if (data > input_end)
+		return nullptr;
+
+	for (size_t group = 0; group < group_count; ++group)
+	{
+		GroupWidth width = (GroupWidth)((header[group / 4] >> ((group % 4) * 2)) & 0x03);
+		if (data + GROUP_BYTES[width] > input_end)
+			return nullptr;
+		unpackGroup(width, data, values + (group * group_size));
+		data += GROUP_BYTES[width];
+	}
+	return data;
+}
+
+// turns a block of decoded byte streams (one every block_size bytes) back into vertices, by transposing
+// them and adding each vertex's deltas to the previous one. last holds the previous vertex
+void MeshCompression::applyDeltas(const uint8_t* deltas, uint8_t* last, uint8_t* output, size_t count, size_t stride)
+{
+#if defined(MESH_COMPRESSION_SSE2)
+	const __m128i one = _mm_set1_epi8(1);
+	const __m128i low_bits = _mm_set1_epi8(0x7F);
+	for (size_t lane = 0; lane < stride; lane += group_size)
+	{
+		__m128i previous = _mm_loadu_si128((const __m128i*)(last + lane));
+		for (size_t first = 0; first < count; first += group_size)
+		{
+			// 16x16 byte transpose, from 16 byte streams to the deltas of 16 consecutive vertices
+			__m128i rows[16];
+			for (size_t i = 0; i < 16; ++i)
+				rows[i] = _mm_loadu_si128((const __m128i*)(deltas + ((lane + i) * block_size) + first));
+			__m128i pairs[16];
+			for (size_t i = 0; i < 8; ++i)
+			{
+				pairs[i] = _mm_unpacklo_epi8(rows[i * 2], rows[(i * 2) + 1]);
+				pairs[i + 8] = _mm_unpackhi_epi8(rows[i * 2], rows[(i * 2) + 1]);
+			}
+			__m128i quads[16];
+			for (size_t i = 0; i < 4; ++i)
+			{
+				quads[i] = _mm_unpacklo_epi16(pairs[i * 2], pairs[(i * 2) + 1]);
+				quads[i + 4] = _mm_unpackhi_epi16(pairs[i * 2], pairs[(i * 2) + 1]);
+				quads[i + 8] = _mm_unpacklo_epi16(pairs[(i * 2) + 8], pairs[(i * 2) + 9]);
+				quads[i + 12] = _mm_unpackhi_epi16(pairs[(i * 2) + 8], pairs[(i * 2) + 9]);
+			}
+			__m128i columns[16];
+			for (size_t i = 0; i < 16; i += 4)
+			{
+				__m128i low_a = _mm_unpacklo_epi32(quads[i], quads[i + 1]);
+				__m128i high_a = _mm_unpackhi_epi32(quads[i], quads[i + 1]);
+				__m128i low_b = _mm_unpacklo_epi32(quads[i + 2], quads[i + 3]);
+				__m128i high_b = _mm_unpackhi_epi32(quads[i + 2], quads[i + 3]);
+				columns[i] = _mm_unpacklo_epi64(low_a, low_b);
+				columns[i + 1] = _mm_unpackhi_epi64(low_a, low_b);
+				columns[i + 2] = _mm_unpacklo_epi64(high_a, high_b);
+				columns[i + 3] = _mm_unpackhi_epi64(high_a, high_b);
+			}
+
+			size_t vertices = min(group_size, count - first);
+			for (size_t i = 0; i < vertices; ++i)
+			{
+				__m128i delta = _mm_xor_si128(_mm_and_si128(_mm_srli_epi16(columns[i], 1), low_bits), _mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(columns[i], one)));
+				previous = _mm_add_epi8(previous, delta);
+				_mm_storeu_si128((__m128i*)(output + ((first + i) * stride) + lane), previous);
+			}
+		}
+		_mm_storeu_si128((__m128i*)(last + lane), previous);
+	}
+#else
+	for (size_t vertex = 0; vertex < count; ++vertex)
+	{
+		for (size_t lane = 0; lane < stride; ++lane)
+		{
+			last[lane] += unzigzag8(deltas[(lane * block_size) + vertex]);
+			output[(vertex * stride) + lane] = last[lane];
+		}
+	}
+#endif
+}
+
+vector<uint8_t> MeshCompression::encodeVertices(const uint8_t* vertices, size_t count, size_t stride)
+{
+	vector<uint8_t> output;
+	output.reserve(count * stride / 2);
+	vector<uint8_t> deltas(block_size);
+	vector<uint8_t> last(stride, 0);
+	for (size_t first = 0; first < count; first += block_size)
+	{
+		size_t block_count = min(block_size, count - first);
+		for (size_t lane = 0; lane < stride; ++lane)
+		{
+			fill(deltas.begin(), deltas.end(), 0);
+			for (size_t i = 0; i < block_count; ++i)
+			{
+				uint8_t value = vertices[((first + i) * stride) + lane];
+				deltas[i] = zigzag8((uint8_t)(value - last[lane]));
+				last[lane] = value;
+			}
+			encodeBytes(output, deltas.data(), roundToGroup(block_count));
+		}
+	}
+	return output;
+}
+
+bool MeshCompression::decodeVertices(DataView input, uint8_t* output, size_t count, size_t stride)
+{
+	if (stride % group_size != 0)
+		return false;
+
+	const uint8_t* read = input.data();
+	const uint8_t* end = input.data() + input.size();
+	vector<uint8_t> deltas(stride * block_size);
+	vector<uint8_t> last(stride, 0);
+	for (size_t first = 0; first < count; first += block_size)
+	{
+		size_t block_count = min(block_size, count - first);
+		for (size_t lane = 0; lane < stride; ++lane)
+		{
+			read = decodeBytes(read, end, deltas.data() + (lane * block_size), roundToGroup(block_count));
+			if (read == nullptr)
+				return false;
+		}
+		applyDeltas(deltas.data(), last.data(), output + (first * stride), block_count, stride);
+	}
+	return read == end;
+}
+
+vector<uint8_t> MeshCompression::encodeIndices(const uint16_t* indices, size_t count)
+{
+	vector<uint8_t> low_bytes(roundToGroup(count), 0);
+	vector<uint8_t> high_bytes(roundToGroup(count), 0);
+	uint16_t last = 0;
+	for (size_t i = 0; i < count; ++i)
+	{
+		uint16_t delta = zigzag16((uint16_t)(indices[i] - last));
+		low_bytes[i] = (uint8_t)(delta & 0xFF);
+		high_bytes[i] = (uint8_t)(delta >> 8);
+		last = indices[i];
+	}
+
+	vector<uint8_t> output;
+	encodeBytes(output, low_bytes.data(), low_bytes.size());
+	encodeBytes(output, high_bytes.data(), high_bytes.size());
+	return output;
+}
+
+bool MeshCompression::decodeIndices(DataView input, uint16_t* output, size_t count)
+{
+	vector<uint8_t> low_bytes(roundToGroup(count));
+	vector<uint8_t> high_bytes(roundToGroup(count));
+	const uint8_t* read = decodeBytes(input.data(), input.data() + input.size(), low_bytes.data(), low_bytes.size());
+	if (read != nullptr)
+		read = decodeBytes(read, input.data() + input.size(), high_bytes.data(), high_bytes.size());
+	if (read != input.data() + input.size())
+		return false;
+
+	uint16_t last = 0;
+	for (size_t i = 0; i < count; ++i)
+	{
+		last += unzigzag16((uint16_t)(low_bytes[i] | (high_bytes[i] << 8)));
+		output[i] = last;
+	}
+	return true;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "common.h"
+#include "package.h"
+
+namespace HopEngine
+{
+
+// meshoptimizer-style codec for vertex and index arrays. each byte of a vertex is delta coded against the same
+// byte of the previous vertex, and the deltas are zigzag coded and bit packed in groups of 16. indices are delta
+// and zigzag coded as whole values, then packed the same way. the output is small by itself, and compresses
+// further in packages built with compression
+class MeshCompression
+{
+public:
+	// vertices are decoded in blocks of this many, so the decoder's working set stays in cache
+	static constexpr size_t block_size = 256;
+	static constexpr size_t group_size = 16;
+
+	DELETE_CONSTRUCTORS(MeshCompression);
+
+	// the vertex stride must be a multiple of group_size
+	static std::vector<uint8_t> encodeVertices(const uint8_t* vertices, size_t count, size_t stride);
+	static bool decodeVertices(DataView input, uint8_t* output, size_t count, size_t stride);
+	static std::vector<uint8_t> encodeIndices(const uint16_t* indices, size_t count);
+	static bool decodeIndices(DataView input, uint16_t* output, size_t count);
+
+private:
+	static void encodeBytes(std::vector<uint8_t>& output, const uint8_t* values, size_t count);
+	static const uint8_t* decodeBytes(const uint8_t* input, const uint8_t* input_end, uint8_t* values, size_t count);
+	static void applyDeltas(const uint8_t* deltas, uint8_t* last, uint8_t* output, size_t count, size_t stride);
+};
+
+}
@@ -0,0 +1,506 @@
+#include "mesh_cooker.h"
+
+#include <cstring>
+#include <cmath>
+#include <charconv>
+#include <thread>
+#include <future>
+#include <algorithm>
+#include <string_view>
+#include <glm/gtc/matrix_access.hpp>
+
+#include "mesh_compression.h"
+#include "package.h"
+
+using namespace HopEngine;
+using namespace std;
+
+struct FaceCorner { uint32_t co; uint32_t uv; uint32_t vn; };
+
+// what one chunk of an OBJ file holds. chunks are parsed separately and appended in order, and since face corners
+// refer to positions, UVs and normals by their index in the whole file, the indices stay as they are
+struct ObjChunk
+{
+	vector<glm::vec3> positions;
+	vector<glm::vec3> colours;
+	vector<glm::vec2> uvs;
+	vector<glm::vec3> normals;
+	vector<FaceCorner> corners;
+	string_view malformed_line;
+};
+
+// files smaller than this many bytes per thread are parsed on fewer threads
+static constexpr size_t OBJ_CHUNK_SIZE = 1 << 20;
+
+static inline const char* skipSpaces(const char* c, const char* end)
+{
+	while (c < end && (*c == ' ' || *c == '\t' || *c == '\r'))
+		++c;
+	return c;
+}
+
+// from_chars doesn't take a leading '+', which some exporters write
+static inline bool readFloat(const char*& c, const char* end, float& value)
+{
+	c = skipSpaces(c, end);
+	if (c < end && *c == '+')
+		++c;
+	auto result = from_chars(c, end, value);
+	c = result.ptr;
+	return result.ec == errc();
+}
+
+// OBJ indices start at 1. relative (negative) indices aren't supported
+static inline bool readIndex(const char*& c, const char* end, uint32_t& index)
+{
+	auto result = from_chars(c, end, index);
+	c = result.ptr;
+	if (result.ec != errc() || index == 0)
+		return false;
+	--index;
+	return true;
+}
+
+// reads a face corner, which is "co", "co/uv", "co//vn" or "co/uv/vn". missing indices are left as 0
+static inline bool readFaceCorner(const char*& c, const char* end, FaceCorner& corner)
+{
+	corner = { 0, 0, 0 };
+	c = skipSpaces(c, end);
+	if (!readIndex(c, end, corner.co))
+		return false;
+	if (c == end || *c != '/')
+		return true;
+	++c;
+	if (c < end && *c != '/' && !readIndex(c, end, corner.uv))
+		return false;
+	if (c == end || *c != '/')
+		return true;
+	++c;
+	return readIndex(c, end, corner.vn);
+}
+
+static void parseObjChunk(const char* c, const char* end, ObjChunk& chunk)
+{
+	while (c < end)
+	{
+		const char* line_start = c;
+		const char* line_end = (const char*)memchr(c, '\n', end - c);
+		if (line_end == nullptr)
+			line_end = end;
+
+		c = skipSpaces(c, line_end);
+		const char* keyword_start = c;
+		while (c < line_end && *c != ' ' && *c != '\t' && *c != '\r')
+			++c;
+		string_view keyword(keyword_start, c - keyword_start);
+
+		bool valid = true;
+		if (keyword == "v")
+		{
+			// a vertex coordinate, which is "x y z", "x y z w", "x y z r g b" or "x y z w r g b". w is ignored
+			glm::vec3 position;
+			glm::vec3 colour = { 0, 0, 0 };
+			valid = readFloat(c, line_end, position.x) && readFloat(c, line_end, position.y) && readFloat(c, line_end, position.z);
+			float extra[4];
+			size_t extra_count = 0;
+			while (valid && skipSpaces(c, line_end) != line_end)
+				valid = extra_count < 4 && readFloat(c, line_end, extra[extra_count++]);
+			if (valid && extra_count >= 3)
+				colour = { extra[extra_count - 3], extra[extra_count - 2], extra[extra_count - 1] };
+			else if (extra_count == 2)
+				valid = false;
+			chunk.positions.push_back(position);
+			chunk.colours.push_back(colour);
+		}
+		else if (keyword == "vn")
+		{
+			// a face corner normal
+			glm::vec3 normal;
+			valid = readFloat(c, line_end, normal.x) && readFloat(c, line_end, normal.y) && readFloat(c, line_end, normal.z);
+			chunk.normals.push_back(normal);
+		}
+		else if (keyword == "vt")
+		{
+			// a face corner uv (texture coordinate)
+			glm::vec2 uv;
+			valid = readFloat(c, line_end, uv.x) && readFloat(c, line_end, uv.y);
+			chunk.uvs.push_back(uv);
+		}
+		else if (keyword == "f")
+		{
+			// a face (only triangles are supported, any corners after the third are ignored)
+			FaceCorner corners[3];
+			valid = readFaceCorner(c, line_end, corners[0]) && readFaceCorner(c, line_end, corners[1]) && readFaceCorner(c, line_end, corners[2]);
+			chunk.corners.insert(chunk.corners.end(), corners, corners + 3);
+		}
+
+		if (!valid)
+		{
+			chunk.malformed_line = string_view(line_start, line_end - line_start);
+			return;
+		}
+		c = (line_end < end) ? line_end + 1 : end;
+	}
+}
+
+static glm::vec3 computeTangent(glm::vec3 co_a, glm::vec3 co_b, glm::vec3 co_c, glm::vec2 uv_a, glm::vec2 uv_b, glm::vec2 uv_c)
+{
+	// vector from the target vertex to the second vertex
+	glm::vec3 ab = { co_b.x - co_a.x, co_b.y - co_a.y, co_b.z - co_a.z };
+	// vector from the target vertex to the third vertex
+	glm::vec3 ac = { co_c.x - co_a.x, co_c.y - co_a.y, co_c.z - co_a.z };
+	// delta uv between target and second
+	glm::vec2 uv_ab = { uv_b.x - uv_a.x, uv_b.y - uv_a.y };
+	// delta uv between target and third
+	glm::vec2 uv_ac = { uv_c.x - uv_a.x, uv_c.y - uv_a.y };
+	// matrix representing UVs
+	glm::mat3 uv_mat = glm::mat3(glm::vec3(uv_ab, 0), glm::vec3(uv_ac, 0), { 0, 0, 1 });
+	// matrix representing vectors between vertices
+	glm::mat3 vec_mat = glm::mat3(ab, ac, { 0,0,0 });
+
+	// we should be able to express the vectors from A->B and A->C with reference to the difference in UV coordinate and the tangent and bitangent:
+	//
+	// AB = (duv_ab.x * T) + (duv_ab.y * B)
+	// AC = (duv_ac.x * T) + (duv_ac.y * B)
+	// 
+	// this gives us 6 simultaneous equations for the XYZ coordinates of the tangent and bitangent
+	// these can be expressed and solved with matrices:
+	// 
+	// [ AB.x  AC.x  0 ]     [ T.x  B.x  N.x ]   [ duv_ab.x  duv_ac.x  0 ]
+	// [ AB.y  AC.y  0 ]  =  [ T.y  B.y  N.y ] * [ duv_ab.y  duv_ac.y  0 ]
+	// [ AB.z  AC.z  0 ]     [ T.z  B.z  N.z ]   [ 0         0         1 ]
+	//
+
+	vec_mat = (vec_mat) * glm::inverse((uv_mat));
+
+	return glm::normalize(glm::vec3{ vec_mat[0] }); // extract tangent
+}
+
+// the file is split into chunks at line breaks, which are parsed on separate threads when it's large enough
+bool MeshCooker::readObj(DataView file_data, vector<Vertex>& verts, vector<uint16_t>& inds)
+{
+	const char* data = (const char*)file_data.data();
+	const char* data_end = data + file_data.size();
+	// the extra chunks go to the package's io workers, unless this is already running on one (loaders decoding
+	// there), in which case the whole file is parsed here, since waiting on the other workers could deadlock
+	size_t chunk_count = Package::isIoWorker() ? 1 : min((size_t)clamp(thread::hardware_concurrency(), 1u, 8u), max(file_data.size() / OBJ_CHUNK_SIZE, (size_t)1));
+
+	vector<const char*> boundaries = { data };
+	for (size_t i = 1; i < chunk_count; ++i)
+	{
+		const char* boundary = max(data + (file_data.size() * i / chunk_count), boundaries.back());
+		const char* line_end = (const char*)memchr(boundary, '\n', data_end - boundary);
+		boundaries.push_back((line_end == nullptr) ? data_end : line_end + 1);
+	}
+	boundaries.push_back(data_end);
+
+	vector<ObjChunk> chunks(chunk_count);
+	vector<future<void>> parses;
+	for (size_t i = 1; i < chunk_count; ++i)
+		parses.push_back(Package::runAsync([&boundaries, &chunks, i]() { parseObjChunk(boundaries[i], boundaries[i + 1], chunks[i]); }));
+	parseObjChunk(boundaries[0], boundaries[1], chunks[0]);
+	for (future<void>& parse : parses)
+		parse.wait();
+
+	// chunks are appended in file order
+	ObjChunk obj;
+	for (ObjChunk& chunk : chunks)
+	{
+		if (!chunk.malformed_line.empty())
+		{
+			DBG_ERROR("malformed OBJ line '" + string(chunk.malformed_line) + "'");
+			return false;
+		}
+		obj.positions.insert(obj.positions.end(), chunk.positions.begin(), chunk.positions.end());
+		obj.colours.insert(obj.colours.end(), chunk.colours.begin(), chunk.colours.end());
+		obj.uvs.insert(obj.uvs.end(), chunk.uvs.begin(), chunk.uvs.end());
+		obj.normals.insert(obj.normals.end(), chunk.normals.begin(), chunk.normals.end());
+		obj.corners.insert(obj.corners.end(), chunk.corners.begin(), chunk.corners.end());
+	}
+
+	// each face corner with a new combination of coordinate, normal and uv becomes a vertex. the vertices made from
+	// each coordinate so far are kept in a list through next_use, to find a match without searching all of them
+	constexpr uint32_t no_vertex = UINT32_MAX;
+	vector<uint32_t> first_use(obj.positions.size(), no_vertex);
+	vector<uint32_t> next_use;
+	vector<FaceCorner> vertex_corners;
+
+	verts.clear();
+	inds.clear();
+	inds.reserve(obj.corners.size());
+
+	for (FaceCorner fc : obj.corners)
+	{
+		if (fc.co >= obj.positions.size())
+		{
+			DBG_ERROR("OBJ face refers to vertex " + to_string(fc.co + 1) + " of " + to_string(obj.positions.size()));
+			return false;
+		}
+
+		uint32_t match = first_use[fc.co];
+		while (match != no_vertex && (vertex_corners[match].vn != fc.vn || vertex_corners[match].uv != fc.uv))
+			match = next_use[match];
+
+		if (match != no_vertex)
+		{
+			inds.push_back(static_cast<uint16_t>(match));
+		}
+		else
+		{
+			if (verts.size() > UINT16_MAX)
+			{
+				DBG_ERROR("OBJ mesh has more vertices than 16 bit indices can address");
+				return false;
+			}
+
+			Vertex new_vert{ };
+			new_vert.position = glm::vec4(obj.positions[fc.co], 1);
+			new_vert.colour = glm::vec4(obj.colours[fc.co], 0);
+			if (fc.vn < obj.normals.size())
+				new_vert.normal = glm::vec4(obj.normals[fc.vn], 0);
+			if (fc.uv < obj.uvs.size())
+				new_vert.uv = obj.uvs[fc.uv];
+
+			uint32_t new_index = static_cast<uint32_t>(verts.size());
+			next_use.push_back(first_use[fc.co]);
+			first_use[fc.co] = new_index;
+			vertex_corners.push_back(fc);
+
+			inds.push_back(static_cast<uint16_t>(new_index));
+			verts.push_back(new_vert);
+		}
+	}
+
+	if (obj.normals.size() == 0)
+	{
+		for (size_t i = 0; i + 2 < inds.size(); i += 3)
+		{
+			const uint16_t i0 = inds[i];
+			const uint16_t i1 = inds[i + 1];
+			const uint16_t i2 = inds[i + 2];
+
+			const glm::vec3 v0 = verts[i0].position;
+			const glm::vec3 v1 = verts[i1].position;
+			const glm::vec3 v2 = verts[i2].position;
+
+			glm::vec3 e01 = v1 - v0;
+			glm::vec3 e02 = v2 - v0;
+			glm::vec4 normal = glm::vec4(glm::cross(e01, e02), 0);
+
+			verts[i0].normal += normal;
+			verts[i1].normal += normal;
+			verts[i2].normal += normal;
+		}
+
+		for (Vertex& vert : verts)
+			vert.normal = glm::normalize(vert.normal);
+	}
+
+	// compute tangents
+	vector<bool> touched = vector<bool>(verts.size(), false);
+	for (uint32_t tri = 0; tri < inds.size() / 3; tri++)
+	{
+		uint16_t v0 = inds[(tri * 3) + 0]; Vertex f0 = verts[v0];
+		uint16_t v1 = inds[(tri * 3) + 1]; Vertex f1 = verts[v1];
+		uint16_t v2 = inds[(tri * 3) + 2]; Vertex f2 = verts[v2];
+
+		if (!touched[v1]) verts[v1].tangent = glm::vec4(computeTangent(f1.position, f0.position, f2.position, f1.uv, f0.uv, f2.uv), 1);
+		if (!touched[v2]) verts[v2].tangent = glm::vec4(computeTangent(f2.position, f0.position, f1.position, f2.uv, f0.uv, f1.uv), 1);
+		if (!touched[v0]) verts[v0].tangent = glm::vec4(computeTangent(f0.position, f1.position, f2.position, f0.uv, f1.uv, f2.uv), 1);
+
+		touched[v0] = true; touched[v1] = true; touched[v2] = true;
+	}
+
+	// transform from Z back Y up space into Z up Y forward space
+	for (Vertex& fv : verts)
+	{
+		fv.position = { fv.position.x, -fv.position.z, fv.position.y, 1 };
+		fv.normal = { fv.normal.x, -fv.normal.z, fv.normal.y, 0 };
+		fv.tangent = { fv.tangent.x, -fv.tangent.z, fv.tangent.y, 0 };
+	}
+
+	return true;
+}
+
+// maps a unit vector onto the faces of an octahedron, which is then unfolded into a square
+static glm::vec2 encodeOctahedral(glm::vec3 direction)
+{
+	float length = abs(direction.x) + abs(direction.y) + abs(direction.z);
+	if (!(length > 0.0f) || !isfinite(length))
+		return { 0, 0 };
+	direction /= length;
+	glm::vec2 folded = { direction.x, direction.y };
+	if (direction.z < 0.0f)
+	{
+		folded.x = (1.0f - abs(direction.y)) * (direction.x >= 0.0f ? 1.0f : -1.0f);
+		folded.y = (1.0f - abs(direction.x)) * (direction.y >= 0.0f ? 1.0f : -1.0f);
+	}
+	return folded;
+}
+
+static glm::vec3 decodeOctahedral(glm::vec2 folded)
+{
+	glm::vec3 direction = { folded.x, folded.y, 1.0f - abs(folded.x) - abs(folded.y) };
+	float fold = max(-direction.z, 0.0f);
+	direction.x += (direction.x >= 0.0f) ? -fold : fold;
+	direction.y += (direction.y >= 0.0f) ? -fold : fold;
+	return glm::normalize(direction);
+}
+
+static inline uint16_t quantiseUnorm(float value, float minimum, float maximum)
+{
+	float range = maximum - minimum;
+	float fraction = (range > 0.0f) ? (value - minimum) / range : 0.0f;
+	return static_cast<uint16_t>(glm::round(glm::clamp(fraction, 0.0f, 1.0f) * 65535.0f));
+}
+
+static inline float dequantiseUnorm(uint16_t value, float minimum, float maximum)
+{
+	return minimum + ((maximum - minimum) * (value / 65535.0f));
+}
+
+static inline int16_t quantiseSnorm(float value)
+{
+	return static_cast<int16_t>(glm::round(glm::clamp(value, -1.0f, 1.0f) * 32767.0f));
+}
+
+QuantisedVertex MeshCooker::quantise(const Vertex& vertex, const CookedMeshHeader& header)
+{
+	QuantisedVertex quantised{ };
+	for (int i = 0; i < 3; ++i)
+		quantised.position[i] = quantiseUnorm(vertex.position[i], header.bounds_min[i], header.bounds_max[i]);
+	for (int i = 0; i < 2; ++i)
+		quantised.uv[i] = quantiseUnorm(vertex.uv[i], header.uv_min[i], header.uv_max[i]);
+	glm::vec2 normal = encodeOctahedral(vertex.normal);
+	glm::vec2 tangent = encodeOctahedral(vertex.tangent);
+	for (int i = 0; i < 2; ++i)
+	{
+		quantised.normal[i] = quantiseSnorm(normal[i]);
+		quantised.tangent[i] = quantiseSnorm(tangent[i]);
+	}
+	for (int i = 0; i < 4; ++i)
+		quantised.colour[i] = quantiseUnorm(vertex.colour[i], 0.0f, 1.0f);
+	return quantised;
+}
+
+Vertex MeshCooker::dequantise(const QuantisedVertex& quantised, const CookedMeshHeader& header)
+{
+	Vertex vertex;
+	vertex.position = { dequantiseUnorm(quantised.position[0], header.bounds_min.x, header.bounds_max.x),
+		dequantiseUnorm(quantised.position[1], header.bounds_min.y, header.bounds_max.y),
+		dequantiseUnorm(quantised.position[2], header.bounds_min.z, header.bounds_max.z), 1.0f };
+	vertex.colour = glm::vec4(quantised.colour[0], quantised.colour[1], quantised.colour[2], quantised.colour[3]) / 65535.0f;
+	vertex.normal = glm::vec4(decodeOctahedral(glm::vec2(quantised.normal[0], quantised.normal[1]) / 32767.0f), 0.0f);
+	vertex.tangent = glm::vec4(decodeOctahedral(glm::vec2(quantised.tangent[0], quantised.tangent[1]) / 32767.0f), 0.0f);
+	vertex.uv = { dequantiseUnorm(quantised.uv[0], header.uv_min.x, header.uv_max.x),
+		dequantiseUnorm(quantised.uv[1], header.uv_min.y, header.uv_max.y) };
+	return vertex;
+}
+
+vector<uint8_t> MeshCooker::cook(const vector<Vertex>& verts, const vector<uint16_t>& inds)
+{
+	CookedMeshHeader header{ };
+	header.signature = signature;
+	header.version = version;
+	header.vertex_count = static_cast<uint32_t>(verts.size());
+	header.index_count = static_cast<uint32_t>(inds.size());
+	header.index_width = sizeof(uint16_t);
+	header.vertex_stride = sizeof(Vertex);
+	if (!verts.empty())
+	{
+		header.bounds_min = verts[0].position;
+		header.bounds_max = verts[0].position;
+		header.uv_min = verts[0].uv;
+		header.uv_max = verts[0].uv;
+	}
+	for (const Vertex& vert : verts)
+	{
+		header.bounds_min = glm::min(header.bounds_min, glm::vec3(vert.position));
+		header.bounds_max = glm::max(header.bounds_max, glm::vec3(vert.position));
+		header.uv_min = glm::min(header.uv_min, vert.uv);
+		header.uv_max = glm::max(header.uv_max, vert.uv);
+	}
+
+	vector<QuantisedVertex> quantised(verts.size());
+	for (size_t i = 0; i < verts.size(); ++i)
+		quantised[i] = quantise(verts[i], header);
+	vector<uint8_t> vertex_stream = MeshCompression::encodeVertices((const uint8_t*)quantised.data(), quantised.size(), sizeof(QuantisedVertex));
+	vector<uint8_t> index_stream = MeshCompression::encodeIndices(inds.data(), inds.size());
+	header.vertex_stream_size = static_cast<uint32_t>(vertex_stream.size());
+	header.index_stream_size = static_cast<uint32_t>(index_stream.size());
+
+	vector<uint8_t> cooked(sizeof(CookedMeshHeader) + vertex_stream.size() + index_stream.size());
+	memcpy(cooked.data(), &header, sizeof(CookedMeshHeader));
+	memcpy(cooked.data() + sizeof(CookedMeshHeader), vertex_stream.data(), vertex_stream.size());
+	memcpy(cooked.data() + sizeof(CookedMeshHeader) + vertex_stream.size(), index_stream.data(), index_stream.size());
+	return cooked;
+}
+
+bool MeshCooker::isCooked(DataView data)
+{
+	uint32_t data_signature = 0;
+	if (data.size() < sizeof(CookedMeshHeader))
+		return false;
+	memcpy(&data_signature, data.data(), sizeof(uint32_t));
+	return data_signature == signature;
+}
+
+bool MeshCooker::readCooked(DataView data, CookedMeshHeader& header, DataView& vertex_stream, DataView& index_stream)
+{
+	if (!readCookedHeader(data, data.size(), header))
+		return false;
+	vertex_stream = data.subspan(sizeof(CookedMeshHeader), header.vertex_stream_size);
+	index_stream = data.subspan(sizeof(CookedMeshHeader) + header.vertex_stream_size, header.index_stream_size);
+	return true;
+}
+
+bool MeshCooker::readCookedHeader(DataView data, size_t size, CookedMeshHeader& header)
+{
+	if (!isCooked(data))
+		return false;
+	memcpy(&header, data.data(), sizeof(CookedMeshHeader));
+	if (header.version != version || header.vertex_stride != sizeof(Vertex) || header.index_width != sizeof(uint16_t))
+	{
+		DBG_WARNING("cooked mesh was made by a different version of the engine");
+		return false;
+	}
+
+	if (sizeof(CookedMeshHeader) + (size_t)header.vertex_stream_size + header.index_stream_size > size)
+	{
+		DBG_WARNING("cooked mesh is truncated");
+		return false;
+	}
+	// 16 bit indices can't reach any further, so a larger count means the header is corrupt
+	if (header.vertex_count > 65536)
+	{
+		DBG_WARNING("cooked mesh is corrupt");
+		return false;
+	}
+	return true;
+}
+
+// decodes the streams found by readCooked into header.vertex_count vertices and header.index_count indices
+bool MeshCooker::decode(const CookedMeshHeader& header, DataView vertex_stream, DataView index_stream, Vertex* vertices, uint16_t* indices)
+{
+	// vertices is usually mapped staging memory, which is slow to read back, so the quantised vertices are decoded
+	// into a buffer kept by each thread rather than into vertices, or a fresh allocation every time
+	thread_local vector<QuantisedVertex> quantised;
+	quantised.resize(header.vertex_count);
+	if (!MeshCompression::decodeVertices(vertex_stream, (uint8_t*)quantised.data(), header.vertex_count, sizeof(QuantisedVertex))
+		|| !MeshCompression::decodeIndices(index_stream, indices, header.index_count))
+	{
+		DBG_WARNING("cooked mesh is corrupt");
+		return false;
+	}
+	for (size_t i = 0; i < header.index_count; ++i)
+	{
+		if (indices[i] >= header.vertex_count)
+		{
+			DBG_WARNING("cooked mesh has an index out of range");
+			return false;
+		}
+	}
+	for (size_t i = 0; i < header.vertex_count; ++i)
+		vertices[i] = dequantise(quantised[i], header);
+	return true;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "common.h"
+#include "package.h"
+
+namespace HopEngine
+{
+
+struct Vertex
+{
+	glm::vec4 position;
+	glm::vec4 colour;
+	glm::vec4 normal;
+	glm::vec4 tangent;
+	glm::vec2 uv;
+};
+
+// cooked meshes are stored as this header, followed by the vertex stream and then the index stream. vertices are
+// quantised (see QuantisedVertex) and then both arrays are encoded with MeshCompression, so they are decoded
+// into the form they're uploaded to the GPU in as they're loaded
+struct CookedMeshHeader
+{
+	uint32_t signature;
+	uint32_t version;
+	uint32_t vertex_count;
+	uint32_t index_count;
+	uint32_t index_width;
+	uint32_t vertex_stride;
+	glm::vec3 bounds_min;
+	glm::vec3 bounds_max;
+	glm::vec2 uv_min;
+	glm::vec2 uv_max;
+	uint32_t vertex_stream_size;
+	uint32_t index_stream_size;
+};
+
+// positions and UVs are stored as 16 bit fractions of their bounds, colours as 16 bit unorm (so they're clamped
+// to [0, 1]), and normals and tangents as 16 bit octahedral coordinates. the w components are not stored, as
+// readObj always makes them 1 for positions and 0 for normals and tangents
+struct QuantisedVertex
+{
+	uint16_t position[3];
+	uint16_t uv[2];
+	int16_t normal[2];
+	int16_t tangent[2];
+	uint16_t colour[4];
+	uint16_t padding[3];
+};
+
+// converts source mesh files into the form the renderer uses. package-builder runs this ahead of time,
+// and Mesh falls back to it for files which haven't been cooked
+class MeshCooker
+{
+public:
+	static constexpr uint32_t signature = 0xC00CED3E;
+	static constexpr uint32_t version = 2;
+
+	DELETE_CONSTRUCTORS(MeshCooker);
+
+	static bool readObj(DataView file_data, std::vector<Vertex>& verts, std::vector<uint16_t>& inds);
+	static std::vector<uint8_t> cook(const std::vector<Vertex>& verts, const std::vector<uint16_t>& inds);
+	static bool isCooked(DataView data);
+	static bool readCooked(DataView data, CookedMeshHeader& header, DataView& vertex_stream, DataView& index_stream);
+	// like readCooked, but from only the header, where size is the size of all the data. this checks cooked data
+	// before it's unpacked
+	static bool readCookedHeader(DataView data, size_t size, CookedMeshHeader& header);
+	static bool decode(const CookedMeshHeader& header, DataView vertex_stream, DataView index_stream, Vertex* vertices, uint16_t* indices);
+
+private:
+	static QuantisedVertex quantise(const Vertex& vertex, const CookedMeshHeader& header);
+	static Vertex dequantise(const QuantisedVertex& vertex, const CookedMeshHeader& header);
+};
+
+}
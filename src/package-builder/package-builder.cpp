@@ -2,11 +2,63 @@
 #include <iostream>
 #include <filesystem>
 #include <string>
+#include <map>
+#include <set>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <cstring>
+#include <cstdlib>
 
 #include "../package.h"
+#include "../mesh_cooker.h"
+#include "../shader_cooker.h"
+#include "../texture_cooker.h"
+#include "../token_file.h"
 
 using namespace std;
 
+// the manifest sits next to the package and records what each entry was built from, so that unchanged
+// files can be carried over from the previous package without being read or compressed again
+struct ManifestEntry
+{
+	int64_t mtime = 0;
+	size_t size = 0;
+	uint64_t content_hash = 0;
+};
+
+struct SourceFile
+{
+	string path;
+	string identifier;
+	ManifestEntry state;
+	bool changed = false;
+};
+
+constexpr const char* MANIFEST_SIGNATURE = "hop-manifest";
+// bump this whenever the cooked formats change, so that packages built by an older builder are fully rebuilt
+constexpr int MANIFEST_VERSION = 7;
+
+// runs function(i) for every i in [0, count) across all hardware threads
+template <typename F>
+void parallelFor(size_t count, F function)
+{
+	atomic<size_t> next = 0;
+	auto worker = [&]()
+	{
+		for (size_t i = next++; i < count; i = next++)
+			function(i);
+	};
+	vector<thread> workers;
+	for (size_t i = 1; i < min((size_t)max(1u, thread::hardware_concurrency()), count); ++i)
+		workers.emplace_back(worker);
+	worker();
+	for (thread& t : workers)
+		t.join();
+}
+
 vector<uint8_t> readFile(string path)
 {
 	ifstream file(path, ios::ate | ios::binary);
@@ -22,61 +74,571 @@ vector<uint8_t> readFile(string path)
 	return content;
 }
 
+uint64_t hashContent(const vector<uint8_t>& data)
+{
+	return HopEngine::hashIdentifier(string_view((const char*)data.data(), data.size()));
+}
+
+// what cookFile does to a file depends only on its content and on this, so files with the same content
+// and cook key come out the same. files which aren't cooked have an empty key
+string getCookKey(const string& identifier)
+{
+	if (identifier.ends_with(".obj"))
+		return "obj";
+	if (identifier.ends_with(".png"))
+		return "png" + to_string(HopEngine::TextureCooker::getUsage(identifier));
+	if (identifier.ends_with(".hmat") || identifier.ends_with(".hscn"))
+		return "tokens";
+	return "";
+}
+
+// converts source files which have a runtime-ready form, leaving everything else as it is
+vector<uint8_t> cookFile(const string& identifier, vector<uint8_t> data)
+{
+	if (identifier.ends_with(".obj"))
+	{
+		vector<HopEngine::Vertex> verts;
+		vector<uint16_t> inds;
+		if (HopEngine::MeshCooker::readObj(HopEngine::DataView(data.data(), data.size()), verts, inds))
+			return HopEngine::MeshCooker::cook(verts, inds);
+		cout << "failed to cook '" << identifier << "', storing it uncooked" << endl;
+	}
+	else if (identifier.ends_with(".png"))
+	{
+		vector<uint8_t> pixels;
+		uint32_t width, height;
+		if (HopEngine::TextureCooker::decodeImage(HopEngine::DataView(data.data(), data.size()), pixels, width, height))
+			return HopEngine::TextureCooker::cook(std::move(pixels), width, height, HopEngine::TextureCooker::getUsage(identifier));
+		cout << "failed to cook '" << identifier << "', storing it uncooked" << endl;
+	}
+	else if (identifier.ends_with(".hmat") || identifier.ends_with(".hscn"))
+	{
+		HopEngine::TokenReader::SyntaxTree syntax_tree = HopEngine::TokenReader::read(HopEngine::DataView(data.data(), data.size()));
+		if (!syntax_tree.empty())
+			return HopEngine::TokenReader::compile(syntax_tree);
+		cout << "failed to compile '" << identifier << "', storing it as text" << endl;
+	}
+	return data;
+}
+
+// compiles a shader pair, and packs the SPIR-V along with its reflected bindings. returns nothing if compilation fails
+vector<uint8_t> cookShader(const SourceFile& shader, const vector<uint8_t>& vert_source, const vector<uint8_t>& frag_source, bool optimised)
+{
+	// named after the identifier hash so that shaders being compiled at the same time don't overwrite each other
+	char hash_string[17];
+	snprintf(hash_string, sizeof(hash_string), "%016llx", (unsigned long long)HopEngine::hashIdentifier(shader.identifier));
+	string out_path = HopEngine::Package::getTempPath() + "hop-shader-" + hash_string;
+	if (!HopEngine::ShaderCooker::compile(vert_source, frag_source, shader.path, out_path))
+		return { };
+
+	if (optimised)
+	{
+		if (!HopEngine::ShaderCooker::optimise(out_path + "_vert.spv") || !HopEngine::ShaderCooker::optimise(out_path + "_frag.spv"))
+			cout << "failed to optimise '" << shader.identifier << "', storing it unoptimised" << endl;
+	}
+
+	vector<uint8_t> vert_blob = readFile(out_path + "_vert.spv");
+	vector<uint8_t> frag_blob = readFile(out_path + "_frag.spv");
+	filesystem::remove(out_path + "_vert.spv");
+	filesystem::remove(out_path + "_frag.spv");
+	if (vert_blob.empty() || frag_blob.empty())
+		return { };
+
+	HopEngine::DataView vert_view(vert_blob.data(), vert_blob.size());
+	HopEngine::DataView frag_view(frag_blob.data(), frag_blob.size());
+	auto bindings = HopEngine::ShaderCooker::mergeBindings(HopEngine::ShaderCooker::getReflectedBindings(vert_view), HopEngine::ShaderCooker::getReflectedBindings(frag_view));
+	return HopEngine::ShaderCooker::cook(vert_view, frag_view, bindings);
+}
+
+// the trace is written by debug builds of the engine (see PACKAGE_TRACE), one identifier per line in the order they were first loaded
+vector<string> readTrace(string path)
+{
+	vector<string> trace;
+	ifstream file(path);
+	string identifier;
+	while (getline(file, identifier))
+	{
+		if (!identifier.empty())
+			trace.push_back(identifier);
+	}
+	return trace;
+}
+
+uint64_t hashTrace(const vector<string>& trace)
+{
+	uint64_t hash = HopEngine::IDENTIFIER_HASH_BASIS;
+	for (const string& identifier : trace)
+		hash = HopEngine::hashIdentifier("\n", HopEngine::hashIdentifier(identifier, hash));
+	return hash;
+}
+
+// list format: one identifier per line. only the listed files (and the shaders whose .vert is listed) are packed
+set<string> readList(string path)
+{
+	set<string> list;
+	ifstream file(path);
+	string identifier;
+	while (getline(file, identifier))
+	{
+		if (!identifier.empty())
+			list.insert(identifier);
+	}
+	return list;
+}
+
+// writes a package out as a byte array which can be compiled into the executable (see core_package.cpp)
+bool writeEmbedded(string path, const vector<uint8_t>& package)
+{
+	ofstream file(path);
+	if (!file.is_open())
+		return false;
+
+	file << "// generated by package-builder, do not edit\n";
+	file << "alignas(16) constexpr unsigned char embedded_package[] =\n{\n";
+	char hex_byte[8];
+	for (size_t i = 0; i < package.size(); ++i)
+	{
+		snprintf(hex_byte, sizeof(hex_byte), "0x%02x,", package[i]);
+		file << hex_byte << ((i % 32 == 31) ? "\n" : "");
+	}
+	file << "\n};\n";
+	return !file.fail();
+}
+
+// references in scenes and materials are either package paths (res://x), or paths into the source
+// directory (res/x when building from res). anything else can't be resolved to an entry
+string resolveReference(const string& reference, const string& source_name)
+{
+	if (reference.starts_with("res://"))
+		return reference.substr(6);
+	if (reference.starts_with(source_name + '/'))
+		return reference.substr(source_name.size() + 1);
+	return "";
+}
+
+// finds the resources a scene or material loads directly, from its Resource statements
+vector<string> findDependencies(const string& identifier, const string& source_name)
+{
+	HopEngine::DataView data = HopEngine::Package::loadData(identifier);
+	HopEngine::TokenReader::SyntaxTree syntax_tree = HopEngine::TokenReader::read(data);
+
+	vector<string> dependencies;
+	function<void(span<const HopEngine::TokenReader::Statement>)> scan = [&](span<const HopEngine::TokenReader::Statement> statements)
+	{
+		for (const HopEngine::TokenReader::Statement& statement : statements)
+		{
+			scan(statement.children);
+			HopEngine::StatementArguments args;
+			if (statement.keyword_symbol != HopEngine::TokenReader::KEYWORD_RESOURCE || !HopEngine::TokenReader::readStatement(statement, HopEngine::RESOURCE_STATEMENT, args, "error reading dependencies of '" + identifier + "'"))
+				continue;
+
+			string dependency = resolveReference(string(args[1].s_value), source_name);
+			vector<string> candidates = { dependency };
+			// shaders are referenced by their base name, and load the cooked shader, or failing that, the sources
+			if (args[0].symbol == HopEngine::TokenReader::VALUE_SHADER)
+				candidates = HopEngine::Package::hasData(dependency + ".shader") ? vector<string>{ dependency + ".shader" } : vector<string>{ dependency + ".vert", dependency + ".frag" };
+			for (const string& candidate : candidates)
+			{
+				if (!dependency.empty() && HopEngine::Package::hasData(candidate))
+					dependencies.push_back(candidate);
+				else
+					cout << "'" << identifier << "' depends on '" << args[1].s_value << "', which isn't in the package" << endl;
+			}
+		}
+	};
+	scan(span<const HopEngine::TokenReader::Statement>(syntax_tree.begin(), syntax_tree.end()));
+	return dependencies;
+}
+
+// builds the graph which the engine preloads from (the format is described in package.cpp)
+string buildDependencyGraph(const vector<SourceFile>& files, const string& source_name)
+{
+	string graph;
+	for (const SourceFile& source : files)
+	{
+		if (!source.identifier.ends_with(".hscn") && !source.identifier.ends_with(".hmat"))
+			continue;
+		vector<string> dependencies = findDependencies(source.identifier, source_name);
+		if (dependencies.empty())
+			continue;
+		graph += source.identifier;
+		for (const string& dependency : dependencies)
+			graph += '\t' + dependency;
+		graph += '\n';
+	}
+	return graph;
+}
+
+// manifest format: a header line, then one line per entry of "mtime size content_hash identifier"
+map<string, ManifestEntry> readManifest(string path, bool compressed, bool optimised, uint64_t& layout_hash)
+{
+	map<string, ManifestEntry> manifest;
+	ifstream file(path);
+	if (!file.is_open())
+		return manifest;
+
+	string signature;
+	int version = 0;
+	bool manifest_compressed = false;
+	bool manifest_optimised = false;
+	file >> signature >> version >> manifest_compressed >> manifest_optimised >> hex >> layout_hash >> dec;
+	// a package built with different options can't be reused
+	if (signature != MANIFEST_SIGNATURE || version != MANIFEST_VERSION || manifest_compressed != compressed || manifest_optimised != optimised)
+		return manifest;
+
+	ManifestEntry entry;
+	string identifier;
+	while (file >> entry.mtime >> entry.size >> hex >> entry.content_hash >> dec)
+	{
+		file.get();
+		getline(file, identifier);
+		manifest[identifier] = entry;
+	}
+	return manifest;
+}
+
+bool writeManifest(string path, bool compressed, bool optimised, uint64_t layout_hash, const vector<SourceFile>& files, const vector<SourceFile>& shaders)
+{
+	ofstream file(path);
+	if (!file.is_open())
+		return false;
+
+	file << MANIFEST_SIGNATURE << ' ' << MANIFEST_VERSION << ' ' << compressed << ' ' << optimised << ' ' << hex << layout_hash << dec << '\n';
+	for (const vector<SourceFile>* list : { &files, &shaders })
+	{
+		for (const SourceFile& source : *list)
+			file << source.state.mtime << ' ' << source.state.size << ' ' << hex << source.state.content_hash << dec << ' ' << source.identifier << '\n';
+	}
+	return !file.fail();
+}
+
 int main(const int nargs, const char** vargs)
 {
 	HopEngine::Debug::init(HopEngine::Debug::DEBUG_FAULT);
 	if (nargs < 2)
 	{
 		cout << "usage: package-builder SOURCE_DIRECTORY [options] [OUTPUT_FILE]" << endl;
-		cout << "options: -c (compress output)" << endl;
+		cout << "options: -c (compress output), -O (optimise compiled shaders with spirv-opt)," << endl;
+		cout << "  -p BASE_FILE (build a patch package, containing only entries which differ from BASE_FILE)," << endl;
+		cout << "  -t TRACE_FILE (lay entries out in the load order recorded by the engine, so they can be prefetched)," << endl;
+		cout << "  -a ALIGNMENT (align entry data to a power of two of at least 16 bytes, e.g. 4096 for pages)," << endl;
+		cout << "  -l LIST_FILE (only pack the identifiers listed in LIST_FILE, one per line)," << endl;
+		cout << "  -e HEADER_FILE (also write the package as a C++ byte array, for compiling into the engine)" << endl;
 		cout << "if OUTPUT_FILE is not specified, 'resources.hop'";
 		return -1;
 	}
 
 	bool compressed = false;
+	bool optimised = false;
 	string target_dir = vargs[1];
 	string output_hop = "resources.hop";
+	string base_hop;
+	string trace_path;
+	size_t alignment = 16;
+	string list_path;
+	string embed_path;
 
-	if (nargs == 3)
+	for (int i = 2; i < nargs; ++i)
 	{
-		if (string(vargs[2]) == "-c")
+		string arg = vargs[i];
+		if (arg == "-c")
 			compressed = true;
+		else if (arg == "-O")
+			optimised = true;
+		else if (arg == "-p" && i + 1 < nargs)
+			base_hop = vargs[++i];
+		else if (arg == "-t" && i + 1 < nargs)
+			trace_path = vargs[++i];
+		else if (arg == "-l" && i + 1 < nargs)
+			list_path = vargs[++i];
+		else if (arg == "-e" && i + 1 < nargs)
+			embed_path = vargs[++i];
+		else if (arg == "-a" && i + 1 < nargs)
+		{
+			alignment = strtoull(vargs[++i], nullptr, 10);
+			if (alignment < 16 || (alignment & (alignment - 1)) != 0)
+			{
+				cout << "invalid alignment '" << vargs[i] << '\'' << endl;
+				return -1;
+			}
+		}
+		else if (arg.starts_with('-') || i != nargs - 1)
+		{
+			cout << "invalid option '" << arg << '\'' << endl;
+			return -1;
+		}
 		else
-			output_hop = vargs[2];
+			output_hop = arg;
 	}
 
-	if (nargs == 4)
+	vector<string> layout_order;
+	if (!trace_path.empty())
 	{
-		if (string(vargs[2]) == "-c")
-			compressed = true;
-		else
+		layout_order = readTrace(trace_path);
+		if (layout_order.empty())
 		{
-			cout << "invalid option '" << vargs[2] << '\'' << endl;
+			cout << "failed to read trace '" << trace_path << '\'' << endl;
 			return -1;
 		}
-		output_hop = vargs[3];
 	}
+	// the layout only moves data around, so changing it doesn't invalidate anything in the manifest
+	const uint64_t layout_hash = HopEngine::hashIdentifier(to_string(alignment), hashTrace(layout_order));
 
+	set<string> list;
+	if (!list_path.empty())
+	{
+		list = readList(list_path);
+		if (list.empty())
+		{
+			cout << "failed to read list '" << list_path << '\'' << endl;
+			return -1;
+		}
+	}
+
+	// the engine unpacks its own copy of the compiler, but the builder uses the one from the vulkan sdk
+	HopEngine::ShaderCooker::compiler_path = "glslc";
+
+	auto start_time = chrono::steady_clock::now();
 	HopEngine::Package::init();
-	size_t entries = 0;
+
+	vector<SourceFile> files;
+	// resources are looked up by the hash of their identifier alone (see ResId), so hashes must be unique
+	map<uint64_t, string> hashes;
 	for (const auto& p : filesystem::recursive_directory_iterator(target_dir))
 	{
 		if (!filesystem::is_directory(p))
 		{
-			string path = p.path().string();
-			string identifier = path.substr(target_dir.size() + 1);
-			for (char& c : identifier)
+			SourceFile source;
+			source.path = p.path().string();
+			source.identifier = source.path.substr(target_dir.size() + 1);
+			for (char& c : source.identifier)
 				if (c == '\\')
 					c = '/';
-			HopEngine::Package::storeData(identifier, readFile(path));
-			++entries;
+			if (!list.empty() && !list.contains(source.identifier))
+				continue;
+			auto inserted = hashes.insert({ HopEngine::hashIdentifier(source.identifier), source.identifier });
+			if (!inserted.second)
+			{
+				cout << "identifier hash collision between '" << inserted.first->second << "' and '" << source.identifier << '\'' << endl;
+				return -1;
+			}
+			source.state.mtime = (int64_t)filesystem::last_write_time(p).time_since_epoch().count();
+			source.state.size = (size_t)filesystem::file_size(p);
+			files.push_back(source);
 		}
 	}
 
-	if (compressed)
-		HopEngine::Package::storeCompressedPackage(output_hop);
+	// every .vert with a matching .frag is also compiled into a cooked '.shader' entry alongside the sources
+	vector<SourceFile> shaders;
+	for (const SourceFile& source : files)
+	{
+		if (!source.identifier.ends_with(".vert"))
+			continue;
+		SourceFile shader;
+		shader.path = source.path.substr(0, source.path.size() - 5);
+		shader.identifier = source.identifier.substr(0, source.identifier.size() - 5) + ".shader";
+		if (!filesystem::exists(shader.path + ".frag"))
+			continue;
+		auto inserted = hashes.insert({ HopEngine::hashIdentifier(shader.identifier), shader.identifier });
+		if (!inserted.second)
+		{
+			cout << "identifier hash collision between '" << inserted.first->second << "' and '" << shader.identifier << '\'' << endl;
+			return -1;
+		}
+		shaders.push_back(shader);
+	}
+
+	// patches are built from scratch against the base package, and can only add or replace entries
+	if (!base_hop.empty() && !HopEngine::Package::loadPackage(base_hop))
+	{
+		cout << "failed to load base package '" << base_hop << '\'' << endl;
+		return -1;
+	}
+
+	// the previous package is only reused if its manifest matches it
+	string manifest_path = output_hop + ".manifest";
+	map<string, ManifestEntry> previous;
+	uint64_t previous_layout_hash = 0;
+	if (base_hop.empty() && filesystem::exists(output_hop))
+	{
+		previous = readManifest(manifest_path, compressed, optimised, previous_layout_hash);
+		if (!previous.empty() && !HopEngine::Package::loadPackage(output_hop))
+			previous.clear();
+	}
+
+	// when building a patch, entries which are identical in the base package are left out
+	auto storeEntry = [&base_hop](SourceFile& source, vector<uint8_t> data)
+	{
+		if (!base_hop.empty() && HopEngine::Package::hasData(source.identifier))
+		{
+			HopEngine::DataView base_data = HopEngine::Package::loadData(source.identifier);
+			if (base_data.size() == data.size() && memcmp(base_data.data(), data.data(), data.size()) == 0)
+			{
+				source.changed = false;
+				return;
+			}
+		}
+		HopEngine::Package::storeData(source.identifier, std::move(data));
+	};
+
+	// read and hash anything which might have changed in parallel. files with the same size and
+	// mtime as last time are trusted, and files which have only been touched keep their packed data
+	map<uint64_t, vector<uint8_t>> cooked_files;
+	mutex cooked_mutex;
+	parallelFor(files.size(), [&](size_t i)
+	{
+		SourceFile& source = files[i];
+		auto previous_it = previous.find(source.identifier);
+		if (previous_it != previous.end() && previous_it->second.mtime == source.state.mtime && previous_it->second.size == source.state.size)
+		{
+			source.state.content_hash = previous_it->second.content_hash;
+			return;
+		}
+
+		vector<uint8_t> data = readFile(source.path);
+		source.state.size = data.size();
+		source.state.content_hash = hashContent(data);
+		if (previous_it != previous.end() && previous_it->second.size == source.state.size && previous_it->second.content_hash == source.state.content_hash)
+			return;
+
+		source.changed = true;
+		string cook_key = getCookKey(source.identifier);
+		if (cook_key.empty())
+		{
+			storeEntry(source, std::move(data));
+			return;
+		}
+
+		// duplicated files are only cooked once (and the package stores them once too)
+		uint64_t cooked_hash = HopEngine::hashIdentifier(cook_key, source.state.content_hash);
+		{
+			lock_guard lock(cooked_mutex);
+			auto cooked_it = cooked_files.find(cooked_hash);
+			if (cooked_it != cooked_files.end())
+			{
+				storeEntry(source, cooked_it->second);
+				return;
+			}
+		}
+		vector<uint8_t> cooked = cookFile(source.identifier, std::move(data));
+		{
+			lock_guard lock(cooked_mutex);
+			cooked_files.insert({ cooked_hash, cooked });
+		}
+		storeEntry(source, std::move(cooked));
+	});
+	cooked_files.clear();
+
+	// shaders are keyed on their sources with all includes expanded, since an include can change without the
+	// shader itself changing. only shaders whose expanded sources differ from last time are compiled
+	atomic<size_t> failed_shaders = 0;
+	parallelFor(shaders.size(), [&](size_t i)
+	{
+		SourceFile& shader = shaders[i];
+		string prefix = filesystem::path(shader.path).remove_filename().string();
+		vector<uint8_t> vert_source = readFile(shader.path + ".vert");
+		vector<uint8_t> frag_source = readFile(shader.path + ".frag");
+		HopEngine::ShaderCooker::fixIncludes(vert_source, prefix);
+		HopEngine::ShaderCooker::fixIncludes(frag_source, prefix);
+		shader.state.content_hash = HopEngine::hashIdentifier(string_view((const char*)frag_source.data(), frag_source.size()), hashContent(vert_source));
+
+		auto previous_it = previous.find(shader.identifier);
+		if (previous_it != previous.end() && previous_it->second.content_hash == shader.state.content_hash)
+		{
+			shader.state.size = previous_it->second.size;
+			return;
+		}
+
+		shader.changed = true;
+		vector<uint8_t> cooked = cookShader(shader, vert_source, frag_source, optimised);
+		if (cooked.empty())
+		{
+			cout << "failed to compile '" << shader.identifier << '\'' << endl;
+			// forget the inputs so that it's tried again next time, and don't leave a stale version behind
+			shader.state.content_hash = 0;
+			HopEngine::Package::removeData(shader.identifier);
+			++failed_shaders;
+			return;
+		}
+		shader.state.size = cooked.size();
+		storeEntry(shader, std::move(cooked));
+	});
+
+	size_t changed = 0;
+	for (const vector<SourceFile>* list : { &files, &shaders })
+	{
+		for (const SourceFile& source : *list)
+		{
+			if (source.changed)
+				++changed;
+			previous.erase(source.identifier);
+		}
+	}
+	// whatever is left over has been deleted since the last build
+	size_t removed = previous.size();
+	for (const auto& pair : previous)
+		HopEngine::Package::removeData(pair.first);
+
+	cout << (files.size() + shaders.size()) << " entries (" << shaders.size() << " shaders): " << changed << " changed, " << (files.size() + shaders.size() - changed) << " unchanged, " << removed << " removed" << endl;
+	if (failed_shaders != 0)
+		cout << failed_shaders << " shaders failed to compile, and will only be usable by compiling them at runtime" << endl;
+
+	// scenes and materials are scanned for what they load, so the engine can load all of it at once. the graph
+	// covers the base package too, as the top-most package's graph is the one which is used
+	string graph = buildDependencyGraph(files, filesystem::path(target_dir).filename().string());
+	HopEngine::DataView previous_graph;
+	if (HopEngine::Package::hasData(HopEngine::Package::dependencies_identifier))
+		previous_graph = HopEngine::Package::loadData(HopEngine::Package::dependencies_identifier);
+	bool regraphed = graph != string((const char*)previous_graph.data(), previous_graph.size());
+	if (regraphed && graph.empty())
+		HopEngine::Package::removeData(string(HopEngine::Package::dependencies_identifier));
+	else if (regraphed)
+		HopEngine::Package::storeData(string(HopEngine::Package::dependencies_identifier), vector<uint8_t>(graph.begin(), graph.end()));
+
+	if (!base_hop.empty())
+		HopEngine::Package::unloadPackage(base_hop);
+
+	bool relayout = layout_hash != previous_layout_hash;
+	bool rewritten = changed != 0 || removed != 0 || regraphed || relayout || !base_hop.empty() || !filesystem::exists(output_hop);
+	if (rewritten)
+	{
+		// the previous package is still mapped, so the new one is written alongside it and swapped in afterwards
+		string temp_hop = output_hop + ".tmp";
+		bool stored;
+		if (compressed)
+			stored = HopEngine::Package::storeCompressedPackage(temp_hop, layout_order, alignment);
+		else
+			stored = HopEngine::Package::storePackage(temp_hop, layout_order, alignment);
+		HopEngine::Package::destroy();
+		if (!stored)
+			return -1;
+
+		error_code error;
+		filesystem::rename(temp_hop, output_hop, error);
+		if (error)
+		{
+			cout << "failed to replace '" << output_hop << "': " << error.message() << endl;
+			return -1;
+		}
+	}
 	else
-		HopEngine::Package::storePackage(output_hop);
+	{
+		HopEngine::Package::destroy();
+		cout << "package is up to date" << endl;
+	}
+
+	if (!embed_path.empty() && (rewritten || !filesystem::exists(embed_path)))
+	{
+		if (!writeEmbedded(embed_path, readFile(output_hop)))
+		{
+			cout << "failed to write embedded package '" << embed_path << '\'' << endl;
+			return -1;
+		}
+	}
+
+	if (base_hop.empty() && !writeManifest(manifest_path, compressed, optimised, layout_hash, files, shaders))
+		cout << "failed to write manifest '" << manifest_path << '\'' << endl;
 
+	cout << "done in " << chrono::duration<double, milli>(chrono::steady_clock::now() - start_time).count() << " ms" << endl;
 	return 0;
 }
@@ -1,13 +1,30 @@
 #include "package.h"
 
-#include <filesystem>
 #include <fstream>
+#include <filesystem>
+#include <map>
+#include <set>
+#include <tuple>
+#include <algorithm>
 #include <cstring>
+#include <limits>
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "compression.h"
 
 using namespace HopEngine;
 using namespace std;
 
 static Package* application_package = nullptr;
+// set on the io workers, so jobs can tell they mustn't wait on other jobs
+static thread_local bool on_io_worker = false;
 
 void Package::init()
 {
@@ -27,6 +44,7 @@ void Package::destroy()
 }
 
 constexpr uint32_t SIGNATURE = 0xCA55E77E;
+constexpr uint32_t PACKAGE_VERSION = 5;
 
 struct PackageHeader
 {
@@ -48,7 +66,48 @@ struct PackageDataHeader
 	size_t data_size;
 };
 
-// package file structure
+enum PackageCodec : uint32_t
+{
+	CODEC_NONE = 0,
+	CODEC_LZ4 = 1
+};
+
+struct PackageIndexHeader
+{
+	size_t index_offset;
+	size_t index_slots;
+};
+
+struct PackageTableEntry
+{
+	size_t name_offset;
+	size_t name_size;
+	size_t data_offset;
+	size_t data_size;
+	size_t stored_size;
+	uint32_t codec;
+	uint32_t flags;
+};
+
+enum PackageEntryFlags : uint32_t
+{
+	// part of the traced startup set, which is laid out at the start of the data in the order it is loaded
+	ENTRY_PREFETCH = 1
+};
+
+// prefetched entries closer together than this are read as one range
+constexpr size_t PREFETCH_GAP = 64 * 1024;
+
+// data blocks are aligned to at least this, so cooked data laid out for the GPU stays aligned once loaded.
+// packages can be built with a larger alignment (e.g. a page) so entries can be copied or read in whole pages
+constexpr size_t DATA_ALIGNMENT = 16;
+
+static inline size_t alignOffset(size_t offset, size_t alignment)
+{
+	return (offset + (alignment - 1)) & ~(alignment - 1);
+}
+
+// version 1 package file structure
 // PackageHeader
 // data table: array of PackageEntry
 //
@@ -56,89 +115,472 @@ struct PackageDataHeader
 // name
 // data
 // ...
+//
+// version 2 packages (a zipped version 1 package) are no longer supported
+//
+// version 5 package file structure (memory-mapped, uncompressed entries are used in place)
+// PackageHeader
+// PackageIndexHeader
+// data table: array of PackageTableEntry
+// index: power-of-two sized array of IndexSlot, open-addressed by identifier hash with linear probing
+// names
+// data, each block aligned to DATA_ALIGNMENT or more. compressed blocks take up stored_size bytes
+// and expand to data_size bytes, and are unpacked individually the first time they are requested.
+// entries flagged ENTRY_PREFETCH come first, and are read ahead when the package is loaded
+
+struct HopEngine::MappedFile
+{
+	const uint8_t* address = nullptr;
+	size_t size = 0;
+#if defined(_WIN32)
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = NULL;
+#else
+	int file = -1;
+#endif
+};
 
-bool Package::loadPackage(string load_path)
+static MappedFile* mapFile(const string& path)
+{
+	MappedFile* mapped = new MappedFile();
+#if defined(_WIN32)
+	mapped->file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL);
+	LARGE_INTEGER file_size{ };
+	if (mapped->file == INVALID_HANDLE_VALUE || !GetFileSizeEx(mapped->file, &file_size) || file_size.QuadPart == 0)
+	{
+		if (mapped->file != INVALID_HANDLE_VALUE)
+			CloseHandle(mapped->file);
+		delete mapped;
+		return nullptr;
+	}
+	mapped->size = (size_t)file_size.QuadPart;
+	mapped->mapping = CreateFileMappingA(mapped->file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapped->mapping != NULL)
+		mapped->address = (const uint8_t*)MapViewOfFile(mapped->mapping, FILE_MAP_READ, 0, 0, 0);
+	if (mapped->address == nullptr)
+	{
+		if (mapped->mapping != NULL)
+			CloseHandle(mapped->mapping);
+		CloseHandle(mapped->file);
+		delete mapped;
+		return nullptr;
+	}
+#else
+	mapped->file = open(path.c_str(), O_RDONLY);
+	struct stat file_stat{ };
+	if (mapped->file < 0 || fstat(mapped->file, &file_stat) != 0 || file_stat.st_size == 0)
+	{
+		if (mapped->file >= 0)
+			close(mapped->file);
+		delete mapped;
+		return nullptr;
+	}
+	mapped->size = (size_t)file_stat.st_size;
+	void* address = mmap(nullptr, mapped->size, PROT_READ, MAP_PRIVATE, mapped->file, 0);
+	if (address == MAP_FAILED)
+	{
+		close(mapped->file);
+		delete mapped;
+		return nullptr;
+	}
+	mapped->address = (const uint8_t*)address;
+	// entries are pulled in individually as they are requested, so don't let the kernel read ahead across the whole file
+	madvise(address, mapped->size, MADV_RANDOM);
+#endif
+	return mapped;
+}
+
+static void unmapFile(MappedFile* mapped)
+{
+	if (mapped == nullptr)
+		return;
+#if defined(_WIN32)
+	UnmapViewOfFile(mapped->address);
+	CloseHandle(mapped->mapping);
+	CloseHandle(mapped->file);
+#else
+	munmap((void*)mapped->address, mapped->size);
+	close(mapped->file);
+#endif
+	delete mapped;
+}
+
+// hint to the OS that a mapped range is about to be read in full
+static void prefetchMapped(DataView view)
+{
+	if (view.empty())
+		return;
+#if defined(_WIN32)
+	WIN32_MEMORY_RANGE_ENTRY range{ (PVOID)view.data(), view.size() };
+	PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+	static const size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+	size_t start = (size_t)view.data() & ~(page_size - 1);
+	size_t end = (size_t)view.data() + view.size();
+	madvise((void*)start, end - start, MADV_WILLNEED);
+#endif
+}
+
+// reads a mapped range in from disk, so that it's resident by the time it's used
+static void touchMapped(DataView view)
+{
+	prefetchMapped(view);
+	volatile uint8_t sink = 0;
+	for (size_t i = 0; i < view.size(); i += 4096)
+		sink = sink + view[i];
+}
+
+bool Package::loadPackage(string load_path, int priority)
 {
 	if (!application_package)
 		Package::init();
 
 	DBG_INFO("loading package: " + load_path);
-	ifstream file(load_path, ios::ate | ios::binary);
-	if (!file.is_open())
+	MappedFile* mapped = mapFile(load_path);
+	if (mapped == nullptr)
 	{
 		DBG_ERROR("failed to load package: " + load_path + "; file not accessible");
 		return false;
 	}
 
-	size_t size = (size_t)file.tellg();
-	vector<uint8_t> content(size);
-	file.seekg(0);
-	file.read((char*)(content.data()), size);
-	file.close();
+	if (!parsePackage(DataView(mapped->address, mapped->size), mapped, load_path, priority))
+	{
+		unmapFile(mapped);
+		return false;
+	}
+	return true;
+}
+
+// mounts a package which is already in memory (e.g. one compiled into the executable). the memory must stay valid,
+// and aligned to at least DATA_ALIGNMENT, for as long as the package is loaded
+bool Package::loadPackage(DataView content, string name, int priority)
+{
+	if (!application_package)
+		Package::init();
 
-	if (size < sizeof(PackageHeader))
+	DBG_INFO("loading package: " + name + " from memory");
+	if (((size_t)content.data() & (DATA_ALIGNMENT - 1)) != 0)
+	{
+		DBG_ERROR("failed to load package: " + name + "; data is misaligned");
+		return false;
+	}
+	return parsePackage(content, nullptr, name, priority);
+}
+
+// views into an unloaded package become invalid, so it must only be unloaded once nothing is using its data
+bool Package::unloadPackage(string load_path)
+{
+	if (!application_package)
+		return false;
+
+	Source* source = nullptr;
+	{
+		unique_lock lock(application_package->sources_mutex);
+		auto source_it = find_if(application_package->sources.begin(), application_package->sources.end(), [&load_path](Source* s) { return !s->writable && s->path == load_path; });
+		if (source_it == application_package->sources.end())
+		{
+			DBG_WARNING("failed to unload package: " + load_path + "; package not loaded");
+			return false;
+		}
+		source = *source_it;
+		application_package->sources.erase(source_it);
+	}
+
+	unmapFile(source->mapped);
+	delete source;
+	DBG_INFO("unloaded package: " + load_path);
+	return true;
+}
+
+// dependency graph format: one line for each resource with dependencies, holding its identifier followed by the
+// identifiers of everything it loads directly, separated by tabs
+static map<string_view, vector<string_view>> parseDependencies(DataView graph)
+{
+	map<string_view, vector<string_view>> dependencies;
+	string_view remaining((const char*)graph.data(), graph.size());
+	while (!remaining.empty())
+	{
+		size_t line_end = remaining.find('\n');
+		string_view line = remaining.substr(0, line_end);
+		remaining = (line_end == string_view::npos) ? string_view() : remaining.substr(line_end + 1);
+
+		size_t field_end = line.find('\t');
+		vector<string_view>& list = dependencies[line.substr(0, field_end)];
+		while (field_end != string_view::npos)
+		{
+			line = line.substr(field_end + 1);
+			field_end = line.find('\t');
+			list.push_back(line.substr(0, field_end));
+		}
+	}
+	return dependencies;
+}
+
+// must be called with the sources lock held exclusively, or before the source is added to the stack
+void Package::loadDependencies(Source* source)
+{
+	source->dependencies.clear();
+	source->dependency_data.clear();
+	Entry* entry = findEntry(source, hashIdentifier(dependencies_identifier), dependencies_identifier);
+	if (entry == nullptr || entry->removed)
+		return;
+
+	// the graph is copied out of the entry, so compressed packages don't keep an unpacked copy of it as well
+	source->dependency_data.resize(entry->size);
+	if (!unpackEntryInto(*entry, source->dependency_data))
+	{
+		source->dependency_data.clear();
+		return;
+	}
+	source->dependencies = parseDependencies(DataView(source->dependency_data.data(), source->dependency_data.size()));
+}
+
+bool Package::parsePackage(DataView content, MappedFile* mapped, string load_path, int priority)
+{
+	if (content.size() < sizeof(PackageHeader))
 	{
 		DBG_ERROR("failed to load package: " + load_path + "; corrupted file");
 		return false;
 	}
 
-	PackageHeader header = *((PackageHeader*)content.data());
+	PackageHeader header;
+	memcpy(&header, content.data(), sizeof(PackageHeader));
 	if (header.signature != SIGNATURE)
 	{
 		DBG_ERROR("failed to load package: " + load_path + "; invalid signature");
 		return false;
 	}
-	if (header.file_size != size)
+	if (header.file_size != content.size())
 	{
 		DBG_ERROR("failed to load package: " + load_path + "; invalid file size");
 		return false;
 	}
-	if (header.version == 2)
+
+	// the source is only added to the package once the whole table has been validated
+	Source* source = new Source();
+	source->path = load_path;
+	if (header.version == 1)
 	{
-		content = loadCompressedPackage(content);
-		if (content.empty())
+		if (sizeof(PackageHeader) + (header.package_entries * sizeof(PackageEntry)) > content.size())
 		{
-			DBG_ERROR("failed to load package: " + load_path + "; error during decompression");
+			DBG_ERROR("failed to load package: " + load_path + "; corrupted data table");
+			delete source;
 			return false;
 		}
+
+		// version 1 packages don't carry an index, so one has to be built here
+		vector<uint64_t> hashes;
+		hashes.reserve(header.package_entries);
+		for (size_t i = 0; i < header.package_entries; ++i)
+		{
+			PackageEntry entry;
+			memcpy(&entry, content.data() + sizeof(PackageHeader) + (i * sizeof(PackageEntry)), sizeof(PackageEntry));
+			PackageDataHeader data_header;
+			if (entry.data_header_offset + sizeof(PackageDataHeader) > content.size())
+			{
+				DBG_ERROR("error loading package: " + load_path + "; invalid data entry offset");
+				delete source;
+				return false;
+			}
+			memcpy(&data_header, content.data() + entry.data_header_offset, sizeof(PackageDataHeader));
+			if (data_header.data_size + data_header.name_size + sizeof(PackageDataHeader) != entry.data_total_size
+				|| entry.data_header_offset + entry.data_total_size > content.size())
+			{
+				DBG_ERROR("error loading package: " + load_path + "; invalid data entry size");
+				delete source;
+				return false;
+			}
+			Entry& stored = source->entries.emplace_back();
+			stored.name = string_view((const char*)(content.data() + entry.data_header_offset + sizeof(PackageDataHeader)), data_header.name_size);
+			stored.stored = content.subspan(entry.data_header_offset + sizeof(PackageDataHeader) + data_header.name_size, data_header.data_size);
+			stored.size = data_header.data_size;
+			stored.codec = CODEC_NONE;
+			stored.mapped = mapped != nullptr;
+			hashes.push_back(hashIdentifier(stored.name));
+		}
+		source->owned_index = buildIndex(hashes);
+		source->index = source->owned_index;
 	}
-	else if (header.version != 1)
+	else if (header.version == PACKAGE_VERSION)
+	{
+		PackageIndexHeader index_header;
+		size_t table_offset = sizeof(PackageHeader) + sizeof(PackageIndexHeader);
+		if (table_offset > content.size())
+		{
+			DBG_ERROR("failed to load package: " + load_path + "; corrupted file");
+			delete source;
+			return false;
+		}
+		memcpy(&index_header, content.data() + sizeof(PackageHeader), sizeof(PackageIndexHeader));
+		if (table_offset + (header.package_entries * sizeof(PackageTableEntry)) > content.size()
+			|| index_header.index_offset + (index_header.index_slots * sizeof(IndexSlot)) > content.size()
+			|| index_header.index_offset % alignof(IndexSlot) != 0
+			|| (index_header.index_slots & (index_header.index_slots - 1)) != 0
+			|| index_header.index_slots < header.package_entries)
+		{
+			DBG_ERROR("failed to load package: " + load_path + "; corrupted data table");
+			delete source;
+			return false;
+		}
+
+		// duplicated blocks are stored once, so entries which point at the same compressed block share one unpacked copy
+		map<size_t, Entry*> compressed_blocks;
+		vector<pair<size_t, size_t>> prefetch_ranges;
+		for (size_t i = 0; i < header.package_entries; ++i)
+		{
+			PackageTableEntry entry;
+			memcpy(&entry, content.data() + table_offset + (i * sizeof(PackageTableEntry)), sizeof(PackageTableEntry));
+			if (entry.name_offset + entry.name_size > content.size() || entry.data_offset + entry.stored_size > content.size()
+				|| (entry.codec == CODEC_NONE && entry.stored_size != entry.data_size) || entry.codec > CODEC_LZ4)
+			{
+				DBG_ERROR("error loading package: " + load_path + "; invalid data entry");
+				delete source;
+				return false;
+			}
+			Entry& stored = source->entries.emplace_back();
+			stored.name = string_view((const char*)content.data() + entry.name_offset, entry.name_size);
+			stored.stored = content.subspan(entry.data_offset, entry.stored_size);
+			stored.size = entry.data_size;
+			stored.codec = entry.codec;
+			if (stored.codec != CODEC_NONE)
+			{
+				stored.unpack_flag = make_unique<once_flag>();
+				source->compressed = true;
+				auto block = compressed_blocks.insert({ entry.data_offset, &stored });
+				if (!block.second && block.first->second->stored.size() == stored.stored.size() && block.first->second->size == stored.size)
+					stored.shared = block.first->second;
+			}
+			stored.mapped = mapped != nullptr;
+			if (entry.flags & ENTRY_PREFETCH)
+				prefetch_ranges.push_back({ entry.data_offset, entry.data_offset + entry.stored_size });
+		}
+		// the index is used directly from the file
+		source->index = span<const IndexSlot>((const IndexSlot*)(content.data() + index_header.index_offset), index_header.index_slots);
+		for (const IndexSlot& slot : source->index)
+		{
+			if (slot.entry > header.package_entries)
+			{
+				DBG_ERROR("failed to load package: " + load_path + "; corrupted index");
+				delete source;
+				return false;
+			}
+		}
+
+		// the startup set is laid out in the order it is loaded, so it can be read ahead sequentially before it is asked for
+		if (mapped != nullptr && !prefetch_ranges.empty())
+		{
+			sort(prefetch_ranges.begin(), prefetch_ranges.end());
+			size_t prefetched = 0;
+			pair<size_t, size_t> range = prefetch_ranges[0];
+			for (const auto& next : prefetch_ranges)
+			{
+				if (next.first > range.second + PREFETCH_GAP)
+				{
+					prefetchMapped(content.subspan(range.first, range.second - range.first));
+					prefetched += range.second - range.first;
+					range = next;
+				}
+				else
+					range.second = max(range.second, next.second);
+			}
+			prefetchMapped(content.subspan(range.first, range.second - range.first));
+			prefetched += range.second - range.first;
+			DBG_INFO("prefetching " + to_string(prefetch_ranges.size()) + " entries (" + to_string(prefetched) + " bytes) from package: " + load_path);
+		}
+	}
+	else
 	{
 		DBG_ERROR("failed to load package: " + load_path + "; invalid version");
+		delete source;
 		return false;
 	}
 
-	header = *((PackageHeader*)content.data());
-
-	vector<PackageEntry> entries(header.package_entries);
-	memcpy(entries.data(), content.data() + sizeof(PackageHeader), sizeof(PackageEntry) * entries.size());
-
-	for (PackageEntry& entry : entries)
+	source->mapped = mapped;
+	loadDependencies(source);
+	// the top priority is reserved for runtime data
+	source->priority = min(priority, numeric_limits<int>::max() - 1);
 	{
-		PackageDataHeader data_header = *((PackageDataHeader*)(content.data() + entry.data_header_offset));
-		if (data_header.data_size + data_header.name_size + sizeof(PackageDataHeader) != entry.data_total_size)
-		{
-			DBG_ERROR("error loading package: " + load_path + "; invalid data entry size");
-			return false;
-		}
-		string name(data_header.name_size, ' ');
-		memcpy((char*)(name.data()), (content.data() + entry.data_header_offset + sizeof(PackageDataHeader)), name.size());
-		vector<uint8_t> data(data_header.data_size);
-		memcpy(data.data(), (content.data() + entry.data_header_offset + sizeof(PackageDataHeader) + name.size()), data.size());
-		application_package->database[name] = data;
+		unique_lock lock(application_package->sources_mutex);
+		auto position = upper_bound(application_package->sources.begin(), application_package->sources.end(), source->priority, [](int p, Source* s) { return p < s->priority; });
+		application_package->sources.insert(position, source);
 	}
 
-	DBG_INFO("loaded " + to_string(header.package_entries) + " items from package: " + load_path);
+	DBG_INFO("loaded " + to_string(header.package_entries) + " items from package: " + load_path + " with priority " + to_string(source->priority));
 	return true;
 }
 
-bool Package::storePackage(string store_path)
+// entries named in layout_order are laid out first, in that order, and flagged to be prefetched when the package is loaded.
+// alignment must be a power of two, and is raised to DATA_ALIGNMENT if it's smaller
+bool Package::storePackage(string store_path, const vector<string>& layout_order, size_t alignment)
+{
+	return writePackage(store_path, false, layout_order, alignment);
+}
+
+bool Package::storeCompressedPackage(string store_path, const vector<string>& layout_order, size_t alignment)
+{
+	return writePackage(store_path, true, layout_order, alignment);
+}
+
+bool Package::writePackage(string store_path, bool compressed, const vector<string>& layout_order, size_t alignment)
 {
 	if (!application_package)
 		Package::init();
 
-	DBG_INFO("storing package: " + store_path);
-	ofstream file(store_path, ios::binary);
+	if ((alignment & (alignment - 1)) != 0)
+	{
+		DBG_ERROR("failed to store package: " + store_path + "; alignment must be a power of two");
+		return false;
+	}
+	alignment = max(alignment, DATA_ALIGNMENT);
+
+	DBG_INFO("storing " + string(compressed ? "compressed " : "") + "package: " + store_path);
+	shared_lock lock(application_package->sources_mutex);
+
+	// collect every visible entry, letting later sources override earlier ones
+	map<string_view, pair<Source*, Entry*>> visible;
+	for (auto source_it = application_package->sources.rbegin(); source_it != application_package->sources.rend(); ++source_it)
+	{
+		for (Entry& entry : (*source_it)->entries)
+		{
+			if (!entry.replaced)
+				visible.insert({ entry.name, { *source_it, &entry } });
+		}
+	}
+	erase_if(visible, [](const auto& pair) { return pair.second.second->removed; });
+
+	// the traced startup set goes first, followed by everything else in alphabetical order
+	vector<pair<string_view, pair<Source*, Entry*>>> ordered;
+	ordered.reserve(visible.size());
+	for (const string& identifier : layout_order)
+	{
+		auto visible_it = visible.find(identifier);
+		if (visible_it == visible.end())
+			continue;
+		ordered.push_back(*visible_it);
+		visible.erase(visible_it);
+	}
+	const size_t prefetch_count = ordered.size();
+	for (const auto& pair : visible)
+		ordered.push_back(pair);
+
+	vector<uint64_t> hashes;
+	hashes.reserve(ordered.size());
+	map<uint64_t, string_view> seen_hashes;
+	for (const auto& pair : ordered)
+	{
+		uint64_t hash = hashIdentifier(pair.first);
+		auto inserted = seen_hashes.insert({ hash, pair.first });
+		if (!inserted.second)
+		{
+			DBG_ERROR("failed to store package: " + store_path + "; identifiers '" + string(inserted.first->second) + "' and '" + string(pair.first) + "' have the same hash");
+			return false;
+		}
+		hashes.push_back(hash);
+	}
+	vector<IndexSlot> index = buildIndex(hashes);
+
+	// opened for reading as well, so that blocks which look like duplicates can be checked against what was written
+	fstream file(store_path, ios::binary | ios::in | ios::out | ios::trunc);
 	if (!file.is_open())
 	{
 		DBG_ERROR("failed to store package: " + store_path + "; file not accessible");
@@ -147,262 +589,675 @@ bool Package::storePackage(string store_path)
 
 	PackageHeader header;
 	header.signature = SIGNATURE;
-	header.package_entries = application_package->database.size();
-	header.version = 1;
+	header.package_entries = ordered.size();
+	header.version = PACKAGE_VERSION;
 
-	vector<PackageEntry> entries;
-	vector<vector<uint8_t>> data_blocks;
-	size_t offset = sizeof(PackageHeader) + (application_package->database.size() * sizeof(PackageEntry));
-	for (auto pair : application_package->database)
+	// the table, index and names only depend on the identifiers, so they can be laid out before any data is packed
+	vector<PackageTableEntry> entries(ordered.size(), PackageTableEntry{ });
+	PackageIndexHeader index_header;
+	size_t offset = sizeof(PackageHeader) + sizeof(PackageIndexHeader) + (entries.size() * sizeof(PackageTableEntry));
+	index_header.index_offset = offset;
+	index_header.index_slots = index.size();
+	offset += index.size() * sizeof(IndexSlot);
+	for (size_t i = 0; i < ordered.size(); ++i)
 	{
-		PackageDataHeader data_header;
-		data_header.name_size = pair.first.size();
-		data_header.data_size = pair.second.size();
-		vector<uint8_t> data_block(sizeof(PackageDataHeader) + data_header.name_size + data_header.data_size);
-		memcpy(data_block.data(), &data_header, sizeof(PackageDataHeader));
-		memcpy(data_block.data() + sizeof(PackageDataHeader), pair.first.data(), data_header.name_size);
-		memcpy(data_block.data() + sizeof(PackageDataHeader) + data_header.name_size, pair.second.data(), data_header.data_size);
-		data_blocks.push_back(data_block);
+		entries[i].name_offset = offset;
+		entries[i].name_size = ordered[i].first.size();
+		entries[i].flags = i < prefetch_count ? (uint32_t)ENTRY_PREFETCH : 0;
+		offset += ordered[i].first.size();
+	}
 
-		PackageEntry entry;
-		entry.data_total_size = data_block.size();
-		entry.data_header_offset = offset;
-		entries.push_back(entry);
+	// the header and table are written again once the data offsets are known
+	file.write((char*)(&header), sizeof(PackageHeader));
+	file.write((char*)(&index_header), sizeof(PackageIndexHeader));
+	file.write((char*)entries.data(), entries.size() * sizeof(PackageTableEntry));
+	file.write((char*)index.data(), index.size() * sizeof(IndexSlot));
+	for (const auto& pair : ordered)
+		file.write(pair.first.data(), pair.first.size());
 
-		offset += entry.data_total_size;
-	}
+	// entries are packed on the worker threads a window at a time and streamed out in order, so only the
+	// window is ever held in memory. blocks that are already in the right form in a loaded package are copied as they are
+	struct PackedBlock
+	{
+		DataView data;
+		vector<uint8_t> owned;
+		size_t size = 0;
+		uint32_t codec = CODEC_NONE;
+		uint64_t hash = 0;
+	};
+	auto pack = [compressed](Source* source, Entry* entry)
+	{
+		PackedBlock block;
+		block.size = entry->size;
+		if (compressed && (entry->codec != CODEC_NONE || source->compressed))
+		{
+			// already compressed, or previously found not to compress
+			block.data = entry->stored;
+			block.codec = entry->codec;
+		}
+		else
+		{
+			if (entry->codec == CODEC_NONE)
+				block.data = unpackEntry(*entry);
+			else
+			{
+				// unpacked into the block rather than the entry, so that it's freed once the block is written
+				block.owned.resize(entry->size);
+				if (!unpackEntryInto(*entry, block.owned))
+					block.owned.clear();
+				block.data = DataView(block.owned.data(), block.owned.size());
+			}
+			if (compressed)
+			{
+				// keep the original if compression doesn't help (e.g. for PNGs)
+				vector<uint8_t> compressed_data = Compression::compress(block.data);
+				if (compressed_data.size() < block.data.size())
+				{
+					block.codec = CODEC_LZ4;
+					block.owned = std::move(compressed_data);
+					block.data = DataView(block.owned.data(), block.owned.size());
+				}
+			}
+		}
+		block.hash = hashIdentifier(string_view((const char*)block.data.data(), block.data.size()));
+		return block;
+	};
+
+	// blocks are content-addressed, so identical payloads under different identifiers are only written once
+	map<tuple<uint64_t, size_t, uint32_t, size_t>, size_t> written_blocks;
+	vector<uint8_t> existing_block;
+	size_t shared_entries = 0;
+	size_t total_shared = 0;
 
+	// blocks are packed on threads of their own rather than on the io workers. the sources lock is held for the
+	// whole write, and io jobs waiting to take it could otherwise stand in front of the blocks this is waiting for
+	const size_t packer_count = max(thread::hardware_concurrency(), 1u);
+	const size_t window = packer_count * 4;
+	vector<unique_ptr<PackedBlock>> packed(ordered.size());
+	mutex packed_mutex;
+	condition_variable packed_condition;
+	size_t next_packed = 0;
+	size_t next_written = 0;
+	auto packer = [&]()
+	{
+		unique_lock lock(packed_mutex);
+		while (true)
+		{
+			packed_condition.wait(lock, [&]() { return next_packed >= ordered.size() || next_packed < next_written + window; });
+			if (next_packed >= ordered.size())
+				return;
+			size_t i = next_packed++;
+			lock.unlock();
+			auto block = make_unique<PackedBlock>(pack(ordered[i].second.first, ordered[i].second.second));
+			lock.lock();
+			packed[i] = std::move(block);
+			packed_condition.notify_all();
+		}
+	};
+	vector<thread> packers;
+	for (size_t i = 0; i < min(packer_count, ordered.size()); ++i)
+		packers.emplace_back(packer);
+
+	const vector<char> padding(alignment, 0);
+	size_t total_size = 0;
+	size_t total_stored = 0;
+	for (size_t i = 0; i < ordered.size(); ++i)
+	{
+		unique_ptr<PackedBlock> packed_block;
+		{
+			unique_lock lock(packed_mutex);
+			packed_condition.wait(lock, [&]() { return packed[i] != nullptr; });
+			packed_block = std::move(packed[i]);
+			next_written = i + 1;
+		}
+		packed_condition.notify_all();
+		PackedBlock& block = *packed_block;
+
+		auto written = written_blocks.insert({ { block.hash, block.data.size(), block.codec, block.size }, i });
+		if (!written.second)
+		{
+			const PackageTableEntry& original = entries[written.first->second];
+			existing_block.resize(original.stored_size);
+			file.seekg(original.data_offset);
+			file.read((char*)existing_block.data(), existing_block.size());
+			file.seekp(offset);
+			if (memcmp(existing_block.data(), block.data.data(), block.data.size()) == 0)
+			{
+				entries[i].data_offset = original.data_offset;
+				entries[i].data_size = original.data_size;
+				entries[i].stored_size = original.stored_size;
+				entries[i].codec = original.codec;
+				total_size += block.size;
+				total_shared += block.data.size();
+				++shared_entries;
+				continue;
+			}
+		}
+
+		offset = alignOffset(offset, alignment);
+		file.write(padding.data(), offset - (size_t)file.tellp());
+		file.write((char*)(block.data.data()), block.data.size());
+
+		entries[i].data_offset = offset;
+		entries[i].data_size = block.size;
+		entries[i].stored_size = block.data.size();
+		entries[i].codec = block.codec;
+		offset += block.data.size();
+		total_size += block.size;
+		total_stored += block.data.size();
+	}
+	for (thread& packer_thread : packers)
+		packer_thread.join();
 	header.file_size = offset;
+
+	file.seekp(0);
 	file.write((char*)(&header), sizeof(PackageHeader));
-	file.write((char*)entries.data(), entries.size() * sizeof(PackageEntry));
-	for (const vector<uint8_t>& data_block : data_blocks)
-		file.write((char*)(data_block.data()), data_block.size());
+	file.write((char*)(&index_header), sizeof(PackageIndexHeader));
+	file.write((char*)entries.data(), entries.size() * sizeof(PackageTableEntry));
 	file.close();
+	if (file.fail())
+	{
+		DBG_ERROR("failed to store package: " + store_path + "; write failed");
+		return false;
+	}
 
-	DBG_INFO("stored " + to_string(header.package_entries) + " items to package: " + store_path);
+	DBG_INFO("stored " + to_string(header.package_entries) + " items to package: " + store_path + " (" + to_string(total_stored) + " of " + to_string(total_size) + " bytes, "
+		+ to_string(shared_entries) + " duplicates sharing " + to_string(total_shared) + " bytes, " + to_string(prefetch_count) + " laid out for prefetch)");
 	return true;
 }
 
-bool Package::storeCompressedPackage(string store_path)
+DataView Package::unpackEntry(Entry& entry)
 {
-	if (!application_package)
-		Package::init();
-
-	DBG_INFO("storing compressed package: " + store_path);
-	if (!storePackage(store_path))
+	if (entry.codec == CODEC_NONE)
 	{
-		DBG_ERROR("failed to generate version 1 package: " + store_path);
-		return false;
+		if (entry.mapped)
+			prefetchMapped(entry.stored);
+		return entry.stored;
 	}
 
-	string command = "zip -r ";
-#if defined(_WIN32)
-	command = "tar.exe -a -c -f ";
-#endif
+	if (entry.shared != nullptr)
+		return unpackEntry(*entry.shared);
 
-	string temp_address = Package::getTempPath() + "hop_package_tmp.zip";
-	filesystem::create_directories(Package::getTempPath());
-	command = command + temp_address + ' ' + store_path;
-	string output;
+	// each entry is unpacked at most once, but different entries can be unpacked on different threads at the same time
+	call_once(*entry.unpack_flag, [&entry]()
+	{
+		if (entry.mapped)
+			prefetchMapped(entry.stored);
+		entry.owned.resize(entry.size);
+		if (!Compression::decompress(entry.stored, entry.owned.data(), entry.owned.size()))
+		{
+			DBG_ERROR("failed to decompress package entry; data is corrupted");
+			entry.owned.clear();
+		}
+	});
+	return DataView(entry.owned.data(), entry.owned.size());
+}
+
+// copies or decompresses an entry straight into destination, which must be exactly the size of the data. nothing is kept
+// around afterwards, so this suits data which is only read to fill another buffer (e.g. mapped staging memory)
+bool Package::unpackEntryInto(Entry& entry, span<uint8_t> destination)
+{
+	if (destination.size() != entry.size)
+		return false;
+	if (entry.shared != nullptr)
+		return unpackEntryInto(*entry.shared, destination);
 
-	int result = exec(command, output);
-	if (result != 0)
+	if (entry.mapped)
+		prefetchMapped(entry.stored);
+	if (entry.codec == CODEC_NONE)
 	{
-		DBG_ERROR("error compressing package: " + store_path + "; " + output);
+		memcpy(destination.data(), entry.stored.data(), entry.size);
+		return true;
+	}
+	if (!Compression::decompress(entry.stored, destination.data(), destination.size()))
+	{
+		DBG_ERROR("failed to decompress package entry; data is corrupted");
 		return false;
 	}
+	return true;
+}
 
-	ifstream file(temp_address, ios::ate | ios::binary);
-	if (!file.is_open())
-	{
-		filesystem::remove(temp_address);
-		DBG_ERROR("failed to generate compressed package: " + store_path + "; unable to open zip file");
+// fills destination with the first bytes of an entry. entries shorter than destination fail
+bool Package::peekEntry(Entry& entry, span<uint8_t> destination)
+{
+	if (destination.size() > entry.size)
 		return false;
+	if (entry.shared != nullptr)
+		return peekEntry(*entry.shared, destination);
+
+	if (entry.codec == CODEC_NONE)
+	{
+		memcpy(destination.data(), entry.stored.data(), destination.size());
+		return true;
 	}
+	return Compression::decompressPrefix(entry.stored, destination.data(), destination.size());
+}
 
-	size_t size = (size_t)file.tellg();
-	vector<uint8_t> content(size);
-	file.seekg(0);
-	file.read((char*)(content.data()), size);
-	file.close();
-	filesystem::remove(temp_address);
+DataView Package::loadData(string_view identifier)
+{
+	if (!application_package)
+		Package::init();
 
-	PackageHeader header;
-	header.signature = SIGNATURE;
-	header.package_entries = 0;
-	header.file_size = sizeof(PackageHeader) + size;
-	header.version = 2;
+	DBG_VERBOSE("loading '" + string(identifier) + "'");
+	// entries are never moved once added, so unpacking can happen outside the lock
+	Entry* entry = findVisibleEntry(hashIdentifier(identifier), identifier);
+	if (entry != nullptr)
+	{
+		traceEntry(entry);
+		return unpackEntry(*entry);
+	}
+	DBG_WARNING("found no data associated with '" + string(identifier) + "'");
+	return { };
+}
+
+DataView Package::loadData(ResId identifier)
+{
+	if (!application_package)
+		Package::init();
 
-	ofstream outfile(store_path, ios::binary);
-	if (!outfile.is_open())
+	Entry* entry = findVisibleEntry(identifier.hash);
+	if (entry != nullptr)
 	{
-		DBG_ERROR("failed to generate compressed package: " + store_path + "; file not accessible");
-		return false;
+		traceEntry(entry);
+		return unpackEntry(*entry);
 	}
-	outfile.write((char*)(&header), sizeof(PackageHeader));
-	outfile.write((char*)(content.data()), content.size());
-	outfile.close();
+	DBG_WARNING("found no data associated with '" + identifier.getPath() + "'");
+	return { };
+}
 
-	DBG_INFO("stored compressed package: " + store_path);
-	return true;
+bool Package::hasData(string_view identifier)
+{
+	if (!application_package)
+		Package::init();
+
+	return findVisibleEntry(hashIdentifier(identifier), identifier) != nullptr;
 }
 
-vector<uint8_t> Package::loadCompressedPackage(vector<uint8_t> data)
+bool Package::hasData(ResId identifier)
 {
 	if (!application_package)
 		Package::init();
 
-	PackageHeader header = *((PackageHeader*)data.data());
-	DBG_INFO("loading compressed package");
+	return findVisibleEntry(identifier.hash) != nullptr;
+}
 
-	if (header.signature != SIGNATURE)
+// returns zero if there is no data with this identifier
+size_t Package::getDataSize(string_view identifier)
+{
+	if (!application_package)
+		Package::init();
+
+	Entry* entry = findVisibleEntry(hashIdentifier(identifier), identifier);
+	return entry != nullptr ? entry->size : 0;
+}
+
+size_t Package::getDataSize(ResId identifier)
+{
+	if (!application_package)
+		Package::init();
+
+	Entry* entry = findVisibleEntry(identifier.hash);
+	return entry != nullptr ? entry->size : 0;
+}
+
+bool Package::unpackDataInto(string_view identifier, span<uint8_t> destination)
+{
+	if (!application_package)
+		Package::init();
+
+	DBG_VERBOSE("unpacking '" + string(identifier) + "'");
+	Entry* entry = findVisibleEntry(hashIdentifier(identifier), identifier);
+	if (entry == nullptr)
 	{
-		DBG_ERROR("failed to load compressed package; invalid signature");
-		return { };
+		DBG_WARNING("found no data associated with '" + string(identifier) + "'");
+		return false;
 	}
-	if (header.file_size != data.size())
+	traceEntry(entry);
+	return unpackEntryInto(*entry, destination);
+}
+
+bool Package::unpackDataInto(ResId identifier, span<uint8_t> destination)
+{
+	if (!application_package)
+		Package::init();
+
+	Entry* entry = findVisibleEntry(identifier.hash);
+	if (entry == nullptr)
 	{
-		DBG_ERROR("failed to load compressed package; invalid file size");
-		return { };
+		DBG_WARNING("found no data associated with '" + identifier.getPath() + "'");
+		return false;
 	}
-	if (header.version != 2)
+	traceEntry(entry);
+	return unpackEntryInto(*entry, destination);
+}
+
+bool Package::peekData(string_view identifier, span<uint8_t> destination)
+{
+	if (!application_package)
+		Package::init();
+
+	Entry* entry = findVisibleEntry(hashIdentifier(identifier), identifier);
+	return entry != nullptr && peekEntry(*entry, destination);
+}
+
+bool Package::peekData(ResId identifier, span<uint8_t> destination)
+{
+	if (!application_package)
+		Package::init();
+
+	Entry* entry = findVisibleEntry(identifier.hash);
+	return entry != nullptr && peekEntry(*entry, destination);
+}
+
+void Package::storeData(string identifier, vector<uint8_t> data)
+{
+	if (!application_package)
+		Package::init();
+
+	DBG_VERBOSE("storing '" + identifier + "'; " + to_string(data.size()) + " bytes");
+	unique_lock lock(application_package->sources_mutex);
+
+	bool is_dependencies = identifier == dependencies_identifier;
+	Entry* entry = insertEntry(std::move(identifier));
+	if (entry == nullptr)
+		return;
+	entry->owned = std::move(data);
+	entry->stored = DataView(entry->owned.data(), entry->owned.size());
+	entry->size = entry->owned.size();
+	entry->codec = CODEC_NONE;
+	entry->mapped = false;
+	entry->removed = false;
+	if (is_dependencies)
+		loadDependencies(application_package->sources.back());
+}
+
+void Package::removeData(string identifier)
+{
+	if (!application_package)
+		Package::init();
+
+	DBG_VERBOSE("removing '" + identifier + "'");
+	unique_lock lock(application_package->sources_mutex);
+
+	// entries in loaded packages can't be taken out, so the removal is recorded on top of them instead
+	bool is_dependencies = identifier == dependencies_identifier;
+	Entry* entry = insertEntry(std::move(identifier));
+	if (entry == nullptr)
+		return;
+	entry->owned.clear();
+	entry->stored = { };
+	entry->size = 0;
+	entry->codec = CODEC_NONE;
+	entry->mapped = false;
+	entry->removed = true;
+	if (is_dependencies)
+		loadDependencies(application_package->sources.back());
+}
+
+// must be called with the sources lock held exclusively
+Package::Entry* Package::insertEntry(string identifier)
+{
+	// runtime data goes into a writable source on top of the stack, so it overrides anything loaded before it
+	if (application_package->sources.empty() || !application_package->sources.back()->writable)
 	{
-		DBG_ERROR("failed to load compressed package; invalid version");
-		return { };
+		Source* source = new Source();
+		source->path = "<runtime>";
+		source->priority = numeric_limits<int>::max();
+		source->writable = true;
+		application_package->sources.push_back(source);
 	}
+	Source* source = application_package->sources.back();
 
-	string temp_address = Package::getTempPath() + "hop_package_tmp.zip";
-	filesystem::create_directories(Package::getTempPath());
-	ofstream file(temp_address, ios::binary);
-	if (!file.is_open())
+	uint64_t hash = hashIdentifier(identifier);
+	Entry* existing = findEntry(source, hash, identifier);
+	if (existing == nullptr)
 	{
-		DBG_ERROR("error decompressing package; file not accessible");
-		return { };
+		Entry* colliding = findEntry(source, hash);
+		if (colliding != nullptr)
+		{
+			// resource ids are matched on their hash alone, so two names with the same hash can't coexist
+			DBG_ERROR("failed to store '" + identifier + "'; identifier hash collides with '" + string(colliding->name) + "'");
+			return nullptr;
+		}
 	}
-	file.write((char*)(data.data()) + sizeof(PackageHeader), header.file_size - sizeof(PackageHeader));
-	file.close();
 
-	string command = "unzip ";
-#if defined(_WIN32)
-	command = "tar.exe -x -f ";
-#endif
-	
-	string unpack_dir = Package::getTempPath() + "hop";
-	filesystem::create_directory(unpack_dir);
-	command = command + temp_address + 
-#if defined(_WIN32)
-" -C "
-#else
-" -d "
-#endif
-	 + unpack_dir;
-	string output;
+	// an identifier which is stored again gets a fresh entry, since other threads may still be reading the old one
+	// or holding views into it. the old entry is kept until the package is destroyed, but is taken out of the index
+	Entry* entry = &source->entries.emplace_back();
+	uint32_t position = (uint32_t)source->entries.size();
+	if (existing != nullptr)
+	{
+		entry->name = existing->name;
+		existing->replaced = true;
+	}
+	else
+		entry->name = source->names.emplace_back(std::move(identifier));
 
-	int result = exec(command, output);
-	filesystem::remove(temp_address);
-	if (result != 0)
+	if ((source->entries.size() * 2) > source->owned_index.size())
 	{
-		DBG_ERROR("error decompressing package; " + output);
-		return { };
+		size_t slot_count = 16;
+		while (slot_count < source->entries.size() * 2)
+			slot_count *= 2;
+		source->owned_index.assign(slot_count, IndexSlot{ 0, 0, 0 });
+		for (size_t i = 0; i < source->entries.size(); ++i)
+		{
+			if (!source->entries[i].replaced)
+				insertIndexSlot(source->owned_index, hashIdentifier(source->entries[i].name), (uint32_t)(i + 1));
+		}
+		source->index = source->owned_index;
+	}
+	else if (existing != nullptr)
+	{
+		size_t mask = source->owned_index.size() - 1;
+		size_t slot = hash & mask;
+		while (&source->entries[source->owned_index[slot].entry - 1] != existing)
+			slot = (slot + 1) & mask;
+		source->owned_index[slot].entry = position;
 	}
+	else
+		insertIndexSlot(source->owned_index, hash, position);
+	return entry;
+}
+
+void Package::insertIndexSlot(vector<IndexSlot>& index, uint64_t hash, uint32_t entry)
+{
+	size_t mask = index.size() - 1;
+	size_t slot = hash & mask;
+	while (index[slot].entry != 0)
+		slot = (slot + 1) & mask;
+	index[slot] = { hash, entry, 0 };
+}
+
+// an empty identifier matches on the hash alone
+Package::Entry* Package::findEntry(Source* source, uint64_t hash, string_view identifier)
+{
+	if (source->index.empty())
+		return nullptr;
 
-	auto it = filesystem::directory_iterator(unpack_dir);
-	if (!it->exists())
+	size_t mask = source->index.size() - 1;
+	size_t slot = hash & mask;
+	for (size_t probes = 0; probes < source->index.size(); ++probes)
 	{
-		DBG_ERROR("error decompressing package; no package file found");
-		filesystem::remove(unpack_dir);
-		return { };
+		const IndexSlot& candidate = source->index[slot];
+		if (candidate.entry == 0)
+			return nullptr;
+		if (candidate.hash == hash)
+		{
+			Entry& entry = source->entries[candidate.entry - 1];
+			if (identifier.empty() || entry.name == identifier)
+				return &entry;
+		}
+		slot = (slot + 1) & mask;
 	}
+	return nullptr;
+}
 
-	ifstream infile(it->path().string(), ios::ate | ios::binary);
-	if (!infile.is_open())
+// searches every source from the top down, ignoring entries which have been removed
+Package::Entry* Package::findVisibleEntry(uint64_t hash, string_view identifier)
+{
+	shared_lock lock(application_package->sources_mutex);
+	for (auto source_it = application_package->sources.rbegin(); source_it != application_package->sources.rend(); ++source_it)
 	{
-		DBG_ERROR("error decompressing package; file not accessible");
-		filesystem::remove(unpack_dir);
-		return { };
+		Entry* entry = findEntry(*source_it, hash, identifier);
+		if (entry != nullptr)
+			return entry->removed ? nullptr : entry;
 	}
-	size_t size = (size_t)infile.tellg();
-	vector<uint8_t> content(size);
-	infile.seekg(0);
-	infile.read((char*)(content.data()), size);
-	infile.close();
-	filesystem::remove_all(unpack_dir);
+	return nullptr;
+}
 
-	header = *((PackageHeader*)content.data());
-	if (header.signature != SIGNATURE)
+void Package::startTrace()
+{
+	if (!application_package)
+		Package::init();
+
+	DBG_INFO("tracing package loads");
+	application_package->tracing = true;
+}
+
+// trace format: one identifier per line, in the order they were first loaded
+bool Package::storeTrace(string store_path)
+{
+	if (!application_package)
+		return false;
+
+	lock_guard lock(application_package->trace_mutex);
+	ofstream file(store_path);
+	if (!file.is_open())
 	{
-		DBG_ERROR("failed to load package; invalid signature");
-		return { };
+		DBG_ERROR("failed to store package trace: " + store_path + "; file not accessible");
+		return false;
 	}
-	if (header.file_size != content.size())
+	for (const string& identifier : application_package->trace)
+		file << identifier << '\n';
+	file.close();
+	if (file.fail())
 	{
-		DBG_ERROR("failed to load package; invalid file size");
-		return { };
+		DBG_ERROR("failed to store package trace: " + store_path + "; write failed");
+		return false;
 	}
-	if (header.version != 1)
+	DBG_INFO("stored " + to_string(application_package->trace.size()) + " traced loads to: " + store_path);
+	return true;
+}
+
+void Package::traceEntry(const Entry* entry)
+{
+	if (!application_package->tracing.load(memory_order_relaxed))
+		return;
+
+	lock_guard lock(application_package->trace_mutex);
+	if (application_package->traced.insert(hashIdentifier(entry->name)).second)
+		application_package->trace.emplace_back(entry->name);
+}
+
+vector<Package::IndexSlot> Package::buildIndex(const vector<uint64_t>& hashes)
+{
+	// keep the load factor at or below 50% so that lookups almost always hit on the first probe
+	size_t slot_count = 16;
+	while (slot_count < hashes.size() * 2)
+		slot_count *= 2;
+
+	vector<IndexSlot> index(slot_count, IndexSlot{ 0, 0, 0 });
+	for (size_t i = 0; i < hashes.size(); ++i)
+		insertIndexSlot(index, hashes[i], (uint32_t)(i + 1));
+	return index;
+}
+
+// package data is unpacked straight into the returned buffer, so unlike tryLoadView, no unpacked copy is kept
+vector<uint8_t> Package::tryLoadFile(string_view path_or_identifier)
+{
+	constexpr string_view res_prefix = "res://";
+	if (path_or_identifier.starts_with(res_prefix))
 	{
-		DBG_ERROR("failed to load package; invalid version");
-		return { };
+		string_view identifier = path_or_identifier.substr(res_prefix.size());
+		vector<uint8_t> data(getDataSize(identifier));
+		if (!unpackDataInto(identifier, data))
+			return { };
+		return data;
 	}
 
-	DBG_INFO("unpacked compressed package");
-	return content;
+	vector<uint8_t> file_storage;
+	tryLoadView(path_or_identifier, file_storage);
+	return file_storage;
 }
 
-vector<uint8_t> Package::loadData(string identifier)
+size_t Package::getFileSize(string_view path_or_identifier)
 {
-	if (!application_package)
-		Package::init();
+	constexpr string_view res_prefix = "res://";
+	if (path_or_identifier.starts_with(res_prefix))
+		return getDataSize(path_or_identifier.substr(res_prefix.size()));
 
-	DBG_VERBOSE("loading '" + identifier + "'");
-	auto it = application_package->database.find(identifier);
-	if (it != application_package->database.end())
-		return it->second;
-	DBG_WARNING("found no data associated with '" + identifier + "'");
-	return { };
+	error_code error;
+	size_t size = (size_t)filesystem::file_size(path_or_identifier, error);
+	return error ? 0 : size;
 }
 
-void Package::storeData(string identifier, vector<uint8_t> data)
+bool Package::peekFile(string_view path_or_identifier, span<uint8_t> destination)
 {
-	if (!application_package)
-		Package::init();
+	constexpr string_view res_prefix = "res://";
+	if (path_or_identifier.starts_with(res_prefix))
+		return peekData(path_or_identifier.substr(res_prefix.size()), destination);
 
-	DBG_VERBOSE("storing '" + identifier + "'; " + to_string(data.size()) + " bytes");
-	application_package->database[identifier] = data;
+	ifstream file(string(path_or_identifier), ios::binary);
+	file.read((char*)destination.data(), destination.size());
+	return file.is_open() && (size_t)file.gcount() == destination.size();
+}
+
+bool Package::tryLoadFileInto(string_view path_or_identifier, span<uint8_t> destination)
+{
+	constexpr string_view res_prefix = "res://";
+	if (path_or_identifier.starts_with(res_prefix))
+		return unpackDataInto(path_or_identifier.substr(res_prefix.size()), destination);
+
+	DBG_VERBOSE("loading '" + string(path_or_identifier) + "' from file");
+	ifstream file(string(path_or_identifier), ios::ate | ios::binary);
+	if (!file.is_open() || (size_t)file.tellg() != destination.size())
+	{
+		DBG_WARNING("failed to load '" + string(path_or_identifier) + "'; file not accessible");
+		return false;
+	}
+	file.seekg(0);
+	file.read((char*)destination.data(), destination.size());
+	return (size_t)file.gcount() == destination.size();
 }
 
-vector<uint8_t> Package::tryLoadFile(string path_or_identifier)
+DataView Package::tryLoadView(string_view path_or_identifier, vector<uint8_t>& file_storage)
 {
 	if (!application_package)
 		Package::init();
 
-	static string res_prefix = "res://";
-	if (path_or_identifier.substr(0, res_prefix.size()) == res_prefix)
+	constexpr string_view res_prefix = "res://";
+	if (path_or_identifier.starts_with(res_prefix))
 	{
 		// load package resource
 		return Package::loadData(path_or_identifier.substr(res_prefix.size()));
 	}
 	else
 	{
-		DBG_VERBOSE("loading '" + path_or_identifier + "' from file");
+		DBG_VERBOSE("loading '" + string(path_or_identifier) + "' from file");
 		// load file data
-		ifstream file(path_or_identifier, ios::ate | ios::binary);
-		if (!file.is_open())
-		{
-			DBG_WARNING("failed to load '" + path_or_identifier + "'; file not accessible");
-			return { };
-		}
+		file_storage = readFile(path_or_identifier);
+		if (file_storage.empty())
+			DBG_WARNING("failed to load '" + string(path_or_identifier) + "'; file not accessible");
 
-		size_t size = (size_t)file.tellg();
-		vector<uint8_t> content(size);
-		file.seekg(0);
-		file.read((char*)(content.data()), size);
-		file.close();
-
-		return content;
+		return DataView(file_storage.data(), file_storage.size());
 	}
 }
 
+vector<uint8_t> Package::readFile(string_view path)
+{
+	ifstream file(string(path), ios::ate | ios::binary);
+	if (!file.is_open())
+		return { };
+
+	size_t size = (size_t)file.tellg();
+	vector<uint8_t> content(size);
+	file.seekg(0);
+	file.read((char*)(content.data()), size);
+	file.close();
+
+	return content;
+}
+
 void Package::tryWriteFile(string path, vector<uint8_t> data)
 {
 	if (!application_package)
@@ -419,9 +1274,154 @@ void Package::tryWriteFile(string path, vector<uint8_t> data)
 	file.close();
 }
 
-Package::Package() {}
+template <typename T>
+future<T> Package::queueJob(function<T()> job)
+{
+	if (!application_package)
+		Package::init();
+
+	// std::function must be copyable, so the task is shared rather than moved in
+	auto task = make_shared<packaged_task<T()>>(std::move(job));
+	future<T> result = task->get_future();
+	{
+		lock_guard lock(application_package->io_mutex);
+		application_package->io_jobs.push_back([task]() { (*task)(); });
+	}
+	application_package->io_condition.notify_one();
+	return result;
+}
+
+future<DataView> Package::loadDataAsync(string identifier)
+{
+	return queueJob<DataView>([identifier]() { return loadData(identifier); });
+}
+
+future<DataView> Package::loadDataAsync(ResId identifier)
+{
+	return queueJob<DataView>([identifier]() { return loadData(identifier); });
+}
+
+future<vector<uint8_t>> Package::tryLoadFileAsync(string path_or_identifier)
+{
+	return queueJob<vector<uint8_t>>([path_or_identifier]() { return tryLoadFile(path_or_identifier); });
+}
+
+future<void> Package::runAsync(function<void()> job)
+{
+	return queueJob<void>(std::move(job));
+}
+
+// reads root and everything it depends on in on the io workers, all at once and dependencies first, so that
+// loading them doesn't stall on the disk one resource at a time. nothing is unpacked; the futures complete once
+// each resource is in memory, in the same order
+vector<future<void>> Package::preload(string_view root)
+{
+	if (!application_package)
+		Package::init();
+
+	// depth-first, so every resource comes after the things it depends on. cycles are broken where they're found.
+	// the graph used is the one in the top-most source which has one, like any other identifier
+	vector<string> order;
+	{
+		shared_lock lock(application_package->sources_mutex);
+		const map<string_view, vector<string_view>>* graph = nullptr;
+		for (auto source_it = application_package->sources.rbegin(); source_it != application_package->sources.rend(); ++source_it)
+		{
+			Entry* entry = findEntry(*source_it, hashIdentifier(dependencies_identifier), dependencies_identifier);
+			if (entry == nullptr)
+				continue;
+			if (!entry->removed)
+				graph = &(*source_it)->dependencies;
+			break;
+		}
+
+		set<string_view> visited;
+		function<void(string_view)> visit = [&](string_view identifier)
+		{
+			if (!visited.insert(identifier).second)
+				return;
+			if (graph != nullptr)
+			{
+				auto it = graph->find(identifier);
+				if (it != graph->end())
+				{
+					for (string_view dependency : it->second)
+						visit(dependency);
+				}
+			}
+			order.push_back(string(identifier));
+		};
+		visit(root);
+	}
+
+	DBG_VERBOSE("preloading " + string(root) + " and " + to_string(order.size() - 1) + " dependencies");
+	vector<future<void>> loads;
+	loads.reserve(order.size());
+	for (string& identifier : order)
+	{
+		loads.push_back(queueJob<void>([identifier = std::move(identifier)]()
+		{
+			Entry* entry = findVisibleEntry(hashIdentifier(identifier), identifier);
+			if (entry == nullptr)
+			{
+				DBG_WARNING("failed to preload '" + identifier + "'; no data associated with it");
+				return;
+			}
+			if (entry->shared != nullptr)
+				entry = entry->shared;
+			if (entry->mapped)
+				touchMapped(entry->stored);
+		}));
+	}
+	return loads;
+}
+
+bool Package::isIoWorker()
+{
+	return on_io_worker;
+}
+
+void Package::ioWorker()
+{
+	on_io_worker = true;
+	while (true)
+	{
+		function<void()> job;
+		{
+			unique_lock lock(io_mutex);
+			io_condition.wait(lock, [this]() { return io_stopping || !io_jobs.empty(); });
+			// queued jobs are still completed when stopping, so that nobody is left waiting on a future
+			if (io_jobs.empty())
+				return;
+			job = std::move(io_jobs.front());
+			io_jobs.pop_front();
+		}
+		job();
+	}
+}
+
+Package::Package()
+{
+	size_t worker_count = clamp(thread::hardware_concurrency(), 2u, 4u);
+	for (size_t i = 0; i < worker_count; ++i)
+		io_workers.emplace_back(&Package::ioWorker, this);
+}
 
 Package::~Package()
 {
-	database.clear();
+	{
+		lock_guard lock(io_mutex);
+		io_stopping = true;
+	}
+	io_condition.notify_all();
+	for (thread& worker : io_workers)
+		worker.join();
+	io_workers.clear();
+
+	for (Source* source : sources)
+	{
+		unmapFile(source->mapped);
+		delete source;
+	}
+	sources.clear();
 }
@@ -1,33 +1,189 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
+#include <deque>
 #include <map>
+#include <span>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <thread>
+#include <future>
+#include <functional>
+#include <unordered_set>
+#include <atomic>
 #include <cstdint>
 
 #include "common.h"
 
+// debug builds record the order resources are first loaded in, and write it here on shutdown.
+// package-builder -t lays packages out in that order, so that startup reads walk forward through the file
+#if !defined(NDEBUG)
+#define PACKAGE_TRACE "package.trace"
+#endif
+
 namespace HopEngine
 {
 
+// read-only window onto package data. views returned by the package stay valid until the package is destroyed
+typedef std::span<const uint8_t> DataView;
+
+constexpr uint64_t IDENTIFIER_HASH_BASIS = 0xcbf29ce484222325ull;
+
+// FNV-1a hash of an identifier, used to index package entries. passing a previous hash in continues it,
+// so hashIdentifier(b, hashIdentifier(a)) == hashIdentifier(a + b)
+constexpr uint64_t hashIdentifier(std::string_view identifier, uint64_t hash = IDENTIFIER_HASH_BASIS)
+{
+	for (char c : identifier)
+	{
+		hash ^= (uint8_t)c;
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+// identifier of a packaged resource, hashed at compile time from a "res://" literal,
+// e.g. new Mesh("res://cube.obj"_res). the hash is the same one the package-builder stores in the package index
+struct ResId
+{
+	uint64_t hash;
+	std::string_view name;
+	std::string_view suffix;
+
+	consteval explicit ResId(std::string_view literal) : hash(0), name(literal)
+	{
+		if (!literal.starts_with("res://"))
+			throw "resource identifiers must start with 'res://'";
+		name = literal.substr(6);
+		hash = hashIdentifier(name);
+	}
+
+	// identifier of a resource whose name extends this one, e.g. a shader's ".vert" source
+	constexpr ResId withSuffix(std::string_view extension) const { return ResId(hashIdentifier(extension, hash), name, extension); }
+	inline std::string getPath() const { return "res://" + std::string(name) + std::string(suffix); }
+
+private:
+	constexpr ResId(uint64_t _hash, std::string_view _name, std::string_view _suffix) : hash(_hash), name(_name), suffix(_suffix) { }
+};
+
+consteval ResId operator""_res(const char* literal, size_t length)
+{
+	return ResId(std::string_view(literal, length));
+}
+
+struct MappedFile;
+
 class Package
 {
 private:
-	std::map<std::string, std::vector<uint8_t>> database;
+	struct IndexSlot
+	{
+		uint64_t hash;
+		uint32_t entry;		// index into the entry list + 1, or 0 if the slot is empty
+		uint32_t reserved;
+	};
+
+	struct Entry
+	{
+		std::string_view name;
+		DataView stored;
+		size_t size = 0;
+		uint32_t codec = 0;
+		std::vector<uint8_t> owned;
+		std::unique_ptr<std::once_flag> unpack_flag;
+		Entry* shared = nullptr;	// an earlier entry using the same stored block, which holds the unpacked copy
+		bool mapped = false;
+		bool removed = false;
+		bool replaced = false;		// stored or removed again since; kept for the views into it, but no longer indexed
+	};
+
+	// a loaded package file, or a block of data added at runtime with storeData.
+	// each source has its own open-addressed index, which for package files is read straight out of the mapping
+	struct Source
+	{
+		std::string path;
+		MappedFile* mapped = nullptr;
+		std::deque<Entry> entries;
+		std::deque<std::string> names;
+		std::span<const IndexSlot> index;
+		std::vector<IndexSlot> owned_index;
+		int priority = 0;
+		bool writable = false;
+		bool compressed = false;
+		// the dependency graph, if this source holds one, parsed when it's loaded or stored. the views point into
+		// dependency_data
+		std::vector<uint8_t> dependency_data;
+		std::map<std::string_view, std::vector<std::string_view>> dependencies;
+	};
+
+	// sources are kept sorted by priority, and higher ones take precedence. packages loaded with the same priority
+	// are stacked in load order, and data stored at runtime is always on top. readers share the lock, loading and storing take it exclusively
+	std::vector<Source*> sources;
+	std::shared_mutex sources_mutex;
+
+	// worker threads which service the async loading functions
+	std::vector<std::thread> io_workers;
+	std::deque<std::function<void()>> io_jobs;
+	std::mutex io_mutex;
+	std::condition_variable io_condition;
+	bool io_stopping = false;
+
+	// identifiers in the order they were first loaded, while tracing
+	std::atomic<bool> tracing = false;
+	std::vector<std::string> trace;
+	std::unordered_set<uint64_t> traced;
+	std::mutex trace_mutex;
 
 public:
+	// package-builder stores the dependency graph of scenes and materials under this identifier
+	static constexpr std::string_view dependencies_identifier = "<dependencies>";
+
 	DELETE_NOT_ALL_CONSTRUCTORS(Package);
 
 	static void init();
 	static void destroy();
 
-	static bool loadPackage(std::string load_path);
-	static bool storePackage(std::string store_path);
-	static bool storeCompressedPackage(std::string store_path);
-	static std::vector<uint8_t> loadData(std::string identifier);
+	static bool loadPackage(std::string load_path, int priority = 0);
+	static bool loadPackage(DataView content, std::string name, int priority = 0);
+	static bool unloadPackage(std::string load_path);
+	static bool storePackage(std::string store_path, const std::vector<std::string>& layout_order = { }, size_t alignment = 16);
+	static bool storeCompressedPackage(std::string store_path, const std::vector<std::string>& layout_order = { }, size_t alignment = 16);
+	static DataView loadData(std::string_view identifier);
+	static DataView loadData(ResId identifier);
+	static bool hasData(std::string_view identifier);
+	static bool hasData(ResId identifier);
+	static size_t getDataSize(std::string_view identifier);
+	static size_t getDataSize(ResId identifier);
+	static bool unpackDataInto(std::string_view identifier, std::span<uint8_t> destination);
+	static bool unpackDataInto(ResId identifier, std::span<uint8_t> destination);
+	// copies just the start of an entry, e.g. to check a header before deciding how to unpack the rest
+	static bool peekData(std::string_view identifier, std::span<uint8_t> destination);
+	static bool peekData(ResId identifier, std::span<uint8_t> destination);
+	// storing or removing an identifier which is already stored doesn't touch the old data, so views of it stay valid
 	static void storeData(std::string identifier, std::vector<uint8_t> data);
-	static std::vector<uint8_t> tryLoadFile(std::string path_or_identifier);
+	static void removeData(std::string identifier);
+	static std::vector<uint8_t> tryLoadFile(std::string_view path_or_identifier);
+	// getDataSize, peekData and unpackDataInto for anything tryLoadFile takes, so loose files can be read into
+	// buffers allocated ahead of time as well
+	static size_t getFileSize(std::string_view path_or_identifier);
+	static bool peekFile(std::string_view path_or_identifier, std::span<uint8_t> destination);
+	static bool tryLoadFileInto(std::string_view path_or_identifier, std::span<uint8_t> destination);
+	static DataView tryLoadView(std::string_view path_or_identifier, std::vector<uint8_t>& file_storage);
 	static void tryWriteFile(std::string path, std::vector<uint8_t> data);
+	static std::future<DataView> loadDataAsync(std::string identifier);
+	static std::future<DataView> loadDataAsync(ResId identifier);
+	static std::future<std::vector<uint8_t>> tryLoadFileAsync(std::string path_or_identifier);
+	// runs a job on the io workers, for loaders which decode what they read there as well
+	static std::future<void> runAsync(std::function<void()> job);
+	// whether this is one of the io workers. jobs running there mustn't wait on other jobs, since every worker
+	// could end up waiting
+	static bool isIoWorker();
+	static std::vector<std::future<void>> preload(std::string_view root);
+	static void startTrace();
+	static bool storeTrace(std::string store_path);
 #if defined(_WIN32)
 	static inline std::string getTempPath() { return "C:/tmp/"; }
 #else
@@ -38,7 +194,22 @@ private:
 	Package();
 	~Package();
 
-	static std::vector<uint8_t> loadCompressedPackage(std::vector<uint8_t> data);
+	static bool parsePackage(DataView content, MappedFile* mapped, std::string load_path, int priority);
+	static bool writePackage(std::string store_path, bool compressed, const std::vector<std::string>& layout_order, size_t alignment);
+	static DataView unpackEntry(Entry& entry);
+	static bool unpackEntryInto(Entry& entry, std::span<uint8_t> destination);
+	static bool peekEntry(Entry& entry, std::span<uint8_t> destination);
+	static Entry* insertEntry(std::string identifier);
+	static Entry* findEntry(Source* source, uint64_t hash, std::string_view identifier = { });
+	static void loadDependencies(Source* source);
+	static Entry* findVisibleEntry(uint64_t hash, std::string_view identifier = { });
+	static void traceEntry(const Entry* entry);
+	static std::vector<IndexSlot> buildIndex(const std::vector<uint64_t>& hashes);
+	static void insertIndexSlot(std::vector<IndexSlot>& index, uint64_t hash, uint32_t entry);
+	static std::vector<uint8_t> readFile(std::string_view path);
+	template <typename T>
+	static std::future<T> queueJob(std::function<T()> job);
+	void ioWorker();
 };
 
 }
@@ -0,0 +1,159 @@
+#include "resource_cache.h"
+
+#include "shader.h"
+#include "texture.h"
+#include "mesh.h"
+#include "sampler.h"
+#include "material.h"
+
+using namespace HopEngine;
+using namespace std;
+
+static ResourceCache* resource_cache = nullptr;
+
+// file paths are hashed on from this, so they don't share keys with package identifiers of the same name
+static constexpr uint64_t FILE_KEY_BASIS = hashIdentifier("file://");
+
+static constexpr const char* RESOURCE_TYPE_NAMES[] = { "shader", "texture", "mesh", "sampler", "material" };
+
+void ResourceCache::init()
+{
+	if (resource_cache == nullptr)
+	{
+		DBG_INFO("initialising resource cache");
+		resource_cache = new ResourceCache();
+	}
+}
+
+void ResourceCache::destroy()
+{
+	if (resource_cache != nullptr)
+	{
+		DBG_INFO("destroying resource cache");
+		delete resource_cache;
+		resource_cache = nullptr;
+	}
+}
+
+uint64_t ResourceCache::getKey(string_view identifier, uint64_t settings)
+{
+	constexpr string_view res_prefix = "res://";
+	uint64_t hash = identifier.starts_with(res_prefix) ? hashIdentifier(identifier.substr(res_prefix.size())) : hashIdentifier(identifier, FILE_KEY_BASIS);
+	return hashIdentifier(string_view((const char*)&settings, sizeof(settings)), hash);
+}
+
+uint64_t ResourceCache::getKey(ResId resource, uint64_t settings)
+{
+	return hashIdentifier(string_view((const char*)&settings, sizeof(settings)), resource.hash);
+}
+
+template <typename T, typename Create>
+Ref<T> ResourceCache::find(unordered_map<uint64_t, Ref<T>>& entries, uint64_t key, ResourceType type, Create create)
+{
+	auto it = entries.find(key);
+	if (it != entries.end())
+	{
+		++resource_cache->statistics[type].hits;
+		return it->second;
+	}
+
+	++resource_cache->statistics[type].misses;
+	Ref<T> resource = create();
+	// failed loads aren't kept, so they're tried again next time
+	if (resource)
+		entries[key] = resource;
+	return resource;
+}
+
+Ref<Shader> ResourceCache::getShader(string base_path, bool is_precompiled)
+{
+	init();
+	return find(resource_cache->shaders, getKey(base_path, is_precompiled), SHADER, [&]() { return Ref<Shader>(new Shader(base_path, is_precompiled)); });
+}
+
+Ref<Shader> ResourceCache::getShader(ResId resource, bool is_precompiled)
+{
+	init();
+	return find(resource_cache->shaders, getKey(resource, is_precompiled), SHADER, [&]() { return Ref<Shader>(new Shader(resource, is_precompiled)); });
+}
+
+Ref<Texture> ResourceCache::getTexture(string file, VkImageUsageFlags usage)
+{
+	init();
+	return find(resource_cache->textures, getKey(file, usage), TEXTURE, [&]() { return Texture::loadAsync(file, usage); });
+}
+
+Ref<Texture> ResourceCache::getTexture(ResId resource, VkImageUsageFlags usage)
+{
+	init();
+	return find(resource_cache->textures, getKey(resource, usage), TEXTURE, [&]() { return Texture::loadAsync(resource, usage); });
+}
+
+Ref<Mesh> ResourceCache::getMesh(string path)
+{
+	init();
+	return find(resource_cache->meshes, getKey(path), MESH, [&]() { return Mesh::loadAsync(path); });
+}
+
+Ref<Mesh> ResourceCache::getMesh(ResId resource)
+{
+	init();
+	return find(resource_cache->meshes, getKey(resource), MESH, [&]() { return Mesh::loadAsync(resource); });
+}
+
+Ref<Sampler> ResourceCache::getSampler(VkFilter filtering_mode, VkSamplerAddressMode address_mode)
+{
+	init();
+	uint64_t key = ((uint64_t)filtering_mode << 32) | (uint64_t)address_mode;
+	return find(resource_cache->samplers, key, SAMPLER, [&]() { return Ref<Sampler>(new Sampler(filtering_mode, address_mode)); });
+}
+
+Ref<Material> ResourceCache::getMaterial(string path)
+{
+	init();
+	return find(resource_cache->materials, getKey(path), MATERIAL, [&]() { return Material::deserialise(path); });
+}
+
+ResourceCache::Statistics ResourceCache::getStatistics(ResourceType type)
+{
+	if (resource_cache == nullptr)
+		return { };
+	return resource_cache->statistics[type];
+}
+
+template <typename T>
+void ResourceCache::releaseUnused(unordered_map<uint64_t, Ref<T>>& entries)
+{
+	for (auto it = entries.begin(); it != entries.end();)
+	{
+		if (it->second.getReferenceCount() <= 1)
+			it = entries.erase(it);
+		else
+			++it;
+	}
+}
+
+void ResourceCache::releaseUnused()
+{
+	if (resource_cache == nullptr)
+		return;
+
+	// materials go first, since they hold on to shaders, textures and samplers
+	releaseUnused(resource_cache->materials);
+	releaseUnused(resource_cache->shaders);
+	releaseUnused(resource_cache->textures);
+	releaseUnused(resource_cache->samplers);
+	releaseUnused(resource_cache->meshes);
+}
+
+ResourceCache::ResourceCache()
+{ }
+
+ResourceCache::~ResourceCache()
+{
+	for (size_t type = 0; type < RESOURCE_TYPE_COUNT; ++type)
+		DBG_INFO(string(RESOURCE_TYPE_NAMES[type]) + " cache: " + to_string(statistics[type].hits) + " hits, " + to_string(statistics[type].misses) + " misses");
+
+	// materials are released before the resources they use
+	materials.clear();
+}
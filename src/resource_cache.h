@@ -0,0 +1,82 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <array>
+#include <unordered_map>
+#include <vulkan/vulkan.hpp>
+
+#include "common.h"
+#include "package.h"
+
+namespace HopEngine
+{
+
+// shares resources between everything that loads the same file with the same settings, so that a shader used by
+// ten materials is only compiled once. the cache holds a reference to everything in it until releaseUnused or
+// destroy, and like the resources themselves, it must only be used from the main thread.
+// materials from the cache are shared templates: changing a uniform or texture on one changes it everywhere
+class ResourceCache
+{
+public:
+	enum ResourceType
+	{
+		SHADER,
+		TEXTURE,
+		MESH,
+		SAMPLER,
+		MATERIAL,
+
+		RESOURCE_TYPE_COUNT
+	};
+
+	struct Statistics
+	{
+		size_t hits = 0;
+		size_t misses = 0;
+	};
+
+private:
+	// keyed on a 64 bit hash of the identifier and the settings, which like the package index hash is assumed not to
+	// collide. "res://" identifiers hash the same as the ResIds which refer to them
+	std::unordered_map<uint64_t, Ref<Shader>> shaders;
+	std::unordered_map<uint64_t, Ref<Texture>> textures;
+	std::unordered_map<uint64_t, Ref<Mesh>> meshes;
+	std::unordered_map<uint64_t, Ref<Sampler>> samplers;
+	std::unordered_map<uint64_t, Ref<Material>> materials;
+	std::array<Statistics, RESOURCE_TYPE_COUNT> statistics;
+
+public:
+	DELETE_NOT_ALL_CONSTRUCTORS(ResourceCache);
+
+	static void init();
+	static void destroy();
+
+	static Ref<Shader> getShader(std::string base_path, bool is_precompiled);
+	static Ref<Shader> getShader(ResId resource, bool is_precompiled);
+	// textures and meshes are streamed in, so these hand back a placeholder straight away (see ResourceStreamer).
+	// one which fails to load stays a placeholder, and stays cached until it's released
+	static Ref<Texture> getTexture(std::string file, VkImageUsageFlags usage = VK_IMAGE_USAGE_FLAG_BITS_MAX_ENUM);
+	static Ref<Texture> getTexture(ResId resource, VkImageUsageFlags usage = VK_IMAGE_USAGE_FLAG_BITS_MAX_ENUM);
+	static Ref<Mesh> getMesh(std::string path);
+	static Ref<Mesh> getMesh(ResId resource);
+	static Ref<Sampler> getSampler(VkFilter filtering_mode, VkSamplerAddressMode address_mode);
+	static Ref<Material> getMaterial(std::string path);
+
+	static Statistics getStatistics(ResourceType type);
+	// drops everything nothing else is using
+	static void releaseUnused();
+
+private:
+	ResourceCache();
+	~ResourceCache();
+
+	static uint64_t getKey(std::string_view identifier, uint64_t settings = 0);
+	static uint64_t getKey(ResId resource, uint64_t settings = 0);
+	template <typename T, typename Create>
+	static Ref<T> find(std::unordered_map<uint64_t, Ref<T>>& entries, uint64_t key, ResourceType type, Create create);
+	template <typename T>
+	static void releaseUnused(std::unordered_map<uint64_t, Ref<T>>& entries);
+};
+
+}
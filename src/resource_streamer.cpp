@@ -0,0 +1,91 @@
+#include "resource_streamer.h"
+
+#include <chrono>
+
+#include "package.h"
+
+using namespace HopEngine;
+using namespace std;
+
+static ResourceStreamer* resource_streamer = nullptr;
+
+void ResourceStreamer::init()
+{
+	if (resource_streamer == nullptr)
+	{
+		DBG_INFO("initialising resource streamer");
+		resource_streamer = new ResourceStreamer();
+	}
+}
+
+void ResourceStreamer::destroy()
+{
+	if (resource_streamer != nullptr)
+	{
+		DBG_INFO("destroying resource streamer");
+		delete resource_streamer;
+		resource_streamer = nullptr;
+	}
+}
+
+void ResourceStreamer::queue(function<void()> decode, function<void()> finish)
+{
+	init();
+	// the finish step stays here on the main thread, since it holds Refs, and only decode goes to the workers
+	resource_streamer->pending.push_back({ Package::runAsync(std::move(decode)), std::move(finish) });
+}
+
+void ResourceStreamer::update()
+{
+	if (resource_streamer == nullptr || resource_streamer->pending.empty())
+		return;
+
+	vector<function<void()>> finished;
+	auto& pending = resource_streamer->pending;
+	for (auto it = pending.begin(); it != pending.end() && finished.size() < max_finishes_per_frame;)
+	{
+		if (it->decoded.wait_for(chrono::seconds(0)) == future_status::ready)
+		{
+			finished.push_back(std::move(it->finish));
+			it = pending.erase(it);
+		}
+		else
+			++it;
+	}
+	if (finished.empty())
+		return;
+
+	// loads retire what was in their placeholders rather than destroying it, since frames still in flight may be
+	// using it, so nothing here waits for the GPU
+	for (function<void()>& finish : finished)
+		finish();
+	++resource_streamer->generation;
+	DBG_VERBOSE("finished " + to_string(finished.size()) + " streamed loads, " + to_string(pending.size()) + " still pending");
+}
+
+size_t ResourceStreamer::getPendingCount()
+{
+	if (resource_streamer == nullptr)
+		return 0;
+	return resource_streamer->pending.size();
+}
+
+uint64_t ResourceStreamer::getGeneration()
+{
+	if (resource_streamer == nullptr)
+		return 0;
+	return resource_streamer->generation;
+}
+
+ResourceStreamer::ResourceStreamer()
+{ }
+
+ResourceStreamer::~ResourceStreamer()
+{
+	// loads which haven't been finished are dropped, after waiting for decodes which are still reading packages
+	for (PendingLoad& load : pending)
+		load.decoded.wait();
+	if (!pending.empty())
+		DBG_INFO("dropped " + to_string(pending.size()) + " unfinished streamed loads");
+	pending.clear();
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+#include <future>
+#include <functional>
+
+#include "common.h"
+
+namespace HopEngine
+{
+
+// loads resources in the background. the async factories (Texture::loadAsync, Mesh::loadAsync) hand back a
+// placeholder straight away, and queue the read and decode of the real resource on the package's io workers.
+// once that's done, the upload into the placeholder is submitted from the main thread at the start of a frame,
+// and what the placeholder held is retired through RenderServer::retire, so everything already holding the
+// placeholder starts drawing the real resource without the GPU being drained. like the resources themselves,
+// this must only be used from the main thread
+class ResourceStreamer
+{
+public:
+	// at most this many loads are finished each frame, so a burst of completed loads is spread over a few frames
+	static constexpr size_t max_finishes_per_frame = 8;
+
+private:
+	struct PendingLoad
+	{
+		std::future<void> decoded;
+		std::function<void()> finish;
+	};
+
+	std::vector<PendingLoad> pending;
+	uint64_t generation = 0;
+
+public:
+	DELETE_NOT_ALL_CONSTRUCTORS(ResourceStreamer);
+
+	static void init();
+	static void destroy();
+
+	// decode runs on an io worker, and mustn't touch Refs or the GPU. finish runs on the main thread at the first
+	// frame boundary after decode has completed, and does whatever decode couldn't
+	static void queue(std::function<void()> decode, std::function<void()> finish);
+	// finishes completed loads. the engine calls this at the start of every frame, before anything is recorded
+	static void update();
+	static size_t getPendingCount();
+	// changes whenever finished loads have replaced GPU resources, so that descriptors pointing at the old ones
+	// can be written again
+	static uint64_t getGeneration();
+
+private:
+	ResourceStreamer();
+	~ResourceStreamer();
+};
+
+}
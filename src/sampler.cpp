@@ -28,7 +28,7 @@ Sampler::Sampler(VkFilter filtering_mode, VkSamplerAddressMode address_mode)
 	create_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
 	create_info.mipLodBias = 0.0f;
 	create_info.minLod = 0.0f;
-	create_info.maxLod = 0.0f;
+	create_info.maxLod = VK_LOD_CLAMP_NONE;
 	if (vkCreateSampler(RenderServer::getDevice(), &create_info, nullptr, &sampler) != VK_SUCCESS)
 		DBG_FAULT("vkCreateSampler failed");
 
@@ -32,6 +32,8 @@ public:
 	inline Ref<T> findObject(std::string name);
 	std::vector<Ref<Object>> getAllObjects();
 
+	static Ref<Scene> deserialise(std::string name);
+
 	Scene();
 	inline ~Scene() { };
 };
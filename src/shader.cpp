@@ -5,7 +5,6 @@
 #include <fstream>
 #include <vector>
 #include <string>
-#include <spirv_reflect/spirv_reflect.h>
 #include <filesystem>
 
 #include "graphics_environment.h"
@@ -15,36 +14,95 @@
 using namespace HopEngine;
 using namespace std;
 
-#if defined(_WIN32)
-const char* Shader::compiler_path = "C:/tmp/glslc.exe";
-#else
-const char* Shader::compiler_path = "glslc";
-#endif
-
 Shader::Shader(string base_path, bool is_precompiled)
 {
+	// shaders cooked by package-builder are used as they are, without compiling or reflecting anything
+	constexpr string_view res_prefix = "res://";
+	if (!is_precompiled && base_path.starts_with(res_prefix))
+	{
+		string cooked_identifier = base_path.substr(res_prefix.size()) + ".shader";
+		if (Package::hasData(cooked_identifier) && createFromCooked(Package::loadData(cooked_identifier)))
+		{
+			DBG_INFO("created shader from cooked " + base_path);
+			return;
+		}
+	}
+
 	string proper_path = base_path;
 	if (!is_precompiled)
 	{
 		proper_path = Package::getTempPath() + "temp_shader_compiled";
 		if (!compileShaders(base_path, proper_path))
-		{
-			DBG_ERROR(base_path + " shader compilation failed");
-			if (!compileShaders("res://shader", proper_path))
-				DBG_FAULT("failed to load default shader!");
-		}
+			compileDefaultShaders(base_path, proper_path);
 	}
 	
-	auto vert_blob = Package::tryLoadFile(proper_path + "_vert.spv");
-	auto frag_blob = Package::tryLoadFile(proper_path + "_frag.spv");
+	vector<uint8_t> vert_storage;
+	vector<uint8_t> frag_storage;
+	DataView vert_blob = Package::tryLoadView(proper_path + "_vert.spv", vert_storage);
+	DataView frag_blob = Package::tryLoadView(proper_path + "_frag.spv", frag_storage);
+	createFromBlobs(vert_blob, frag_blob);
+
+	DBG_INFO("created shader from " + base_path);
+}
+
+Shader::Shader(ResId resource, bool is_precompiled)
+{
+	ResId cooked_resource = resource.withSuffix(".shader");
+	if (!is_precompiled && Package::hasData(cooked_resource) && createFromCooked(Package::loadData(cooked_resource)))
+	{
+		DBG_INFO("created shader from cooked " + resource.getPath());
+		return;
+	}
+
+	if (is_precompiled)
+	{
+		// precompiled blobs are used straight out of the package
+		createFromBlobs(Package::loadData(resource.withSuffix("_vert.spv")), Package::loadData(resource.withSuffix("_frag.spv")));
+	}
+	else
+	{
+		string proper_path = Package::getTempPath() + "temp_shader_compiled";
+		DataView vert_source = Package::loadData(resource.withSuffix(".vert"));
+		DataView frag_source = Package::loadData(resource.withSuffix(".frag"));
+		if (!compileSources(vector<uint8_t>(vert_source.begin(), vert_source.end()), vector<uint8_t>(frag_source.begin(), frag_source.end()), resource.getPath(), proper_path))
+			compileDefaultShaders(resource.getPath(), proper_path);
+
+		vector<uint8_t> vert_storage;
+		vector<uint8_t> frag_storage;
+		DataView vert_blob = Package::tryLoadView(proper_path + "_vert.spv", vert_storage);
+		DataView frag_blob = Package::tryLoadView(proper_path + "_frag.spv", frag_storage);
+		createFromBlobs(vert_blob, frag_blob);
+	}
+
+	DBG_INFO("created shader from " + resource.getPath());
+}
 
+bool Shader::createFromCooked(DataView cooked_data)
+{
+	DataView vert_blob;
+	DataView frag_blob;
+	vector<DescriptorBinding> cooked_bindings;
+	if (!ShaderCooker::readCooked(cooked_data, vert_blob, frag_blob, cooked_bindings))
+		return false;
+
+	createFromBlobs(vert_blob, frag_blob, cooked_bindings);
+	return true;
+}
+
+void Shader::createFromBlobs(DataView vert_blob, DataView frag_blob)
+{
+	auto vert_bindings = ShaderCooker::getReflectedBindings(vert_blob);
+	auto frag_bindings = ShaderCooker::getReflectedBindings(frag_blob);
+
+	createFromBlobs(vert_blob, frag_blob, ShaderCooker::mergeBindings(vert_bindings, frag_bindings));
+}
+
+void Shader::createFromBlobs(DataView vert_blob, DataView frag_blob, vector<DescriptorBinding> merged_bindings)
+{
 	vert_module = createShaderModule(vert_blob);
 	frag_module = createShaderModule(frag_blob);
 
-	auto vert_bindings = getReflectedBindings(vert_blob);
-	auto frag_bindings = getReflectedBindings(frag_blob);
-
-	bindings = mergeBindings(vert_bindings, frag_bindings);
+	bindings = merged_bindings;
 
 	vector<VkDescriptorSetLayoutBinding> layout_bindings;
 	for (const DescriptorBinding& binding : bindings)
@@ -80,8 +138,6 @@ Shader::Shader(string base_path, bool is_precompiled)
 
 	if (vkCreatePipelineLayout(RenderServer::getDevice(), &layout_create_info, nullptr, &pipeline_layout) != VK_SUCCESS)
 		DBG_FAULT("vkCreatePipelineLayout failed");
-
-	DBG_INFO("created shader from " + base_path);
 }
 
 Shader::~Shader()
@@ -117,125 +173,7 @@ ShaderLayout Shader::getShaderLayout()
 	return { descriptor_set_layout, bindings };
 }
 
-vector<DescriptorBinding> Shader::mergeBindings(vector<DescriptorBinding> list_a, vector<DescriptorBinding> list_b)
-{
-	multimap<uint32_t, DescriptorBinding> bindings;
-
-	for (auto item : list_a)
-		bindings.insert({ item.binding, item });
-	for (auto item : list_b)
-		bindings.insert({ item.binding, item });
-
-	if (bindings.empty())
-		return { };
-	if (bindings.size() == 1)
-		return { bindings.begin()->second };
-
-	vector<DescriptorBinding> resolved_bindings;
-
-	auto binding_it = bindings.begin();
-	while (binding_it != bindings.end())
-	{
-		DescriptorBinding last_binding = binding_it->second;
-		resolved_bindings.push_back(last_binding);
-		binding_it++;
-		if (binding_it == bindings.end())
-			return resolved_bindings;
-		else if (binding_it->first == last_binding.binding)
-		{
-			// uh oh! duplicate bindings! that's not good...
-			if (binding_it->second.type == last_binding.type && binding_it->second.buffer_size == last_binding.buffer_size)
-				binding_it++;
-			else
-			{
-				DBG_ERROR("incompatible duplicate shader uniform/texture bindings found");
-				binding_it++;
-			}
-		}
-	}
-
-	return resolved_bindings;
-}
-
-vector<DescriptorBinding> Shader::getReflectedBindings(vector<uint8_t> blob)
-{
-	SpvReflectShaderModule reflected_module;
-	SpvReflectResult result = spvReflectCreateShaderModule(blob.size(), blob.data(), &reflected_module);
-	if (result != SPV_REFLECT_RESULT_SUCCESS)
-	{
-		DBG_WARNING("unable to construct reflection module");
-		return { };
-	}
-	const SpvReflectDescriptorSet* vert_material_set = spvReflectGetDescriptorSet(&reflected_module, 2, &result);
-	if (result != SPV_REFLECT_RESULT_SUCCESS)
-	{
-		DBG_WARNING("unable to reflect descriptor set 2");
-		spvReflectDestroyShaderModule(&reflected_module);
-		return { };
-	}
-
-	vector<DescriptorBinding> bindings;
-	for (size_t i = 0; i < vert_material_set->binding_count; ++i)
-	{
-		SpvReflectDescriptorBinding* binding = vert_material_set->bindings[i];
-		if (binding->descriptor_type == SPV_REFLECT_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
-		{
-			DescriptorBinding db;
-			db.type = UNIFORM;
-			db.binding = binding->binding;
-			db.buffer_size = binding->block.padded_size;
-			db.name = binding->name;
-			for (size_t j = 0; j < binding->block.member_count; ++j)
-			{
-				SpvReflectBlockVariable member = binding->block.members[j];
-				db.variables.push_back({ member.name, member.size, member.offset });
-			}
-			bindings.push_back(db);
-		}
-		else if (binding->descriptor_type == SPV_REFLECT_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER)
-		{
-			DescriptorBinding db;
-			db.type = TEXTURE;
-			db.binding = binding->binding;
-			db.name = binding->name;
-			bindings.push_back(db);
-		}
-	}
-
-	spvReflectDestroyShaderModule(&reflected_module);
-	return bindings;
-}
-
-bool Shader::compileFile(string path, string out_path)
-{
-	string compile_command = Shader::compiler_path;
-#if defined(_WIN32)
-	for (size_t i = 0; i < path.size(); i++)
-	{
-		if (path[i] == '/')
-			path[i] = '\\';
-	}
-	for (size_t i = 0; i < path.size(); i++)
-	{
-		if (path[i] == '/')
-			path[i] = '\\';
-	}
-#endif
-
-	string command_out;
-	compile_command = compile_command + ' ' + path + " -o " + out_path;
-	int result = exec(compile_command.c_str(), command_out);
-
-	if (result != 0)
-	{
-		DBG_WARNING("error when compiling '" + path + "':\n" + command_out);
-		return false;
-	}
-
-	return true;
-}
-
-VkShaderModule Shader::createShaderModule(const vector<uint8_t>& blob)
+VkShaderModule Shader::createShaderModule(DataView blob)
 {
 	VkShaderModuleCreateInfo create_info{ };
 	create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
@@ -249,43 +187,20 @@ VkShaderModule Shader::createShaderModule(const vector<uint8_t>& blob)
 	return shader_module;
 }
 
-void Shader::fixIncludes(vector<uint8_t>& source_code, string path_prefix)
+bool Shader::compileShaders(string path, string out_path)
 {
-	string source_code_text(source_code.size(), ' ');
-	memcpy(source_code_text.data(), source_code.data(), source_code.size());
-
-	string include_search = "#include \"";
-	size_t offset = source_code_text.find(include_search, 0);
-	while (offset != string::npos)
-	{
-		size_t start = offset + include_search.size();
-		size_t end = source_code_text.find('\"', start);
-		string path = source_code_text.substr(start, end - start);
-		if (path.find(' ') != string::npos)
-		{
-			DBG_ERROR("malformed include found!");
-			source_code.resize(source_code_text.size());
-			memcpy(source_code.data(), source_code_text.data(), source_code_text.size());
-			return;
-		}
-		source_code_text.erase(offset, (end - offset) + 1);
-		auto include_data = Package::tryLoadFile(path_prefix + path);
-		string include_string(include_data.size(), ' ');
-		memcpy(include_string.data(), include_data.data(), include_data.size());
-		source_code_text.insert(source_code_text.begin() + offset, include_data.begin(), include_data.end());
-
-		offset = source_code_text.find(include_search, offset);
-	}
-
-	source_code.resize(source_code_text.size());
-	memcpy(source_code.data(), source_code_text.data(), source_code_text.size());
+	return compileSources(Package::tryLoadFile(path + ".vert"), Package::tryLoadFile(path + ".frag"), path, out_path);
 }
 
-bool Shader::compileShaders(string path, string out_path)
+void Shader::compileDefaultShaders(string failed_path, string out_path)
 {
-	auto vert_data = Package::tryLoadFile(path + ".vert");
-	auto frag_data = Package::tryLoadFile(path + ".frag");
+	DBG_ERROR(failed_path + " shader compilation failed");
+	if (!compileShaders("res://shader", out_path))
+		DBG_FAULT("failed to load default shader!");
+}
 
+bool Shader::compileSources(vector<uint8_t> vert_data, vector<uint8_t> frag_data, string path, string out_path)
+{
 	if (vert_data.empty())
 	{
 		DBG_WARNING("shader " + path + ".vert not found");
@@ -299,15 +214,8 @@ bool Shader::compileShaders(string path, string out_path)
 
 	filesystem::path _path = path;
 	string prefix = _path.remove_filename().string();
-	Shader::fixIncludes(vert_data, prefix);
-	Shader::fixIncludes(frag_data, prefix);
-
-	string input_path = Package::getTempPath() + "temp_shader";
-	Package::tryWriteFile(input_path + ".vert", vert_data);
-	Package::tryWriteFile(input_path + ".frag", frag_data);
-
-	bool result = Shader::compileFile(input_path + ".vert", out_path + "_vert.spv");
-	result &= Shader::compileFile(input_path + ".frag", out_path + "_frag.spv");
+	ShaderCooker::fixIncludes(vert_data, prefix);
+	ShaderCooker::fixIncludes(frag_data, prefix);
 
-	return result;
+	return ShaderCooker::compile(vert_data, frag_data, path, out_path);
 }
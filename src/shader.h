@@ -5,32 +5,12 @@
 #include <vulkan/vulkan.hpp>
 
 #include "common.h"
+#include "package.h"
+#include "shader_cooker.h"
 
 namespace HopEngine
 {
 
-enum DescriptorBindingType
-{
-	UNIFORM,
-	TEXTURE
-};
-
-struct UniformVariable
-{
-	std::string name;
-	size_t size = 0;
-	size_t offset = 0;
-};
-
-struct DescriptorBinding
-{
-	uint32_t binding = 0;
-	DescriptorBindingType type = UNIFORM;
-	VkDeviceSize buffer_size = 0;
-	std::string name;
-	std::vector<UniformVariable> variables;
-};
-
 struct ShaderLayout
 {
 	VkDescriptorSetLayout layout = VK_NULL_HANDLE;
@@ -39,9 +19,6 @@ struct ShaderLayout
 
 class Shader
 {
-public:
-	static const char* compiler_path;
-
 private:
 	VkShaderModule vert_module = VK_NULL_HANDLE;
 	VkShaderModule frag_module = VK_NULL_HANDLE;
@@ -53,6 +30,7 @@ public:
 	DELETE_CONSTRUCTORS(Shader);
 		
 	Shader(std::string base_path, bool is_precompiled);
+	Shader(ResId resource, bool is_precompiled);
 	~Shader();
 
 	inline VkPipelineLayout getPipelineLayout() { return pipeline_layout; }
@@ -60,12 +38,14 @@ public:
 	ShaderLayout getShaderLayout();
 
 private:
-	static std::vector<DescriptorBinding> mergeBindings(std::vector<DescriptorBinding> list_a, std::vector<DescriptorBinding> list_b);
-	static std::vector<DescriptorBinding> getReflectedBindings(std::vector<uint8_t> blob);
-	static bool compileFile(std::string path, std::string out_path);
-	static VkShaderModule createShaderModule(const std::vector<uint8_t>& blob);
-	static void fixIncludes(std::vector<uint8_t>& source_code, std::string path_prefix);
+	bool createFromCooked(DataView cooked_data);
+	void createFromBlobs(DataView vert_blob, DataView frag_blob);
+	void createFromBlobs(DataView vert_blob, DataView frag_blob, std::vector<DescriptorBinding> merged_bindings);
+
+	static VkShaderModule createShaderModule(DataView blob);
 	static bool compileShaders(std::string path, std::string out_path);
+	static void compileDefaultShaders(std::string failed_path, std::string out_path);
+	static bool compileSources(std::vector<uint8_t> vert_data, std::vector<uint8_t> frag_data, std::string path, std::string out_path);
 };
 
 }
@@ -0,0 +1,328 @@
+#include "shader_cooker.h"
+
+#include <map>
+#include <cstring>
+#include <filesystem>
+#include <spirv_reflect/spirv_reflect.h>
+
+using namespace HopEngine;
+using namespace std;
+
+#if defined(_WIN32)
+const char* ShaderCooker::compiler_path = "C:/tmp/glslc.exe";
+#else
+const char* ShaderCooker::compiler_path = "glslc";
+#endif
+const char* ShaderCooker::optimiser_path = "spirv-opt";
+
+void ShaderCooker::fixIncludes(vector<uint8_t>& source_code, string path_prefix)
+{
+	string source_code_text(source_code.size(), ' ');
+	memcpy(source_code_text.data(), source_code.data(), source_code.size());
+
+	string include_search = "#include \"";
+	size_t offset = source_code_text.find(include_search, 0);
+	while (offset != string::npos)
+	{
+		size_t start = offset + include_search.size();
+		size_t end = source_code_text.find('\"', start);
+		string path = source_code_text.substr(start, end - start);
+		if (path.find(' ') != string::npos)
+		{
+			DBG_ERROR("malformed include found!");
+			source_code.resize(source_code_text.size());
+			memcpy(source_code.data(), source_code_text.data(), source_code_text.size());
+			return;
+		}
+		source_code_text.erase(offset, (end - offset) + 1);
+		auto include_data = Package::tryLoadFile(path_prefix + path);
+		string include_string(include_data.size(), ' ');
+		memcpy(include_string.data(), include_data.data(), include_data.size());
+		source_code_text.insert(source_code_text.begin() + offset, include_data.begin(), include_data.end());
+
+		offset = source_code_text.find(include_search, offset);
+	}
+
+	source_code.resize(source_code_text.size());
+	memcpy(source_code.data(), source_code_text.data(), source_code_text.size());
+}
+
+// the sources are expected to have had their includes fixed already. the intermediate files are named
+// after out_path, so several shaders can be compiled at once as long as they go to different places
+bool ShaderCooker::compile(const vector<uint8_t>& vert_source, const vector<uint8_t>& frag_source, string path, string out_path)
+{
+	Package::tryWriteFile(out_path + ".vert", vert_source);
+	Package::tryWriteFile(out_path + ".frag", frag_source);
+
+	bool result = ShaderCooker::compileFile(out_path + ".vert", out_path + "_vert.spv");
+	result &= ShaderCooker::compileFile(out_path + ".frag", out_path + "_frag.spv");
+	filesystem::remove(out_path + ".vert");
+	filesystem::remove(out_path + ".frag");
+
+	if (!result)
+		DBG_WARNING("failed to compile shader " + path);
+	return result;
+}
+
+bool ShaderCooker::compileFile(string path, string out_path)
+{
+	string compile_command = ShaderCooker::compiler_path;
+#if defined(_WIN32)
+	for (size_t i = 0; i < path.size(); i++)
+	{
+		if (path[i] == '/')
+			path[i] = '\\';
+	}
+	for (size_t i = 0; i < path.size(); i++)
+	{
+		if (path[i] == '/')
+			path[i] = '\\';
+	}
+#endif
+
+	string command_out;
+	compile_command = compile_command + ' ' + path + " -o " + out_path;
+	int result = exec(compile_command.c_str(), command_out);
+
+	if (result != 0)
+	{
+		DBG_WARNING("error when compiling '" + path + "':\n" + command_out);
+		return false;
+	}
+
+	return true;
+}
+
+bool ShaderCooker::optimise(string spv_path)
+{
+	string command_out;
+	string optimise_command = string(ShaderCooker::optimiser_path) + " -O " + spv_path + " -o " + spv_path + ".opt";
+	if (exec(optimise_command.c_str(), command_out) != 0)
+	{
+		DBG_WARNING("error when optimising '" + spv_path + "':\n" + command_out);
+		filesystem::remove(spv_path + ".opt");
+		return false;
+	}
+
+	error_code error;
+	filesystem::rename(spv_path + ".opt", spv_path, error);
+	return !error;
+}
+
+vector<DescriptorBinding> ShaderCooker::getReflectedBindings(DataView blob)
+{
+	SpvReflectShaderModule reflected_module;
+	SpvReflectResult result = spvReflectCreateShaderModule(blob.size(), blob.data(), &reflected_module);
+	if (result != SPV_REFLECT_RESULT_SUCCESS)
+	{
+		DBG_WARNING("unable to construct reflection module");
+		return { };
+	}
+	const SpvReflectDescriptorSet* vert_material_set = spvReflectGetDescriptorSet(&reflected_module, 2, &result);
+	if (result != SPV_REFLECT_RESULT_SUCCESS)
+	{
+		DBG_WARNING("unable to reflect descriptor set 2");
+		spvReflectDestroyShaderModule(&reflected_module);
+		return { };
+	}
+
+	vector<DescriptorBinding> bindings;
+	for (size_t i = 0; i < vert_material_set->binding_count; ++i)
+	{
+		SpvReflectDescriptorBinding* binding = vert_material_set->bindings[i];
+		if (binding->descriptor_type == SPV_REFLECT_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
+		{
+			DescriptorBinding db;
+			db.type = UNIFORM;
+			db.binding = binding->binding;
+			db.buffer_size = binding->block.padded_size;
+			db.name = binding->name;
+			for (size_t j = 0; j < binding->block.member_count; ++j)
+			{
+				SpvReflectBlockVariable member = binding->block.members[j];
+				db.variables.push_back({ member.name, member.size, member.offset });
+			}
+			bindings.push_back(db);
+		}
+		else if (binding->descriptor_type == SPV_REFLECT_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER)
+		{
+			DescriptorBinding db;
+			db.type = TEXTURE;
+			db.binding = binding->binding;
+			db.name = binding->name;
+			bindings.push_back(db);
+		}
+	}
+
+	spvReflectDestroyShaderModule(&reflected_module);
+	return bindings;
+}
+
+vector<DescriptorBinding> ShaderCooker::mergeBindings(vector<DescriptorBinding> list_a, vector<DescriptorBinding> list_b)
+{
+	multimap<uint32_t, DescriptorBinding> bindings;
+
+	for (auto item : list_a)
+		bindings.insert({ item.binding, item });
+	for (auto item : list_b)
+		bindings.insert({ item.binding, item });
+
+	if (bindings.empty())
+		return { };
+	if (bindings.size() == 1)
+		return { bindings.begin()->second };
+
+	vector<DescriptorBinding> resolved_bindings;
+
+	auto binding_it = bindings.begin();
+	while (binding_it != bindings.end())
+	{
+		DescriptorBinding last_binding = binding_it->second;
+		resolved_bindings.push_back(last_binding);
+		binding_it++;
+		if (binding_it == bindings.end())
+			return resolved_bindings;
+		else if (binding_it->first == last_binding.binding)
+		{
+			// uh oh! duplicate bindings! that's not good...
+			if (binding_it->second.type == last_binding.type && binding_it->second.buffer_size == last_binding.buffer_size)
+				binding_it++;
+			else
+			{
+				DBG_ERROR("incompatible duplicate shader uniform/texture bindings found");
+				binding_it++;
+			}
+		}
+	}
+
+	return resolved_bindings;
+}
+
+template <typename T>
+static void writeValue(vector<uint8_t>& data, T value)
+{
+	size_t offset = data.size();
+	data.resize(offset + sizeof(T));
+	memcpy(data.data() + offset, &value, sizeof(T));
+}
+
+static void writeString(vector<uint8_t>& data, const string& str)
+{
+	writeValue<uint32_t>(data, (uint32_t)str.size());
+	data.insert(data.end(), str.begin(), str.end());
+}
+
+template <typename T>
+static bool readValue(DataView& data, T& value)
+{
+	if (data.size() < sizeof(T))
+		return false;
+	memcpy(&value, data.data(), sizeof(T));
+	data = data.subspan(sizeof(T));
+	return true;
+}
+
+static bool readString(DataView& data, string& str)
+{
+	uint32_t size = 0;
+	if (!readValue(data, size) || data.size() < size)
+		return false;
+	str.assign((const char*)data.data(), size);
+	data = data.subspan(size);
+	return true;
+}
+
+vector<uint8_t> ShaderCooker::cook(DataView vert_blob, DataView frag_blob, const vector<DescriptorBinding>& bindings)
+{
+	vector<uint8_t> serialised_bindings;
+	for (const DescriptorBinding& binding : bindings)
+	{
+		writeValue<uint32_t>(serialised_bindings, binding.binding);
+		writeValue<uint32_t>(serialised_bindings, (uint32_t)binding.type);
+		writeValue<uint64_t>(serialised_bindings, binding.buffer_size);
+		writeString(serialised_bindings, binding.name);
+		writeValue<uint32_t>(serialised_bindings, (uint32_t)binding.variables.size());
+		for (const UniformVariable& variable : binding.variables)
+		{
+			writeString(serialised_bindings, variable.name);
+			writeValue<uint64_t>(serialised_bindings, variable.size);
+			writeValue<uint64_t>(serialised_bindings, variable.offset);
+		}
+	}
+
+	CookedShaderHeader header;
+	header.signature = signature;
+	header.version = version;
+	header.binding_count = (uint32_t)bindings.size();
+	header.bindings_size = (uint32_t)serialised_bindings.size();
+	header.vert_offset = (uint32_t)((sizeof(CookedShaderHeader) + serialised_bindings.size() + 3) & ~(size_t)3);
+	header.vert_size = (uint32_t)vert_blob.size();
+	header.frag_offset = (uint32_t)((header.vert_offset + vert_blob.size() + 3) & ~(size_t)3);
+	header.frag_size = (uint32_t)frag_blob.size();
+
+	vector<uint8_t> data(header.frag_offset + frag_blob.size(), 0);
+	memcpy(data.data(), &header, sizeof(CookedShaderHeader));
+	memcpy(data.data() + sizeof(CookedShaderHeader), serialised_bindings.data(), serialised_bindings.size());
+	memcpy(data.data() + header.vert_offset, vert_blob.data(), vert_blob.size());
+	memcpy(data.data() + header.frag_offset, frag_blob.data(), frag_blob.size());
+	return data;
+}
+
+bool ShaderCooker::isCooked(DataView data)
+{
+	uint32_t data_signature = 0;
+	if (data.size() < sizeof(CookedShaderHeader))
+		return false;
+	memcpy(&data_signature, data.data(), sizeof(uint32_t));
+	return data_signature == signature;
+}
+
+bool ShaderCooker::readCooked(DataView data, DataView& vert_blob, DataView& frag_blob, vector<DescriptorBinding>& bindings)
+{
+	if (!isCooked(data))
+		return false;
+
+	CookedShaderHeader header;
+	memcpy(&header, data.data(), sizeof(CookedShaderHeader));
+	if (header.version != version
+		|| sizeof(CookedShaderHeader) + (size_t)header.bindings_size > data.size()
+		|| (size_t)header.vert_offset + header.vert_size > data.size()
+		|| (size_t)header.frag_offset + header.frag_size > data.size())
+	{
+		DBG_ERROR("invalid cooked shader data");
+		return false;
+	}
+
+	DataView serialised_bindings = data.subspan(sizeof(CookedShaderHeader), header.bindings_size);
+	bindings.clear();
+	for (uint32_t i = 0; i < header.binding_count; ++i)
+	{
+		DescriptorBinding binding;
+		uint32_t type = 0;
+		uint32_t variable_count = 0;
+		bool valid = readValue(serialised_bindings, binding.binding) && readValue(serialised_bindings, type)
+			&& readValue(serialised_bindings, binding.buffer_size) && readString(serialised_bindings, binding.name)
+			&& readValue(serialised_bindings, variable_count);
+		for (uint32_t j = 0; valid && j < variable_count; ++j)
+		{
+			UniformVariable variable;
+			uint64_t size = 0;
+			uint64_t offset = 0;
+			valid = readString(serialised_bindings, variable.name) && readValue(serialised_bindings, size) && readValue(serialised_bindings, offset);
+			variable.size = (size_t)size;
+			variable.offset = (size_t)offset;
+			binding.variables.push_back(variable);
+		}
+		if (!valid)
+		{
+			DBG_ERROR("invalid cooked shader bindings");
+			return false;
+		}
+		binding.type = (DescriptorBindingType)type;
+		bindings.push_back(binding);
+	}
+
+	vert_blob = data.subspan(header.vert_offset, header.vert_size);
+	frag_blob = data.subspan(header.frag_offset, header.frag_size);
+	return true;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "common.h"
+#include "package.h"
+
+namespace HopEngine
+{
+
+enum DescriptorBindingType
+{
+	UNIFORM,
+	TEXTURE
+};
+
+struct UniformVariable
+{
+	std::string name;
+	size_t size = 0;
+	size_t offset = 0;
+};
+
+struct DescriptorBinding
+{
+	uint32_t binding = 0;
+	DescriptorBindingType type = UNIFORM;
+	uint64_t buffer_size = 0;
+	std::string name;
+	std::vector<UniformVariable> variables;
+};
+
+// cooked shaders are stored as this header, followed by the serialised material bindings, and then the
+// vertex and fragment SPIR-V (each aligned to 4 bytes so it can be handed to vulkan in place)
+struct CookedShaderHeader
+{
+	uint32_t signature;
+	uint32_t version;
+	uint32_t binding_count;
+	uint32_t bindings_size;
+	uint32_t vert_offset;
+	uint32_t vert_size;
+	uint32_t frag_offset;
+	uint32_t frag_size;
+};
+
+// compiles and reflects shader sources. package-builder runs this ahead of time so that cooked
+// shaders can be created without launching the compiler, and Shader falls back to it for everything else
+class ShaderCooker
+{
+public:
+	static constexpr uint32_t signature = 0xC00CED5A;
+	static constexpr uint32_t version = 1;
+
+	static const char* compiler_path;
+	static const char* optimiser_path;
+
+	DELETE_CONSTRUCTORS(ShaderCooker);
+
+	static void fixIncludes(std::vector<uint8_t>& source_code, std::string path_prefix);
+	static bool compile(const std::vector<uint8_t>& vert_source, const std::vector<uint8_t>& frag_source, std::string path, std::string out_path);
+	static bool compileFile(std::string path, std::string out_path);
+	static bool optimise(std::string spv_path);
+	static std::vector<DescriptorBinding> getReflectedBindings(DataView blob);
+	static std::vector<DescriptorBinding> mergeBindings(std::vector<DescriptorBinding> list_a, std::vector<DescriptorBinding> list_b);
+	static std::vector<uint8_t> cook(DataView vert_blob, DataView frag_blob, const std::vector<DescriptorBinding>& bindings);
+	static bool isCooked(DataView data);
+	static bool readCooked(DataView data, DataView& vert_blob, DataView& frag_blob, std::vector<DescriptorBinding>& bindings);
+};
+
+}
@@ -1,14 +1,13 @@
 #include "texture.h"
 
 #include <stdexcept>
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb_image.h>
 #include <vulkan/vulkan_to_string.hpp>
 
 #include "buffer.h"
 #include "graphics_environment.h"
 #include "command_buffer.h"
 #include "package.h"
+#include "resource_streamer.h"
 
 using namespace HopEngine;
 using namespace std;
@@ -41,16 +40,70 @@ Texture::Texture(size_t _width, size_t _height, VkFormat _format, void* data, Vk
     }
 }
 
+// reads only the header of packaged data, so that data which isn't cooked is turned away before a staging buffer
+// is allocated or anything is unpacked
+template <typename Identifier>
+static bool isCookedInPackage(Identifier identifier)
+{
+    CookedTextureHeader header;
+    span<uint8_t> destination((uint8_t*)&header, sizeof(header));
+    return Package::peekData(identifier, destination) && TextureCooker::isCooked(destination);
+}
+
 Texture::Texture(string file, VkImageUsageFlags _usage)
 {
-    auto file_data = Package::tryLoadFile(file);
-    int img_width, img_height, img_channels;
-    stbi_uc* pixels = stbi_load_from_memory(file_data.data(), static_cast<int>(file_data.size()), &img_width, &img_height, &img_channels, STBI_rgb_alpha);
-    format = VK_FORMAT_R8G8B8A8_SRGB;
+    constexpr string_view res_prefix = "res://";
+    if (file.starts_with(res_prefix))
+    {
+        usage = _usage;
+        string_view identifier = string_view(file).substr(res_prefix.size());
+        if (isCookedInPackage(identifier) && loadCooked(Package::getDataSize(identifier), [identifier](span<uint8_t> destination) { return Package::unpackDataInto(identifier, destination); }, file))
+            return;
+    }
+
+    vector<uint8_t> file_data = Package::tryLoadFile(file);
+    loadFromFileData(DataView(file_data.data(), file_data.size()), file, _usage);
+}
+
+Texture::Texture(ResId resource, VkImageUsageFlags _usage)
+{
     usage = _usage;
+    if (isCookedInPackage(resource) && loadCooked(Package::getDataSize(resource), [resource](span<uint8_t> destination) { return Package::unpackDataInto(resource, destination); }, resource.getPath()))
+        return;
+
+    vector<uint8_t> file_data(Package::getDataSize(resource));
+    Package::unpackDataInto(resource, file_data);
+    loadFromFileData(DataView(file_data.data(), file_data.size()), resource.getPath(), _usage);
+}
+
+// maps a cooked encoding to the format it's uploaded as, or to the uncompressed format with the same channels
+static VkFormat getCookedFormat(TextureEncoding encoding, bool srgb, bool compressed)
+{
+    switch (encoding)
+    {
+    case ENCODING_BC1: return compressed ? (srgb ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK) : (srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM);
+    case ENCODING_BC3: return compressed ? (srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK) : (srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM);
+    case ENCODING_BC4: return compressed ? VK_FORMAT_BC4_UNORM_BLOCK : VK_FORMAT_R8_UNORM;
+    case ENCODING_BC5: return compressed ? VK_FORMAT_BC5_UNORM_BLOCK : VK_FORMAT_R8G8_UNORM;
+    default: return srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+    }
+}
+
+void Texture::loadFromFileData(DataView file_data, string name, VkImageUsageFlags _usage)
+{
+    usage = _usage;
+    auto copy = [file_data](span<uint8_t> destination) { memcpy(destination.data(), file_data.data(), destination.size()); return true; };
+    if (TextureCooker::isCooked(file_data) && loadCooked(file_data.size(), copy, name))
+        return;
+
+    vector<uint8_t> pixels;
+    uint32_t img_width = 1, img_height = 1;
+    bool decoded = TextureCooker::decodeImage(file_data, pixels, img_width, img_height);
+    // normal maps and masks hold data rather than colour, so they mustn't be converted from sRGB
+    format = (TextureCooker::getUsage(name) == TEXTURE_COLOUR) ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
     width = img_width; height = img_height;
 
-    if (pixels == nullptr)
+    if (!decoded)
     {
         DBG_ERROR("failed to load image file");
         width = 1; height = 1;
@@ -58,32 +111,259 @@ Texture::Texture(string file, VkImageUsageFlags _usage)
     }
     else
     {
-        size_t row_size = width * 4;
-        void* tmp = new uint8_t[row_size];
-        for (size_t i = 0; i < height / 2; ++i)
+        loadFromMemory(pixels.data());
+
+        DBG_INFO("created image from " + name + " with size " + to_string(width) + "x" + to_string(height) + " and format " + vk::to_string((vk::Format)format));
+    }
+}
+
+// cooked textures are unpacked straight into the staging buffer they're uploaded from, and each level is copied to
+// the image from where it sits in the cooked data. data which isn't cooked makes this return false before the image is created
+bool Texture::loadCooked(size_t size, const function<bool(span<uint8_t>)>& unpack, string name)
+{
+    if (size < sizeof(CookedTextureHeader))
+        return false;
+
+    Ref<Buffer> staging_buffer = new Buffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+    span<uint8_t> staging((uint8_t*)staging_buffer->mapMemory(), size);
+    DataView cooked_data(staging.data(), staging.size());
+    CookedTextureHeader header;
+    vector<CookedTextureLevel> levels;
+    if (!unpack(staging) || !TextureCooker::readCooked(cooked_data, header, levels))
+        return false;
+
+    width = header.width; height = header.height;
+    mip_levels = header.mip_count;
+
+    bool compressed = TextureCooker::getBlockSize(header.encoding) != 0;
+    if (compressed && !RenderServer::supportsBlockCompression())
+    {
+        // devices without BC support (e.g. some software rasterisers) get the levels decompressed here instead
+        DBG_VERBOSE("device doesn't support block compression, decompressing " + name);
+        vector<DataView> level_data;
+        vector<vector<uint8_t>> decompressed_levels;
+        for (const CookedTextureLevel& level : levels)
+        {
+            decompressed_levels.push_back(TextureCooker::decompress(cooked_data.subspan(level.offset, level.size), level.width, level.height, header.encoding));
+            level_data.push_back(DataView(decompressed_levels.back().data(), decompressed_levels.back().size()));
+        }
+        staging_buffer = nullptr;
+        format = getCookedFormat(header.encoding, header.srgb != 0, false);
+        loadLevels(level_data, levels);
+    }
+    else
+    {
+        staging_buffer->unmapMemory();
+        format = getCookedFormat(header.encoding, header.srgb != 0, compressed);
+
+        // every level starts on a 16 byte boundary, which satisfies the copy alignment of every format used here
+        vector<VkBufferImageCopy> copies;
+        for (size_t i = 0; i < levels.size(); ++i)
         {
-            memcpy(tmp, pixels + (i * row_size), row_size);
-            memcpy(pixels + (i * row_size), pixels + ((height - i - 1) * row_size), row_size);
-            memcpy(pixels + ((height - i - 1) * row_size), tmp, row_size);
+            VkBufferImageCopy image_copy{ };
+            image_copy.bufferOffset = levels[i].offset;
+            image_copy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            image_copy.imageSubresource.mipLevel = static_cast<uint32_t>(i);
+            image_copy.imageSubresource.baseArrayLayer = 0;
+            image_copy.imageSubresource.layerCount = 1;
+            image_copy.imageOffset = { 0, 0, 0 };
+            image_copy.imageExtent = { levels[i].width, levels[i].height, 1 };
+            copies.push_back(image_copy);
         }
 
-        loadFromMemory(pixels);
-        stbi_image_free(pixels);
+        createImage();
+        transitionLayout(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+        copyBufferToImage(staging_buffer, copies);
+        transitionLayout(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    }
+
+    DBG_INFO("created image from cooked " + name + " with size " + to_string(width) + "x" + to_string(height) + ", " + to_string(mip_levels) + " mip levels and format " + vk::to_string((vk::Format)format));
+    return true;
+}
 
-        DBG_INFO("created image from " + file + " with size " + to_string(width) + "x" + to_string(height) + " and format " + vk::to_string((vk::Format)format));
+void Texture::loadLevels(const vector<DataView>& level_data, const vector<CookedTextureLevel>& levels)
+{
+    // each level starts on a 16 byte boundary, which satisfies the copy alignment of every format used here
+    vector<VkBufferImageCopy> copies;
+    VkDeviceSize total_size = 0;
+    for (size_t i = 0; i < levels.size(); ++i)
+    {
+        VkBufferImageCopy image_copy{ };
+        image_copy.bufferOffset = total_size;
+        image_copy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        image_copy.imageSubresource.mipLevel = static_cast<uint32_t>(i);
+        image_copy.imageSubresource.baseArrayLayer = 0;
+        image_copy.imageSubresource.layerCount = 1;
+        image_copy.imageOffset = { 0, 0, 0 };
+        image_copy.imageExtent = { levels[i].width, levels[i].height, 1 };
+        copies.push_back(image_copy);
+        total_size = (total_size + level_data[i].size() + 15) & ~(VkDeviceSize)15;
     }
+
+    Ref<Buffer> staging_buffer = new Buffer(total_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    uint8_t* mapped = (uint8_t*)staging_buffer->mapMemory();
+    for (size_t i = 0; i < levels.size(); ++i)
+        memcpy(mapped + copies[i].bufferOffset, level_data[i].data(), level_data[i].size());
+    staging_buffer->unmapMemory();
+
+    createImage();
+    transitionLayout(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    copyBufferToImage(staging_buffer, copies);
+    transitionLayout(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 }
 
 Texture::~Texture()
 {
     DBG_INFO("destroying image " + PTR(this));
-    if (view != VK_NULL_HANDLE)
-        vkDestroyImageView(RenderServer::getDevice(), view, nullptr);
-    vkDestroyImage(RenderServer::getDevice(), image, nullptr);
-    vkFreeMemory(RenderServer::getDevice(), memory, nullptr);
+    destroyImage();
+}
+
+Ref<Texture> Texture::loadAsync(string file, VkImageUsageFlags usage)
+{
+    return stream(Package::getFileSize(file), [file](span<uint8_t> destination) { return Package::peekFile(file, destination); },
+        [file](span<uint8_t> destination) { return Package::tryLoadFileInto(file, destination); }, file, usage);
+}
+
+Ref<Texture> Texture::loadAsync(ResId resource, VkImageUsageFlags usage)
+{
+    return stream(Package::getDataSize(resource), [resource](span<uint8_t> destination) { return Package::peekData(resource, destination); },
+        [resource](span<uint8_t> destination) { return Package::unpackDataInto(resource, destination); }, resource.getPath(), usage);
+}
+
+// the header and level table of cooked data are peeked here, so the staging buffer can be allocated and mapped
+// before the load is queued. the io workers then unpack (or decompress) straight into it, and all that's left for
+// the main thread is recording the copy into the placeholder at the start of a frame, which materials already
+// using the placeholder pick up without being touched. data which isn't cooked is read and decoded into a buffer
+// belonging to the load instead, since its size isn't known until it's been decoded
+Ref<Texture> Texture::stream(size_t size, const function<bool(span<uint8_t>)>& peek, function<bool(span<uint8_t>)> unpack, string name, VkImageUsageFlags usage)
+{
+    struct DecodedImage
+    {
+        // the start of the cooked data as peeked when the load was queued, which the unpacked data must match
+        vector<uint8_t> layout;
+        CookedTextureHeader header;
+        vector<CookedTextureLevel> levels;
+        vector<VkBufferImageCopy> copies;
+        uint8_t* staging = nullptr;
+        bool cooked = false;
+        bool decompress = false;
+        vector<uint8_t> pixels;
+        uint32_t width = 1;
+        uint32_t height = 1;
+        bool decoded = false;
+    };
+
+    uint8_t white[4] = { 255, 255, 255, 255 };
+    Ref<Texture> texture = new Texture(1, 1, VK_FORMAT_R8G8B8A8_SRGB, white, usage);
+    auto image = make_shared<DecodedImage>();
+
+    image->layout.resize(min(size, sizeof(CookedTextureHeader) + (TextureCooker::max_mip_count * sizeof(CookedTextureLevel))));
+    DataView layout(image->layout.data(), image->layout.size());
+    image->cooked = peek(image->layout) && TextureCooker::isCooked(layout) && TextureCooker::readCookedLayout(layout, size, image->header, image->levels);
+    Ref<Buffer> staging_buffer;
+    if (image->cooked)
+    {
+        image->decompress = TextureCooker::getBlockSize(image->header.encoding) != 0 && !RenderServer::supportsBlockCompression();
+        if (image->decompress)
+            DBG_VERBOSE("device doesn't support block compression, decompressing " + name);
+
+        // decompressed levels are packed one after another, each starting on a 16 byte boundary, which satisfies the
+        // copy alignment of every format used here. otherwise each level is copied from where it sits in the cooked data
+        VkDeviceSize staging_size = size;
+        VkDeviceSize decompressed_size = 0;
+        for (size_t i = 0; i < image->levels.size(); ++i)
+        {
+            VkBufferImageCopy image_copy{ };
+            image_copy.bufferOffset = image->decompress ? decompressed_size : image->levels[i].offset;
+            image_copy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            image_copy.imageSubresource.mipLevel = static_cast<uint32_t>(i);
+            image_copy.imageSubresource.baseArrayLayer = 0;
+            image_copy.imageSubresource.layerCount = 1;
+            image_copy.imageOffset = { 0, 0, 0 };
+            image_copy.imageExtent = { image->levels[i].width, image->levels[i].height, 1 };
+            image->copies.push_back(image_copy);
+            decompressed_size = (decompressed_size + ((VkDeviceSize)image->levels[i].width * image->levels[i].height * TextureCooker::getDecompressedTexelSize(image->header.encoding)) + 15) & ~(VkDeviceSize)15;
+        }
+        if (image->decompress)
+            staging_size = decompressed_size;
+
+        staging_buffer = new Buffer(staging_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        image->staging = (uint8_t*)staging_buffer->mapMemory();
+    }
+
+    // the workers only ever see the mapped pointer; the staging buffer itself is held by the finish step, which
+    // doesn't run (and isn't destroyed) until the decode is done with it
+    ResourceStreamer::queue([image, size, unpack = std::move(unpack), name]()
+    {
+        if (!image->cooked)
+        {
+            vector<uint8_t> file_data(size);
+            if (unpack(file_data))
+                image->decoded = TextureCooker::decodeImage(DataView(file_data.data(), file_data.size()), image->pixels, image->width, image->height);
+            return;
+        }
+
+        if (!image->decompress)
+        {
+            // the data could have been replaced since it was peeked, in which case the copies no longer describe it
+            image->decoded = unpack(span<uint8_t>(image->staging, size)) && memcmp(image->staging, image->layout.data(), image->layout.size()) == 0;
+            return;
+        }
+
+        vector<uint8_t> cooked_data(size);
+        if (!unpack(cooked_data) || memcmp(cooked_data.data(), image->layout.data(), image->layout.size()) != 0)
+            return;
+        for (size_t i = 0; i < image->levels.size(); ++i)
+        {
+            const CookedTextureLevel& level = image->levels[i];
+            TextureCooker::decompressInto(DataView(cooked_data.data() + level.offset, level.size), level.width, level.height, image->header.encoding, image->staging + image->copies[i].bufferOffset);
+        }
+        image->decoded = true;
+    },
+    [texture, image, staging_buffer, name, usage]() mutable
+    {
+        // nothing but this load is holding on to the placeholder, so there's no point uploading anything
+        if (texture.getReferenceCount() <= 1 || !image->decoded)
+        {
+            if (!image->decoded)
+                DBG_ERROR("failed to load image file " + name);
+            if (staging_buffer)
+                staging_buffer->retire();
+            return;
+        }
+
+        // frames which are still in flight may be sampling the placeholder, so it's retired rather than destroyed,
+        // and the upload is submitted without waiting. the next frame is submitted after it, so draws the new image
+        texture->retireImage();
+        texture->usage = usage;
+        Ref<CommandBuffer> cmd_buf = new CommandBuffer(false);
+        if (image->cooked)
+        {
+            bool compressed = TextureCooker::getBlockSize(image->header.encoding) != 0 && !image->decompress;
+            texture->format = getCookedFormat(image->header.encoding, image->header.srgb != 0, compressed);
+            texture->width = image->header.width; texture->height = image->header.height;
+            texture->mip_levels = image->header.mip_count;
+            texture->createImage();
+            texture->transitionLayout(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, cmd_buf);
+            texture->copyBufferToImage(staging_buffer, image->copies, cmd_buf);
+            texture->transitionLayout(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, cmd_buf);
+            staging_buffer->retire();
+            DBG_INFO("streamed image from cooked " + name + " with size " + to_string(texture->width) + "x" + to_string(texture->height) + " and " + to_string(texture->mip_levels) + " mip levels into " + PTR(texture.get()));
+        }
+        else
+        {
+            texture->format = (TextureCooker::getUsage(name) == TEXTURE_COLOUR) ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+            texture->width = image->width; texture->height = image->height;
+            texture->loadFromMemory(image->pixels.data(), cmd_buf);
+            DBG_INFO("streamed image from " + name + " with size " + to_string(texture->width) + "x" + to_string(texture->height) + " into " + PTR(texture.get()));
+        }
+    });
+
+    DBG_INFO("created placeholder image " + PTR(texture.get()) + " for " + name);
+    return texture;
 }
 
-void Texture::transitionLayout(VkImageLayout new_layout)
+void Texture::transitionLayout(VkImageLayout new_layout, Ref<CommandBuffer> cmd_buf)
 {
     DBG_VERBOSE("transitioning image " + PTR(this) + " layout from " + vk::to_string((vk::ImageLayout)current_layout) + " to " + vk::to_string((vk::ImageLayout)new_layout));
 
@@ -96,7 +376,7 @@ void Texture::transitionLayout(VkImageLayout new_layout)
     memory_barrier.image = image;
     memory_barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
     memory_barrier.subresourceRange.baseMipLevel = 0;
-    memory_barrier.subresourceRange.levelCount = 1;
+    memory_barrier.subresourceRange.levelCount = mip_levels;
     memory_barrier.subresourceRange.baseArrayLayer = 0;
     memory_barrier.subresourceRange.layerCount = 1;
 
@@ -122,18 +402,19 @@ void Texture::transitionLayout(VkImageLayout new_layout)
         return;
     }
 
-    Ref<CommandBuffer> cmd_buf = new CommandBuffer();
+    bool recording = cmd_buf;
+    if (!recording)
+        cmd_buf = new CommandBuffer();
 
     vkCmdPipelineBarrier(cmd_buf->getBuffer(), src_stage, dst_stage, 0, 0, nullptr, 0, nullptr, 1, &memory_barrier);
 
-    cmd_buf->submit();
+    if (!recording)
+        cmd_buf->submit();
     current_layout = new_layout;
 }
 
-void Texture::copyBufferToImage(Ref<Buffer> buffer)
+void Texture::copyBufferToImage(Ref<Buffer> buffer, Ref<CommandBuffer> cmd_buf)
 {
-    DBG_VERBOSE("copying buffer " + PTR(buffer.get()) + " to image " + PTR(this));
-
     VkBufferImageCopy image_copy{ };
     image_copy.bufferOffset = 0;
     image_copy.bufferRowLength = 0;
@@ -151,11 +432,21 @@ void Texture::copyBufferToImage(Ref<Buffer> buffer)
         1
     };
 
-    Ref<CommandBuffer> cmd_buf = new CommandBuffer();
+    copyBufferToImage(buffer, { image_copy }, cmd_buf);
+}
+
+void Texture::copyBufferToImage(Ref<Buffer> buffer, const vector<VkBufferImageCopy>& copies, Ref<CommandBuffer> cmd_buf)
+{
+    DBG_VERBOSE("copying buffer " + PTR(buffer.get()) + " to image " + PTR(this));
+
+    bool recording = cmd_buf;
+    if (!recording)
+        cmd_buf = new CommandBuffer();
 
-    vkCmdCopyBufferToImage(cmd_buf->getBuffer(), buffer->getBuffer(), image, current_layout, 1, &image_copy);
+    vkCmdCopyBufferToImage(cmd_buf->getBuffer(), buffer->getBuffer(), image, current_layout, static_cast<uint32_t>(copies.size()), copies.data());
 
-    cmd_buf->submit();
+    if (!recording)
+        cmd_buf->submit();
 }
 
 VkImageView Texture::getView()
@@ -183,7 +474,7 @@ VkImageView Texture::getView()
         view_create_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
     }
     view_create_info.subresourceRange.baseMipLevel = 0;
-    view_create_info.subresourceRange.levelCount = 1;
+    view_create_info.subresourceRange.levelCount = mip_levels;
     view_create_info.subresourceRange.baseArrayLayer = 0;
     view_create_info.subresourceRange.layerCount = 1;
 
@@ -201,7 +492,7 @@ void Texture::createImage()
     image_create_info.extent.width = static_cast<uint32_t>(width);
     image_create_info.extent.height = static_cast<uint32_t>(height);
     image_create_info.extent.depth = 1;
-    image_create_info.mipLevels = 1;
+    image_create_info.mipLevels = mip_levels;
     image_create_info.arrayLayers = 1;
     image_create_info.format = format;
     image_create_info.tiling = VK_IMAGE_TILING_OPTIMAL;
@@ -234,7 +525,36 @@ void Texture::createImage()
     vkBindImageMemory(RenderServer::getDevice(), image, memory, 0);
 }
 
-void Texture::loadFromMemory(void* data)
+void Texture::destroyImage()
+{
+    if (view != VK_NULL_HANDLE)
+        vkDestroyImageView(RenderServer::getDevice(), view, nullptr);
+    vkDestroyImage(RenderServer::getDevice(), image, nullptr);
+    vkFreeMemory(RenderServer::getDevice(), memory, nullptr);
+    view = VK_NULL_HANDLE;
+    image = VK_NULL_HANDLE;
+    memory = VK_NULL_HANDLE;
+    mip_levels = 1;
+}
+
+// like destroyImage, but the handles are only destroyed once frames which might be sampling them have finished
+void Texture::retireImage()
+{
+    RenderServer::retire([retired_image = image, retired_memory = memory, retired_view = view]()
+    {
+        if (retired_view != VK_NULL_HANDLE)
+            vkDestroyImageView(RenderServer::getDevice(), retired_view, nullptr);
+        vkDestroyImage(RenderServer::getDevice(), retired_image, nullptr);
+        vkFreeMemory(RenderServer::getDevice(), retired_memory, nullptr);
+    });
+    view = VK_NULL_HANDLE;
+    image = VK_NULL_HANDLE;
+    memory = VK_NULL_HANDLE;
+    mip_levels = 1;
+}
+
+// with cmd_buf, the upload is only recorded, and the staging buffer is retired rather than destroyed
+void Texture::loadFromMemory(void* data, Ref<CommandBuffer> cmd_buf)
 {
     VkDeviceSize image_length = width * height * 4;
     Ref<Buffer> staging_buffer = new Buffer(image_length, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
@@ -242,7 +562,9 @@ void Texture::loadFromMemory(void* data)
     staging_buffer->unmapMemory();
 
     createImage();
-    transitionLayout(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-    copyBufferToImage(staging_buffer);
-    transitionLayout(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    transitionLayout(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, cmd_buf);
+    copyBufferToImage(staging_buffer, cmd_buf);
+    transitionLayout(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, cmd_buf);
+    if (cmd_buf)
+        staging_buffer->retire();
 }
@@ -1,10 +1,14 @@
 #pragma once
 
 #include <string>
+#include <span>
+#include <functional>
 #include <vulkan/vulkan.hpp>
 #include <glm/vec2.hpp>
 
 #include "common.h"
+#include "package.h"
+#include "texture_cooker.h"
 
 namespace HopEngine
 {
@@ -18,6 +22,7 @@ public:
 private:
 	size_t width;
 	size_t height;
+	uint32_t mip_levels = 1;
 	VkImageLayout current_layout;
 	VkFormat format;
 	VkImageUsageFlags usage;
@@ -30,16 +35,29 @@ public:
 
 	Texture(size_t width, size_t height, VkFormat format, void* data = nullptr, VkImageUsageFlags usage = VK_IMAGE_USAGE_FLAG_BITS_MAX_ENUM);
 	Texture(std::string file, VkImageUsageFlags usage = VK_IMAGE_USAGE_FLAG_BITS_MAX_ENUM);
+	Texture(ResId resource, VkImageUsageFlags usage = VK_IMAGE_USAGE_FLAG_BITS_MAX_ENUM);
 	~Texture();
 
-	void transitionLayout(VkImageLayout new_layout);
-	void copyBufferToImage(Ref<Buffer> buffer);
+	// returns a white placeholder straight away, which the image is streamed into once it's been read and decoded
+	static Ref<Texture> loadAsync(std::string file, VkImageUsageFlags usage = VK_IMAGE_USAGE_FLAG_BITS_MAX_ENUM);
+	static Ref<Texture> loadAsync(ResId resource, VkImageUsageFlags usage = VK_IMAGE_USAGE_FLAG_BITS_MAX_ENUM);
+
+	// both record into cmd_buf if there is one, otherwise they're submitted straight away
+	void transitionLayout(VkImageLayout new_layout, Ref<CommandBuffer> cmd_buf = nullptr);
+	void copyBufferToImage(Ref<Buffer> buffer, Ref<CommandBuffer> cmd_buf = nullptr);
+	void copyBufferToImage(Ref<Buffer> buffer, const std::vector<VkBufferImageCopy>& copies, Ref<CommandBuffer> cmd_buf = nullptr);
 	VkImageView getView();
 	inline glm::ivec2 getSize() { return { width, height }; }
 
 private:
 	void createImage();
-	void loadFromMemory(void* data);
+	void destroyImage();
+	void retireImage();
+	void loadFromMemory(void* data, Ref<CommandBuffer> cmd_buf = nullptr);
+	void loadFromFileData(DataView file_data, std::string name, VkImageUsageFlags _usage);
+	bool loadCooked(size_t size, const std::function<bool(std::span<uint8_t>)>& unpack, std::string name);
+	void loadLevels(const std::vector<DataView>& level_data, const std::vector<CookedTextureLevel>& levels);
+	static Ref<Texture> stream(size_t size, const std::function<bool(std::span<uint8_t>)>& peek, std::function<bool(std::span<uint8_t>)> unpack, std::string name, VkImageUsageFlags usage);
 };
 
 }
@@ -0,0 +1,639 @@
+#include "texture_cooker.h"
+
+#include <cmath>
+#include <cstring>
+#include <array>
+#include <algorithm>
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+using namespace HopEngine;
+using namespace std;
+
+static float srgbToLinear(uint8_t value)
+{
+	static const auto table = []()
+	{
+		array<float, 256> values;
+		for (size_t i = 0; i < 256; ++i)
+		{
+			float f = (float)i / 255.0f;
+			values[i] = (f <= 0.04045f) ? (f / 12.92f) : powf((f + 0.055f) / 1.055f, 2.4f);
+		}
+		return values;
+	}();
+	return table[value];
+}
+
+static uint8_t linearToSrgb(float value)
+{
+	float f = (value <= 0.0031308f) ? (value * 12.92f) : ((1.055f * powf(value, 1.0f / 2.4f)) - 0.055f);
+	return (uint8_t)clamp((int)((f * 255.0f) + 0.5f), 0, 255);
+}
+
+static uint16_t packRgb565(const float* colour)
+{
+	uint16_t r = (uint16_t)clamp((int)((colour[0] * 31.0f / 255.0f) + 0.5f), 0, 31);
+	uint16_t g = (uint16_t)clamp((int)((colour[1] * 63.0f / 255.0f) + 0.5f), 0, 63);
+	uint16_t b = (uint16_t)clamp((int)((colour[2] * 31.0f / 255.0f) + 0.5f), 0, 31);
+	return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void unpackRgb565(uint16_t packed, int* colour)
+{
+	int r = (packed >> 11) & 31;
+	int g = (packed >> 5) & 63;
+	int b = packed & 31;
+	colour[0] = (r << 3) | (r >> 2);
+	colour[1] = (g << 2) | (g >> 4);
+	colour[2] = (b << 3) | (b >> 2);
+}
+
+TextureUsage TextureCooker::getUsage(string_view name)
+{
+	size_t extension = name.find_last_of('.');
+	if (extension != string_view::npos)
+		name = name.substr(0, extension);
+
+	if (name.ends_with("_n") || name.ends_with("_normal"))
+		return TEXTURE_NORMAL;
+	if (name.ends_with("_mask"))
+		return TEXTURE_MASK;
+	return TEXTURE_COLOUR;
+}
+
+// decodes to RGBA8, flipped so that the first row is the bottom of the image
+bool TextureCooker::decodeImage(DataView file_data, vector<uint8_t>& pixels, uint32_t& width, uint32_t& height)
+{
+	int img_width, img_height, img_channels;
+	stbi_uc* decoded = stbi_load_from_memory(file_data.data(), static_cast<int>(file_data.size()), &img_width, &img_height, &img_channels, STBI_rgb_alpha);
+	if (decoded == nullptr)
+		return false;
+
+	width = img_width; height = img_height;
+	size_t row_size = (size_t)width * 4;
+	pixels.resize(row_size * height);
+	for (size_t i = 0; i < height; ++i)
+		memcpy(pixels.data() + (i * row_size), decoded + ((height - i - 1) * row_size), row_size);
+	stbi_image_free(decoded);
+
+	return true;
+}
+
+vector<uint8_t> TextureCooker::cook(vector<uint8_t> pixels, uint32_t width, uint32_t height, TextureUsage usage)
+{
+	CookedTextureHeader header;
+	header.signature = signature;
+	header.version = version;
+	header.width = width;
+	header.height = height;
+	header.srgb = usage == TEXTURE_COLOUR;
+	header.reserved = 0;
+	switch (usage)
+	{
+	case TEXTURE_NORMAL: header.encoding = ENCODING_BC5; break;
+	case TEXTURE_MASK: header.encoding = ENCODING_BC4; break;
+	default:
+		// only pay for an alpha block if the alpha channel is actually used
+		header.encoding = ENCODING_BC1;
+		for (size_t i = 3; i < pixels.size(); i += 4)
+		{
+			if (pixels[i] != 255)
+			{
+				header.encoding = ENCODING_BC3;
+				break;
+			}
+		}
+		break;
+	}
+
+	// images with lots of unrelated colours packed closely together (like pixel art) don't survive block
+	// compression, so those keep their mip chain but are stored uncompressed
+	vector<uint8_t> top_level = encodeLevel(pixels, width, height, header.encoding);
+	if (getError(pixels, decompress(DataView(top_level.data(), top_level.size()), width, height, header.encoding), header.encoding) > max_block_error)
+	{
+		header.encoding = ENCODING_RGBA8;
+		top_level = pixels;
+	}
+
+	header.mip_count = 1;
+	while ((width >> header.mip_count) != 0 || (height >> header.mip_count) != 0)
+		++header.mip_count;
+
+	vector<uint8_t> data(sizeof(CookedTextureHeader) + (header.mip_count * sizeof(CookedTextureLevel)));
+	memcpy(data.data(), &header, sizeof(CookedTextureHeader));
+	for (uint32_t level = 0; level < header.mip_count; ++level)
+	{
+		if (level != 0)
+		{
+			pixels = downsample(pixels, width, height, usage);
+			width = max(width / 2, 1u);
+			height = max(height / 2, 1u);
+		}
+		vector<uint8_t> level_data = (level == 0) ? std::move(top_level) : encodeLevel(pixels, width, height, header.encoding);
+
+		CookedTextureLevel level_info;
+		level_info.offset = (uint32_t)((data.size() + 15) & ~(size_t)15);
+		level_info.size = (uint32_t)level_data.size();
+		level_info.width = width;
+		level_info.height = height;
+		memcpy(data.data() + sizeof(CookedTextureHeader) + (level * sizeof(CookedTextureLevel)), &level_info, sizeof(CookedTextureLevel));
+
+		data.resize(level_info.offset, 0);
+		data.insert(data.end(), level_data.begin(), level_data.end());
+	}
+
+	return data;
+}
+
+bool TextureCooker::isCooked(DataView data)
+{
+	uint32_t data_signature = 0;
+	if (data.size() < sizeof(CookedTextureHeader))
+		return false;
+	memcpy(&data_signature, data.data(), sizeof(uint32_t));
+	return data_signature == signature;
+}
+
+bool TextureCooker::readCooked(DataView data, CookedTextureHeader& header, vector<CookedTextureLevel>& levels)
+{
+	return readCookedLayout(data, data.size(), header, levels);
+}
+
+bool TextureCooker::readCookedLayout(DataView data, size_t size, CookedTextureHeader& header, vector<CookedTextureLevel>& levels)
+{
+	if (!isCooked(data))
+		return false;
+
+	memcpy(&header, data.data(), sizeof(CookedTextureHeader));
+	if (header.version != version || header.encoding > ENCODING_BC5 || header.mip_count == 0 || header.mip_count > max_mip_count
+		|| sizeof(CookedTextureHeader) + (header.mip_count * sizeof(CookedTextureLevel)) > data.size())
+	{
+		DBG_ERROR("invalid cooked texture data");
+		return false;
+	}
+
+	levels.resize(header.mip_count);
+	memcpy(levels.data(), data.data() + sizeof(CookedTextureHeader), header.mip_count * sizeof(CookedTextureLevel));
+	size_t block_size = getBlockSize(header.encoding);
+	for (const CookedTextureLevel& level : levels)
+	{
+		size_t expected_size = (block_size == 0) ? ((size_t)level.width * level.height * 4) : ((size_t)((level.width + 3) / 4) * ((level.height + 3) / 4) * block_size);
+		if ((size_t)level.offset + level.size > size || level.size != expected_size || level.offset % 16 != 0)
+		{
+			DBG_ERROR("invalid cooked texture level");
+			return false;
+		}
+	}
+	return true;
+}
+
+// produces data in the uncompressed format with the same channels as the block format, so that it samples the same
+vector<uint8_t> TextureCooker::decompress(DataView level_data, uint32_t width, uint32_t height, TextureEncoding encoding)
+{
+	vector<uint8_t> pixels((size_t)width * height * getDecompressedTexelSize(encoding));
+	decompressInto(level_data, width, height, encoding, pixels.data());
+	return pixels;
+}
+
+void TextureCooker::decompressInto(DataView level_data, uint32_t width, uint32_t height, TextureEncoding encoding, uint8_t* pixels)
+{
+	size_t block_size = getBlockSize(encoding);
+	if (block_size == 0)
+	{
+		memcpy(pixels, level_data.data(), level_data.size());
+		return;
+	}
+
+	size_t texel_size = getDecompressedTexelSize(encoding);
+	size_t blocks_x = (width + 3) / 4;
+	size_t blocks_y = (height + 3) / 4;
+	const uint8_t* block = level_data.data();
+	uint8_t texels[16 * 4];
+	for (size_t by = 0; by < blocks_y; ++by)
+	{
+		for (size_t bx = 0; bx < blocks_x; ++bx)
+		{
+			switch (encoding)
+			{
+			case ENCODING_BC1: decodeBC1(block, texels, true); break;
+			case ENCODING_BC3: decodeBC1(block + 8, texels, false); decodeBC4(block, texels, 3, 4); break;
+			case ENCODING_BC4: decodeBC4(block, texels, 0, 1); break;
+			case ENCODING_BC5: decodeBC4(block, texels, 0, 2); decodeBC4(block + 8, texels, 1, 2); break;
+			default: break;
+			}
+			for (size_t i = 0; i < 16; ++i)
+			{
+				size_t x = (bx * 4) + (i % 4);
+				size_t y = (by * 4) + (i / 4);
+				if (x < width && y < height)
+					memcpy(pixels + (((y * width) + x) * texel_size), texels + (i * texel_size), texel_size);
+			}
+			block += block_size;
+		}
+	}
+}
+
+size_t TextureCooker::getBlockSize(TextureEncoding encoding)
+{
+	switch (encoding)
+	{
+	case ENCODING_BC1: return 8;
+	case ENCODING_BC3: return 16;
+	case ENCODING_BC4: return 8;
+	case ENCODING_BC5: return 16;
+	default: return 0;
+	}
+}
+
+size_t TextureCooker::getDecompressedTexelSize(TextureEncoding encoding)
+{
+	switch (encoding)
+	{
+	case ENCODING_BC4: return 1;
+	case ENCODING_BC5: return 2;
+	default: return 4;
+	}
+}
+
+vector<uint8_t> TextureCooker::encodeLevel(const vector<uint8_t>& pixels, uint32_t width, uint32_t height, TextureEncoding encoding)
+{
+	size_t block_size = getBlockSize(encoding);
+	if (block_size == 0)
+		return pixels;
+
+	size_t blocks_x = (width + 3) / 4;
+	size_t blocks_y = (height + 3) / 4;
+	vector<uint8_t> data(blocks_x * blocks_y * block_size);
+
+	// blocks which hang off the edge of the image repeat the last row/column
+	uint8_t texels[16 * 4];
+	uint8_t* block = data.data();
+	for (size_t by = 0; by < blocks_y; ++by)
+	{
+		for (size_t bx = 0; bx < blocks_x; ++bx)
+		{
+			for (size_t i = 0; i < 16; ++i)
+			{
+				size_t x = min((bx * 4) + (i % 4), (size_t)width - 1);
+				size_t y = min((by * 4) + (i / 4), (size_t)height - 1);
+				memcpy(texels + (i * 4), pixels.data() + (((y * width) + x) * 4), 4);
+			}
+			switch (encoding)
+			{
+			case ENCODING_BC1: encodeBC1(texels, block); break;
+			case ENCODING_BC3: encodeBC4(texels, 3, block); encodeBC1(texels, block + 8); break;
+			case ENCODING_BC4: encodeBC4(texels, 0, block); break;
+			case ENCODING_BC5: encodeBC4(texels, 0, block); encodeBC4(texels, 1, block + 8); break;
+			default: break;
+			}
+			block += block_size;
+		}
+	}
+	return data;
+}
+
+// mean squared error per channel, over the channels the encoding keeps and the texels which are visible
+float TextureCooker::getError(const vector<uint8_t>& pixels, const vector<uint8_t>& decoded, TextureEncoding encoding)
+{
+	size_t texel_size = getDecompressedTexelSize(encoding);
+	double error = 0;
+	size_t count = 0;
+	for (size_t i = 0; i < pixels.size() / 4; ++i)
+	{
+		if (texel_size == 4 && pixels[(i * 4) + 3] == 0)
+			continue;
+		for (size_t c = 0; c < texel_size; ++c)
+		{
+			double difference = (double)decoded[(i * texel_size) + c] - pixels[(i * 4) + c];
+			error += difference * difference;
+		}
+		count += texel_size;
+	}
+	return (count == 0) ? 0.0f : (float)(error / count);
+}
+
+// box filters down to the next mip level. colour is averaged in linear space, and normals are renormalised
+vector<uint8_t> TextureCooker::downsample(const vector<uint8_t>& pixels, uint32_t width, uint32_t height, TextureUsage usage)
+{
+	uint32_t new_width = max(width / 2, 1u);
+	uint32_t new_height = max(height / 2, 1u);
+	vector<uint8_t> result((size_t)new_width * new_height * 4);
+	for (size_t y = 0; y < new_height; ++y)
+	{
+		for (size_t x = 0; x < new_width; ++x)
+		{
+			size_t sources[4] =
+			{
+				((y * 2) * width) + (x * 2),
+				((y * 2) * width) + min((x * 2) + 1, (size_t)width - 1),
+				(min((y * 2) + 1, (size_t)height - 1) * width) + (x * 2),
+				(min((y * 2) + 1, (size_t)height - 1) * width) + min((x * 2) + 1, (size_t)width - 1)
+			};
+			float sum[4] = { 0, 0, 0, 0 };
+			for (size_t source : sources)
+			{
+				const uint8_t* texel = pixels.data() + (source * 4);
+				for (size_t c = 0; c < 4; ++c)
+				{
+					if (usage == TEXTURE_COLOUR && c < 3)
+						sum[c] += srgbToLinear(texel[c]);
+					else if (usage == TEXTURE_NORMAL && c < 3)
+						sum[c] += ((float)texel[c] / 127.5f) - 1.0f;
+					else
+						sum[c] += texel[c];
+				}
+			}
+
+			uint8_t* texel = result.data() + (((y * new_width) + x) * 4);
+			if (usage == TEXTURE_NORMAL)
+			{
+				float length = sqrtf((sum[0] * sum[0]) + (sum[1] * sum[1]) + (sum[2] * sum[2]));
+				if (length < 1e-6f)
+				{
+					sum[0] = 0; sum[1] = 0; sum[2] = 1; length = 1;
+				}
+				for (size_t c = 0; c < 3; ++c)
+					texel[c] = (uint8_t)clamp((int)((((sum[c] / length) + 1.0f) * 127.5f) + 0.5f), 0, 255);
+			}
+			else
+			{
+				for (size_t c = 0; c < 3; ++c)
+				{
+					if (usage == TEXTURE_COLOUR)
+						texel[c] = linearToSrgb(sum[c] / 4.0f);
+					else
+						texel[c] = (uint8_t)((sum[c] / 4.0f) + 0.5f);
+				}
+			}
+			texel[3] = (uint8_t)((sum[3] / 4.0f) + 0.5f);
+		}
+	}
+	return result;
+}
+
+// picks the nearest of the four colours between the endpoints for each texel, returning the error over the texels which are visible
+static uint32_t chooseBC1Indices(const uint8_t* texels, uint16_t colour0, uint16_t colour1, uint32_t& indices)
+{
+	int palette[4][3];
+	unpackRgb565(colour0, palette[0]);
+	unpackRgb565(colour1, palette[1]);
+	for (size_t c = 0; c < 3; ++c)
+	{
+		palette[2][c] = ((2 * palette[0][c]) + palette[1][c]) / 3;
+		palette[3][c] = (palette[0][c] + (2 * palette[1][c])) / 3;
+	}
+
+	indices = 0;
+	uint32_t error = 0;
+	for (size_t i = 0; i < 16; ++i)
+	{
+		int best_distance = INT32_MAX;
+		uint32_t best_index = 0;
+		for (uint32_t p = 0; p < 4; ++p)
+		{
+			int distance = 0;
+			for (size_t c = 0; c < 3; ++c)
+			{
+				int difference = (int)texels[(i * 4) + c] - palette[p][c];
+				distance += difference * difference;
+			}
+			if (distance < best_distance)
+			{
+				best_distance = distance;
+				best_index = p;
+			}
+		}
+		indices |= best_index << (i * 2);
+		if (texels[(i * 4) + 3] != 0)
+			error += best_distance;
+	}
+	return error;
+}
+
+// fits the endpoints to the principal axis of the block's colours, then refines them by least squares against the
+// chosen indices. always uses the four colour mode, and ignores the colour of fully transparent texels
+void TextureCooker::encodeBC1(const uint8_t* texels, uint8_t* block)
+{
+	// if nothing is visible, fit to everything instead
+	uint8_t fitted[16 * 4];
+	memcpy(fitted, texels, sizeof(fitted));
+	bool any_visible = false;
+	for (size_t i = 0; i < 16; ++i)
+		any_visible |= texels[(i * 4) + 3] != 0;
+	for (size_t i = 0; i < 16 && !any_visible; ++i)
+		fitted[(i * 4) + 3] = 255;
+
+	float mean[3] = { 0, 0, 0 };
+	size_t count = 0;
+	for (size_t i = 0; i < 16; ++i)
+	{
+		if (fitted[(i * 4) + 3] == 0)
+			continue;
+		for (size_t c = 0; c < 3; ++c)
+			mean[c] += fitted[(i * 4) + c];
+		++count;
+	}
+	for (size_t c = 0; c < 3; ++c)
+		mean[c] /= (float)count;
+	float covariance[6] = { 0, 0, 0, 0, 0, 0 };
+	for (size_t i = 0; i < 16; ++i)
+	{
+		if (fitted[(i * 4) + 3] == 0)
+			continue;
+		float r = fitted[(i * 4) + 0] - mean[0];
+		float g = fitted[(i * 4) + 1] - mean[1];
+		float b = fitted[(i * 4) + 2] - mean[2];
+		covariance[0] += r * r; covariance[1] += r * g; covariance[2] += r * b;
+		covariance[3] += g * g; covariance[4] += g * b; covariance[5] += b * b;
+	}
+	float axis[3] = { 1, 1, 1 };
+	for (size_t iteration = 0; iteration < 8; ++iteration)
+	{
+		float next[3] =
+		{
+			(covariance[0] * axis[0]) + (covariance[1] * axis[1]) + (covariance[2] * axis[2]),
+			(covariance[1] * axis[0]) + (covariance[3] * axis[1]) + (covariance[4] * axis[2]),
+			(covariance[2] * axis[0]) + (covariance[4] * axis[1]) + (covariance[5] * axis[2])
+		};
+		float length = max(max(fabsf(next[0]), fabsf(next[1])), fabsf(next[2]));
+		if (length < 1e-6f)
+			break;
+		for (size_t c = 0; c < 3; ++c)
+			axis[c] = next[c] / length;
+	}
+
+	float min_projection = INFINITY;
+	float max_projection = -INFINITY;
+	for (size_t i = 0; i < 16; ++i)
+	{
+		if (fitted[(i * 4) + 3] == 0)
+			continue;
+		float projection = 0;
+		for (size_t c = 0; c < 3; ++c)
+			projection += (fitted[(i * 4) + c] - mean[c]) * axis[c];
+		min_projection = min(min_projection, projection);
+		max_projection = max(max_projection, projection);
+	}
+	float axis_length = (axis[0] * axis[0]) + (axis[1] * axis[1]) + (axis[2] * axis[2]);
+	float end_a[3];
+	float end_b[3];
+	for (size_t c = 0; c < 3; ++c)
+	{
+		end_a[c] = mean[c] + (axis[c] * max_projection / axis_length);
+		end_b[c] = mean[c] + (axis[c] * min_projection / axis_length);
+	}
+
+	uint16_t colour0 = packRgb565(end_a);
+	uint16_t colour1 = packRgb565(end_b);
+	uint32_t indices = 0;
+	uint32_t error = chooseBC1Indices(fitted, colour0, colour1, indices);
+	for (size_t iteration = 0; iteration < 2 && error != 0; ++iteration)
+	{
+		// each index puts its texel a fixed fraction of the way between the endpoints, so solve for the endpoints directly
+		static const float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+		float aa = 0, bb = 0, ab = 0;
+		float ax[3] = { 0, 0, 0 };
+		float bx[3] = { 0, 0, 0 };
+		for (size_t i = 0; i < 16; ++i)
+		{
+			if (fitted[(i * 4) + 3] == 0)
+				continue;
+			float w = weights[(indices >> (i * 2)) & 3];
+			aa += w * w; bb += (1 - w) * (1 - w); ab += w * (1 - w);
+			for (size_t c = 0; c < 3; ++c)
+			{
+				ax[c] += w * fitted[(i * 4) + c];
+				bx[c] += (1 - w) * fitted[(i * 4) + c];
+			}
+		}
+		float determinant = (aa * bb) - (ab * ab);
+		if (fabsf(determinant) < 1e-6f)
+			break;
+		for (size_t c = 0; c < 3; ++c)
+		{
+			end_a[c] = ((bb * ax[c]) - (ab * bx[c])) / determinant;
+			end_b[c] = ((aa * bx[c]) - (ab * ax[c])) / determinant;
+		}
+		uint16_t refined0 = packRgb565(end_a);
+		uint16_t refined1 = packRgb565(end_b);
+		uint32_t refined_indices = 0;
+		uint32_t refined_error = chooseBC1Indices(fitted, refined0, refined1, refined_indices);
+		if (refined_error >= error)
+			break;
+		colour0 = refined0;
+		colour1 = refined1;
+		indices = refined_indices;
+		error = refined_error;
+	}
+
+	// the four colour mode needs the first endpoint to be larger, and swapping them maps each index to its mirror
+	if (colour0 < colour1)
+	{
+		swap(colour0, colour1);
+		indices ^= 0x55555555;
+	}
+	else if (colour0 == colour1)
+		indices = 0;
+
+	memcpy(block, &colour0, 2);
+	memcpy(block + 2, &colour1, 2);
+	memcpy(block + 4, &indices, 4);
+}
+
+// uses the eight value mode between the block's minimum and maximum
+void TextureCooker::encodeBC4(const uint8_t* texels, size_t channel, uint8_t* block)
+{
+	uint8_t min_value = 255;
+	uint8_t max_value = 0;
+	for (size_t i = 0; i < 16; ++i)
+	{
+		min_value = min(min_value, texels[(i * 4) + channel]);
+		max_value = max(max_value, texels[(i * 4) + channel]);
+	}
+
+	uint64_t indices = 0;
+	if (max_value != min_value)
+	{
+		int palette[8] = { max_value, min_value };
+		for (int p = 2; p < 8; ++p)
+			palette[p] = (((8 - p) * max_value) + ((p - 1) * min_value)) / 7;
+		for (size_t i = 0; i < 16; ++i)
+		{
+			int best_distance = INT32_MAX;
+			uint64_t best_index = 0;
+			for (uint64_t p = 0; p < 8; ++p)
+			{
+				int distance = abs((int)texels[(i * 4) + channel] - palette[p]);
+				if (distance < best_distance)
+				{
+					best_distance = distance;
+					best_index = p;
+				}
+			}
+			indices |= best_index << (i * 3);
+		}
+	}
+
+	block[0] = max_value;
+	block[1] = min_value;
+	for (size_t i = 0; i < 6; ++i)
+		block[2 + i] = (uint8_t)(indices >> (i * 8));
+}
+
+void TextureCooker::decodeBC1(const uint8_t* block, uint8_t* texels, bool allow_transparent)
+{
+	uint16_t colour0, colour1;
+	uint32_t indices;
+	memcpy(&colour0, block, 2);
+	memcpy(&colour1, block + 2, 2);
+	memcpy(&indices, block + 4, 4);
+
+	int palette[4][4];
+	unpackRgb565(colour0, palette[0]);
+	unpackRgb565(colour1, palette[1]);
+	palette[0][3] = 255; palette[1][3] = 255; palette[2][3] = 255; palette[3][3] = 255;
+	for (size_t c = 0; c < 3; ++c)
+	{
+		if (colour0 > colour1 || !allow_transparent)
+		{
+			palette[2][c] = ((2 * palette[0][c]) + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + (2 * palette[1][c])) / 3;
+		}
+		else
+		{
+			palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+			palette[3][c] = 0;
+			palette[3][3] = 0;
+		}
+	}
+	for (size_t i = 0; i < 16; ++i)
+	{
+		const int* colour = palette[(indices >> (i * 2)) & 3];
+		for (size_t c = 0; c < 4; ++c)
+			texels[(i * 4) + c] = (uint8_t)colour[c];
+	}
+}
+
+void TextureCooker::decodeBC4(const uint8_t* block, uint8_t* texels, size_t channel, size_t stride)
+{
+	int palette[8] = { block[0], block[1] };
+	if (palette[0] > palette[1])
+	{
+		for (int p = 2; p < 8; ++p)
+			palette[p] = (((8 - p) * palette[0]) + ((p - 1) * palette[1])) / 7;
+	}
+	else
+	{
+		for (int p = 2; p < 6; ++p)
+			palette[p] = (((6 - p) * palette[0]) + ((p - 1) * palette[1])) / 5;
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+
+	uint64_t indices = 0;
+	for (size_t i = 0; i < 6; ++i)
+		indices |= (uint64_t)block[2 + i] << (i * 8);
+	for (size_t i = 0; i < 16; ++i)
+		texels[(i * stride) + channel] = (uint8_t)palette[(indices >> (i * 3)) & 7];
+}
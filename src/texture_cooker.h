@@ -0,0 +1,88 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+
+#include "common.h"
+#include "package.h"
+
+namespace HopEngine
+{
+
+// what a texture holds decides how it is filtered and which block format it is stored in
+enum TextureUsage
+{
+	TEXTURE_COLOUR,
+	TEXTURE_NORMAL,
+	TEXTURE_MASK
+};
+
+enum TextureEncoding : uint32_t
+{
+	ENCODING_RGBA8,
+	ENCODING_BC1,
+	ENCODING_BC3,
+	ENCODING_BC4,
+	ENCODING_BC5
+};
+
+// cooked textures are stored as this header, followed by a CookedTextureLevel for each mip (largest first),
+// followed by the level data. each level starts on a 16 byte boundary, ready to be copied into a staging buffer
+struct CookedTextureHeader
+{
+	uint32_t signature;
+	uint32_t version;
+	uint32_t width;
+	uint32_t height;
+	TextureEncoding encoding;
+	uint32_t srgb;
+	uint32_t mip_count;
+	uint32_t reserved;
+};
+
+struct CookedTextureLevel
+{
+	uint32_t offset;
+	uint32_t size;
+	uint32_t width;
+	uint32_t height;
+};
+
+// converts source images into block compressed mip chains. package-builder runs this ahead of time, and
+// Texture uses it to decode images which haven't been cooked, or to decompress on devices without BC support
+class TextureCooker
+{
+public:
+	static constexpr uint32_t signature = 0xC00CED7E;
+	static constexpr uint32_t version = 1;
+	// roughly 30dB PSNR
+	static constexpr float max_block_error = 65.0f;
+	static constexpr uint32_t max_mip_count = 32;
+
+	DELETE_CONSTRUCTORS(TextureCooker);
+
+	static TextureUsage getUsage(std::string_view name);
+	static bool decodeImage(DataView file_data, std::vector<uint8_t>& pixels, uint32_t& width, uint32_t& height);
+	static std::vector<uint8_t> cook(std::vector<uint8_t> pixels, uint32_t width, uint32_t height, TextureUsage usage);
+	static bool isCooked(DataView data);
+	static bool readCooked(DataView data, CookedTextureHeader& header, std::vector<CookedTextureLevel>& levels);
+	// like readCooked, but from only the start of the data (at least the header and the level table), where size is the
+	// size of all of it. this checks cooked data before it's unpacked
+	static bool readCookedLayout(DataView data, size_t size, CookedTextureHeader& header, std::vector<CookedTextureLevel>& levels);
+	static std::vector<uint8_t> decompress(DataView level_data, uint32_t width, uint32_t height, TextureEncoding encoding);
+	// decompresses into pixels, which must hold width * height * getDecompressedTexelSize(encoding) bytes
+	static void decompressInto(DataView level_data, uint32_t width, uint32_t height, TextureEncoding encoding, uint8_t* pixels);
+	static size_t getBlockSize(TextureEncoding encoding);
+	static size_t getDecompressedTexelSize(TextureEncoding encoding);
+
+private:
+	static std::vector<uint8_t> encodeLevel(const std::vector<uint8_t>& pixels, uint32_t width, uint32_t height, TextureEncoding encoding);
+	static float getError(const std::vector<uint8_t>& pixels, const std::vector<uint8_t>& decoded, TextureEncoding encoding);
+	static std::vector<uint8_t> downsample(const std::vector<uint8_t>& pixels, uint32_t width, uint32_t height, TextureUsage usage);
+	static void encodeBC1(const uint8_t* texels, uint8_t* block);
+	static void encodeBC4(const uint8_t* texels, size_t channel, uint8_t* block);
+	static void decodeBC1(const uint8_t* block, uint8_t* texels, bool allow_transparent);
+	static void decodeBC4(const uint8_t* block, uint8_t* texels, size_t channel, size_t stride);
+};
+
+}
@@ -1,55 +1,166 @@
 #include "token_file.h"
 
 #include <format>
+#include <charconv>
+#include <bit>
+#include <cstring>
+#include <unordered_map>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define TOKEN_SCAN_AVX2
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define TOKEN_SCAN_SSE2
+#endif
 
 using namespace HopEngine;
 using namespace std;
 
-vector<TokenReader::Token> TokenReader::tokenise(const string& content, bool trim_comments, bool trim_whitespace)
+const array<TokenReader::TokenType, 256> TokenReader::char_types = []()
+{
+    array<TokenType, 256> types;
+    for (size_t i = 0; i < types.size(); ++i)
+        types[i] = getType((char)i);
+    return types;
+}();
+
+// wide versions of continuesRun, giving a mask with a set bit for each character which continues the run
+#if defined(TOKEN_SCAN_AVX2)
+typedef __m256i ScanChunk;
+static constexpr size_t SCAN_WIDTH = 32;
+static inline ScanChunk loadChunk(const char* data) { return _mm256_loadu_si256((const __m256i*)data); }
+static inline ScanChunk equals(ScanChunk chunk, char c) { return _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(c)); }
+static inline ScanChunk either(ScanChunk a, ScanChunk b) { return _mm256_or_si256(a, b); }
+static inline uint32_t toMask(ScanChunk chunk) { return (uint32_t)_mm256_movemask_epi8(chunk); }
+// unsigned compare, by checking that chunk - low doesn't get any smaller when clamped to high - low
+static inline ScanChunk inRange(ScanChunk chunk, char low, char high)
+{
+    ScanChunk offset = _mm256_sub_epi8(chunk, _mm256_set1_epi8(low));
+    return _mm256_cmpeq_epi8(_mm256_min_epu8(offset, _mm256_set1_epi8((char)(high - low))), offset);
+}
+#elif defined(TOKEN_SCAN_SSE2)
+typedef __m128i ScanChunk;
+static constexpr size_t SCAN_WIDTH = 16;
+static inline ScanChunk loadChunk(const char* data) { return _mm_loadu_si128((const __m128i*)data); }
+static inline ScanChunk equals(ScanChunk chunk, char c) { return _mm_cmpeq_epi8(chunk, _mm_set1_epi8(c)); }
+static inline ScanChunk either(ScanChunk a, ScanChunk b) { return _mm_or_si128(a, b); }
+static inline uint32_t toMask(ScanChunk chunk) { return (uint32_t)_mm_movemask_epi8(chunk); }
+// unsigned compare, by checking that chunk - low doesn't get any smaller when clamped to high - low
+static inline ScanChunk inRange(ScanChunk chunk, char low, char high)
+{
+    ScanChunk offset = _mm_sub_epi8(chunk, _mm_set1_epi8(low));
+    return _mm_cmpeq_epi8(_mm_min_epu8(offset, _mm_set1_epi8((char)(high - low))), offset);
+}
+#endif
+
+#if defined(TOKEN_SCAN_AVX2) || defined(TOKEN_SCAN_SSE2)
+static constexpr uint32_t SCAN_ALL = (uint32_t)((1ull << SCAN_WIDTH) - 1);
+
+static inline uint32_t whitespaceMask(ScanChunk chunk)
 {
-    string trimmed_content;
-    trimmed_content.reserve(content.size());
+    return toMask(either(either(equals(chunk, ' '), equals(chunk, '\t')), equals(chunk, '\r')));
+}
 
-    for (char c : content)
+// anything but the closing quote, or a ']' (which is an error outside vectors)
+static inline uint32_t stringMask(ScanChunk chunk)
+{
+    return ~toMask(either(equals(chunk, '\"'), equals(chunk, ']'))) & SCAN_ALL;
+}
+
+// any legal character but a newline or ']', grouped into as few ranges as possible
+static inline uint32_t commentMask(ScanChunk chunk)
+{
+    ScanChunk ranges = either(either(inRange(chunk, '(', ')'), inRange(chunk, ',', ';')), either(inRange(chunk, '@', '['), inRange(chunk, 'a', '{')));
+    ScanChunk symbols = either(either(equals(chunk, '='), equals(chunk, '_')), either(equals(chunk, '}'), equals(chunk, '\"')));
+    ScanChunk spaces = either(either(equals(chunk, ' '), equals(chunk, '\t')), equals(chunk, '\r'));
+    return toMask(either(either(ranges, symbols), spaces));
+}
+
+// whitespace, commas and the characters of numbers
+static inline uint32_t vectorMask(ScanChunk chunk)
+{
+    ScanChunk numbers = either(inRange(chunk, ',', '.'), inRange(chunk, '0', '9'));
+    return toMask(either(numbers, either(either(equals(chunk, ' '), equals(chunk, '\t')), equals(chunk, '\r'))));
+}
+
+// letters, digits, underscores and minus signs
+static inline uint32_t nameMask(ScanChunk chunk)
+{
+    ScanChunk letters = either(inRange(chunk, 'a', 'z'), inRange(chunk, 'A', 'Z'));
+    return toMask(either(letters, either(inRange(chunk, '0', '9'), either(equals(chunk, '_'), equals(chunk, '-')))));
+}
+#endif
+
+// returns the offset of the first character from offset which doesn't continue a token of this type
+size_t TokenReader::skipRun(string_view content, size_t offset, TokenType type)
+{
+#if defined(TOKEN_SCAN_AVX2) || defined(TOKEN_SCAN_SSE2)
+    while (offset + SCAN_WIDTH <= content.size())
     {
-        if (c != '\r')
-            trimmed_content.push_back(c);
+        ScanChunk chunk = loadChunk(content.data() + offset);
+        uint32_t mask = 0;
+        switch (type)
+        {
+        case WHITESPACE: mask = whitespaceMask(chunk); break;
+        case STRING: mask = stringMask(chunk); break;
+        case COMMENT: mask = commentMask(chunk); break;
+        case VECTOR: mask = vectorMask(chunk); break;
+        case TEXT:
+        case IDENTIFIER: mask = nameMask(chunk); break;
+        default: return offset;
+        }
+        if (mask != SCAN_ALL)
+            return offset + countr_one(mask);
+        offset += SCAN_WIDTH;
     }
+#endif
+    while (offset < content.size() && continuesRun(type, content[offset]))
+        ++offset;
+    return offset;
+}
 
-    if (trimmed_content.length() == 0) return { };
+// tokens refer straight into content (which has to outlive them), so nothing is allocated per token or per
+// character. carriage returns are treated as whitespace, so offsets passed to reportError are offsets into content.
+// runs of whitespace, keywords and identifiers, and the insides of strings, comments and vectors, are skipped in
+// bulk, stopping at the first character which would end the token or be an error
+vector<TokenReader::Token> TokenReader::tokenise(string_view content, bool trim_comments, bool trim_whitespace)
+{
+    if (content.length() == 0) return { };
 
     size_t offset = 0;
     vector<Token> tokens;
-    string current_token = "";
-    TokenType current_type = getType(trimmed_content[0]);
+    // roughly one token for every 6 characters in typical scenes
+    tokens.reserve(content.size() / 6);
+    TokenType current_type = char_types[(uint8_t)content[0]];
     size_t start_offset = 0;
     if (current_type != TEXT && current_type != COMMENT && current_type != WHITESPACE && current_type != NEWLINE)
     {
-        reportError("invalid first token", offset, trimmed_content);
+        reportError("invalid first token", offset, content);
         return { };
     }
 
     current_type = WHITESPACE;
 
-    while (offset < trimmed_content.length())
+    // only filled in when a token finishes
+    Token finished_token;
+    while (offset < content.length())
     {
-        char chr = trimmed_content[offset];
-        TokenType char_type = getType(chr);
+        char chr = content[offset];
+        TokenType char_type = char_types[(uint8_t)chr];
 
         TokenType new_type = current_type;
-        bool append_chr = true;
         bool reset_token = false;
-        Token finished_token = Token(current_type);
-        finished_token.start_offset = start_offset;
+        string_view current_token(content.data() + start_offset, offset - start_offset);
 
         if (char_type == INVALID && current_type != STRING)
         {
-            reportError("illegal character", offset, trimmed_content);
+            reportError("illegal character", offset, content);
             return { };
         }
         if (char_type == END_VECTOR && current_type != VECTOR)
         {
-            reportError("invalid end of vector token", offset, trimmed_content);
+            reportError("invalid end of vector token", offset, content);
             return { };
         }
 
@@ -66,13 +177,12 @@ vector<TokenReader::Token> TokenReader::tokenise(const string& content, bool tri
             }
             else
             {
-                reportError("invalid conjoined tokens", offset, trimmed_content);
+                reportError("invalid conjoined tokens", offset, content);
                 return { };
             }
         case STRING:
             if (char_type == STRING)
             {
-                append_chr = false;
                 finished_token.s_value = current_token.substr(1);
                 reset_token = true;
                 char_type = INVALID;
@@ -95,13 +205,17 @@ vector<TokenReader::Token> TokenReader::tokenise(const string& content, bool tri
             }
             else if (isSeparator(char_type))
             {
-                finished_token.i_value = stoi(current_token);
+                if (from_chars(current_token.data(), current_token.data() + current_token.size(), finished_token.i_value).ec != errc())
+                {
+                    reportError("invalid int literal", start_offset, content);
+                    return { };
+                }
                 reset_token = true;
                 break;
             }
             else
             {
-                reportError("invalid conjoined tokens", offset, trimmed_content);
+                reportError("invalid conjoined tokens", offset, content);
                 return { };
             }
         case FLOAT:
@@ -109,18 +223,22 @@ vector<TokenReader::Token> TokenReader::tokenise(const string& content, bool tri
                 break;
             else if (char_type == FLOAT)
             {
-                reportError("invalid float literal", offset, trimmed_content);
+                reportError("invalid float literal", offset, content);
                 return { };
             }
             else if (isSeparator(char_type))
             {
-                finished_token.f_value = stof(current_token);
+                if (from_chars(current_token.data(), current_token.data() + current_token.size(), finished_token.f_value).ec != errc())
+                {
+                    reportError("invalid float literal", start_offset, content);
+                    return { };
+                }
                 reset_token = true;
                 break;
             }
             else
             {
-                reportError("invalid conjoined tokens", offset, trimmed_content);
+                reportError("invalid conjoined tokens", offset, content);
                 return { };
             }
         case IDENTIFIER:
@@ -134,45 +252,38 @@ vector<TokenReader::Token> TokenReader::tokenise(const string& content, bool tri
             }
             else
             {
-                reportError("invalid conjoined tokens", offset, trimmed_content);
+                reportError("invalid conjoined tokens", offset, content);
                 return { };
             }
         case VECTOR:
-            if (char_type == WHITESPACE)
-            {
-                append_chr = false;
-                break;
-            }
-            else if (char_type == INT || char_type == FLOAT || char_type == COMMA)
+            if (char_type == WHITESPACE || char_type == INT || char_type == FLOAT || char_type == COMMA)
                 break;
             else if (char_type == END_VECTOR)
             {
-                finished_token.c_value = deserialiseVectorToken(current_token.substr(1), offset, trimmed_content);
-                append_chr = false;
+                finished_token.c_value = deserialiseVectorToken(current_token.substr(1), offset, content);
                 reset_token = true;
                 char_type = INVALID;
                 break;
             }
             else if (char_type == VECTOR)
             {
-                reportError("invalid nested vector token", offset, trimmed_content);
+                reportError("invalid nested vector token", offset, content);
                 return { };
             }
             else
             {
-                reportError("invalid token inside vector", offset, trimmed_content);
+                reportError("invalid token inside vector", offset, content);
                 return { };
             }
         case COMMENT:
             if (char_type != COMMENT && current_token.length() < 2)
             {
-                reportError("incomplete comment initiator", offset, trimmed_content);
+                reportError("incomplete comment initiator", offset, content);
                 return { };
             }
             else if (char_type == NEWLINE)
             {
                 finished_token.s_value = current_token;
-                append_chr = false;
                 reset_token = true;
                 break;
             }
@@ -189,7 +300,7 @@ vector<TokenReader::Token> TokenReader::tokenise(const string& content, bool tri
         case INVALID:
             if (!isSeparator(char_type))
             {
-                reportError("invalid conjoined tokens", offset, trimmed_content);
+                reportError("invalid conjoined tokens", offset, content);
                 return { };
             }
             else
@@ -211,329 +322,350 @@ vector<TokenReader::Token> TokenReader::tokenise(const string& content, bool tri
                 // ignore the token
             }
             else
+            {
+                finished_token.type = current_type;
+                finished_token.start_offset = start_offset;
                 tokens.push_back(finished_token);
-            current_token = "";
+            }
+            finished_token = Token();
             start_offset = offset;
             new_type = char_type;
         }
         current_type = new_type;
 
-        if (append_chr)
-            current_token.push_back(chr);
-
         offset++;
+        // comments have to be checked for the second '/' first
+        if (current_type == WHITESPACE || current_type == STRING || current_type == VECTOR || current_type == TEXT || current_type == IDENTIFIER || (current_type == COMMENT && offset - start_offset >= 2))
+            offset = skipRun(content, offset, current_type);
     }
     
     if (current_type == VECTOR || current_type == STRING)
     {
-        reportError("invalid unclosed token at end of content", offset - 2, trimmed_content);
+        reportError("invalid unclosed token at end of content", offset - 2, content);
         return { };
     }
 
     return tokens;
 }
 
-size_t TokenReader::findClosingBrace(const vector<Token>& tokens, size_t open_index, const string& original_content)
+// matches every bracket in one pass, so closing[i] is the index of the bracket which closes the one at i
+bool TokenReader::matchBrackets(const vector<Token>& tokens, vector<size_t>& closing, string_view original_content)
 {
-    vector<Token> brackets;
-    size_t index = open_index;
-
-    while (index < tokens.size())
+    closing.assign(tokens.size(), 0);
+    vector<size_t> open;
+    open.reserve(16);
+    for (size_t index = 0; index < tokens.size(); ++index)
     {
         switch (tokens[index].type)
         {
         case OPEN_ROUND:
         case OPEN_CURLY:
-            brackets.push_back(tokens[index]);
+            open.push_back(index);
             break;
         case CLOSE_ROUND:
-            if (!brackets.empty() && brackets[brackets.size() - 1].type == TokenType::OPEN_ROUND)
-                brackets.pop_back();
-            else
-                return reportError("invalid closing bracket", tokens[index].start_offset, original_content);
+            if (open.empty() || tokens[open.back()].type != OPEN_ROUND)
+            {
+                reportError("invalid closing bracket", tokens[index].start_offset, original_content);
+                return false;
+            }
+            closing[open.back()] = index;
+            open.pop_back();
             break;
         case CLOSE_CURLY:
-            if (!brackets.empty() && brackets[brackets.size() - 1].type == TokenType::OPEN_CURLY)
-                brackets.pop_back();
-            else
-                return reportError("invalid closing curly brace", tokens[index].start_offset, original_content);
+            if (open.empty() || tokens[open.back()].type != OPEN_CURLY)
+            {
+                reportError("invalid closing curly brace", tokens[index].start_offset, original_content);
+                return false;
+            }
+            closing[open.back()] = index;
+            open.pop_back();
             break;
         default:
             break;
         }
+    }
 
-        if (brackets.size() == 0)
-            break;
+    if (!open.empty())
+    {
+        reportError("missing closing " + string(tokens[open.back()].type == OPEN_ROUND ? "bracket" : "curly brace"), tokens[open.back()].start_offset, original_content);
+        return false;
+    }
+
+    return true;
+}
 
-        ++index;
+// the tree is built a block at a time, breadth first, so each statement's children end up next to each other.
+// statements only get their spans once everything has been parsed, since the arrays may not move after that
+TokenReader::SyntaxTree TokenReader::extractSyntaxTree(const vector<Token>& tokens, string_view original_content)
+{
+    vector<size_t> closing;
+    if (!matchBrackets(tokens, closing, original_content))
+        return { };
+
+    // every statement but the last in a block ends with a semicolon, and every argument but the last in a list
+    // ends with a comma, so these are upper bounds and the arrays never grow
+    size_t max_statements = 1;
+    size_t max_arguments = 0;
+    for (const Token& token : tokens)
+    {
+        if (token.type == SEMICOLON || token.type == OPEN_CURLY)
+            ++max_statements;
+        else if (token.type == COMMA || token.type == OPEN_ROUND)
+            ++max_arguments;
     }
 
-    if (index >= tokens.size())
-        return reportError("missing closing " + string(tokens[open_index].type == TokenType::OPEN_ROUND ? "bracket" : "curly brace"), tokens[open_index].start_offset, original_content);
+    SyntaxTree tree;
+    tree.statements.reserve(max_statements);
+    tree.arguments.reserve(max_arguments);
+    vector<StatementLayout> layouts;
+    layouts.reserve(max_statements);
 
-    return index;
+    if (!parseBlock(tokens, 0, tokens.size(), closing, original_content, tree, layouts))
+        return { };
+    tree.root_count = tree.statements.size();
+
+    for (size_t index = 0; index < tree.statements.size(); ++index)
+    {
+        if (layouts[index].children_start == layouts[index].children_end)
+            continue;
+        size_t first_child = tree.statements.size();
+        if (!parseBlock(tokens, layouts[index].children_start, layouts[index].children_end, closing, original_content, tree, layouts))
+            return { };
+        layouts[index].first_child = first_child;
+        layouts[index].child_count = tree.statements.size() - first_child;
+    }
+
+    for (size_t index = 0; index < tree.statements.size(); ++index)
+    {
+        const StatementLayout& layout = layouts[index];
+        tree.statements[index].arguments = span<const Argument>(tree.arguments.data() + layout.first_argument, layout.argument_count);
+        tree.statements[index].children = span<const Statement>(tree.statements.data() + layout.first_child, layout.child_count);
+    }
+
+    return tree;
 }
 
-vector<TokenReader::Statement> TokenReader::extractSyntaxTree(const vector<Token>& tokens, const string& original_content)
+// parses the statements in tokens [start, end) onto the end of the tree, recording where their arguments and child tokens are
+bool TokenReader::parseBlock(const vector<Token>& tokens, size_t start, size_t end, const vector<size_t>& closing, string_view original_content, SyntaxTree& tree, vector<StatementLayout>& layouts)
 {
-    vector<Statement> statements;
-
-    auto statement_start_it = tokens.begin();
-    while (statement_start_it != tokens.end())
-    {
-        auto arg_start_it = tokens.end();
-        auto arg_end_it = tokens.end();
-        auto identifier_it = tokens.end();
-        auto children_start_it = tokens.end();
-        auto children_end_it = tokens.end();
-        auto statement_end_it = tokens.end();
-        auto current_it = statement_start_it;
+    size_t current = start;
+    while (current < end)
+    {
+        size_t keyword = end;
+        size_t arg_start = end;
+        size_t arg_end = end;
+        size_t identifier = end;
+        size_t children_start = end;
+        size_t children_end = end;
         int stage = 0;
-        while (current_it != tokens.end() && stage <= 5)
+        while (current < end)
         {
-            if (current_it->type == WHITESPACE || current_it->type == COMMENT || current_it->type == NEWLINE)
+            const Token& token = tokens[current];
+            if (token.type == WHITESPACE || token.type == COMMENT || token.type == NEWLINE)
             {
-                ++current_it;
+                ++current;
                 continue;
             }
-            
-            if (current_it->type == SEMICOLON)
-            {
-                statement_end_it = current_it;
+
+            if (token.type == SEMICOLON)
                 break;
-            }
 
             switch (stage)
             {
             case 0: // looking for the keyword
-                if (current_it->type == TEXT)
+                if (token.type == TEXT)
                 {
-                    statement_start_it = current_it;
+                    keyword = current;
                     stage = 1;
                 }
                 else
                 {
-                    reportError("expected keyword", current_it->start_offset, original_content);
-                    return { };
+                    reportError("expected keyword", token.start_offset, original_content);
+                    return false;
                 }
                 break;
             case 1: // looking for the argument list
-                if (current_it->type == OPEN_ROUND)
+                if (token.type == OPEN_ROUND)
                 {
-                    arg_start_it = current_it;
-                    arg_end_it = tokens.begin() + findClosingBrace(tokens, current_it - tokens.begin(), original_content);
-                    current_it = arg_end_it;
+                    arg_start = current;
+                    arg_end = closing[current];
+                    current = arg_end;
                     stage = 2;
                 }
-                else if (current_it->type == COLON)
+                else if (token.type == COLON)
                 {
                     stage = 3;
                 }
-                else if (current_it->type == OPEN_CURLY)
-                {
-                    stage = 5;
-                    --current_it;
-                }
                 else
                 {
-                    reportError("unexpected token", current_it->start_offset, original_content);
-                    return { };
+                    reportError("unexpected token", token.start_offset, original_content);
+                    return false;
                 }
                 break;
             case 2: // looking for the colon
-                if (current_it->type == COLON)
+                if (token.type == COLON)
                 {
                     stage = 3;
                 }
-                else if (current_it->type == OPEN_CURLY)
+                else if (token.type == OPEN_CURLY)
                 {
                     stage = 4;
-                    --current_it;
+                    --current;
                 }
                 else
                 {
-                    reportError("unexpected token", current_it->start_offset, original_content);
-                    return { };
+                    reportError("unexpected token", token.start_offset, original_content);
+                    return false;
                 }
                 break;
             case 3: // looking for the identifier
-                if (current_it->type == TEXT)
+                if (token.type == TEXT)
                 {
-                    identifier_it = current_it;
+                    identifier = current;
                     stage = 4;
                 }
                 else
                 {
-                    reportError("expected identifier", current_it->start_offset, original_content);
-                    return { };
+                    reportError("expected identifier", token.start_offset, original_content);
+                    return false;
                 }
                 break;
             case 4: // looking for the child list
-                if (current_it->type == OPEN_CURLY)
+                if (token.type == OPEN_CURLY)
                 {
-                    children_start_it = current_it;
-                    children_end_it = tokens.begin() + findClosingBrace(tokens, current_it - tokens.begin(), original_content);
-                    current_it = children_end_it;
+                    children_start = current + 1;
+                    children_end = closing[current];
+                    current = children_end;
                     stage = 5;
                 }
                 else
                 {
-                    reportError("unexpected token", current_it->start_offset, original_content);
-                    return { };
+                    reportError("unexpected token", token.start_offset, original_content);
+                    return false;
                 }
                 break;
-            case 5: // looking for the semicolon
-                if (current_it->type == SEMICOLON)
-                {
-                    statement_end_it = current_it;
-                    break;
-                }
-                else
-                {
-                    reportError("unexpected token", current_it->start_offset, original_content);
-                    return { };
-                }
-                break;
-            default:
-                reportError("unexpected token", current_it->start_offset, original_content);
-                return { };
-                break;
+            default: // looking for the semicolon
+                reportError("unexpected token", token.start_offset, original_content);
+                return false;
             }
 
-            ++current_it;
+            ++current;
         }
 
-        if (statement_start_it == tokens.end())
-            break;
+        // skips the semicolon
+        ++current;
+        if (keyword == end)
+            continue;
 
         Statement statement;
-        statement.keyword = statement_start_it->s_value;
-        if (arg_start_it != arg_end_it)
-            statement.arguments = parseArguments(arg_start_it, arg_end_it, original_content);
-        if (identifier_it != tokens.end())
-            statement.identifier = identifier_it->s_value;
-        if (children_start_it != children_end_it)
+        StatementLayout layout;
+        statement.keyword = tokens[keyword].s_value;
+        statement.keyword_symbol = findKeyword(statement.keyword);
+        if (identifier != end)
+            statement.identifier = tokens[identifier].s_value;
+        layout.first_argument = tree.arguments.size();
+        // a malformed argument list is reported, but the statement is kept without arguments
+        if (arg_start != arg_end && !parseArguments(tokens, arg_start + 1, arg_end, original_content, tree.arguments))
+            tree.arguments.resize(layout.first_argument);
+        layout.argument_count = tree.arguments.size() - layout.first_argument;
+        if (children_start != end)
         {
-            vector<Token> child_tokens;
-            child_tokens.insert(child_tokens.begin(), children_start_it + 1, children_end_it - 1);
-            statement.children = extractSyntaxTree(child_tokens, original_content);
+            layout.children_start = children_start;
+            layout.children_end = children_end;
         }
-        statements.push_back(statement);
-
-        statement_start_it = statement_end_it;
-        if (statement_start_it == tokens.end())
-            break;
-
-        ++statement_start_it;
+        tree.statements.push_back(statement);
+        layouts.push_back(layout);
     }
 
-    return statements;
+    return true;
 }
 
-bool TokenReader::readStatement(const Statement& statement, bool children_allowed, bool requires_identifier, const vector<TokenType> expected_args, vector<Token>& extracted_args, string error_base)
+bool TokenReader::readStatement(const Statement& statement, const StatementSchema& schema, StatementArguments& arguments, string_view error_base)
 {
+    arguments.schema = &schema;
+    arguments.values.fill(nullptr);
     // check if there are children
-    if (!statement.children.empty() && !children_allowed)
+    if (!statement.children.empty() && !schema.children_allowed)
     {
-        DBG_ERROR(error_base + ": children are not allowed in a '" + statement.keyword + "' statement");
+        DBG_ERROR(string(error_base) + ": children are not allowed in a '" + string(statement.keyword) + "' statement");
         return false;
     }
     // check if there is an identifier
-    if (statement.identifier.empty() && requires_identifier)
+    if (statement.identifier.empty() && schema.requires_identifier)
     {
-        DBG_ERROR(error_base + ": an identifier is required in a '" + statement.keyword + "' statement");
+        DBG_ERROR(string(error_base) + ": an identifier is required in a '" + string(statement.keyword) + "' statement");
         return false;
     }
-    // check if enough args are present
-    if (statement.arguments.size() > expected_args.size())
-    {
-        DBG_ERROR(error_base + ": too many arguments in '" + statement.keyword + "' statement, requires " + to_string(expected_args.size()));
-        return false;
-    }
-    if (statement.arguments.size() < expected_args.size())
-    {
-        DBG_ERROR(error_base + ": not enough arguments in '" + statement.keyword + "' statement, requires " + to_string(expected_args.size()));
-        return false;
-    }
-    // check if there are named arguments (not allowed)
-    if (!checkNamedArgs(statement, false))
-    {
-        DBG_ERROR(error_base + ": named arguments are not allowed in a '" + statement.keyword + "' statement");
-        return false;
-    }
-    // check if all the args have the expected types
-    vector<Token> extracted;
-    size_t index = 0;
-    for (const auto& arg : statement.arguments)
+
+    if (!schema.named)
     {
-        if (arg.second.type != expected_args[index])
+        // check if enough args are present
+        if (statement.arguments.size() > schema.argument_count)
         {
-            DBG_ERROR(error_base + ": argument " + to_string(index) + " in a '" + statement.keyword + "' statement must be a " + typeToString(expected_args[index]));
+            DBG_ERROR(string(error_base) + ": too many arguments in '" + string(statement.keyword) + "' statement, requires " + to_string(schema.argument_count));
             return false;
         }
-        extracted.push_back(arg.second);
-        ++index;
+        if (statement.arguments.size() < schema.argument_count)
+        {
+            DBG_ERROR(string(error_base) + ": not enough arguments in '" + string(statement.keyword) + "' statement, requires " + to_string(schema.argument_count));
+            return false;
+        }
+        // check if there are named arguments (not allowed)
+        if (!checkNamedArgs(statement, false))
+        {
+            DBG_ERROR(string(error_base) + ": named arguments are not allowed in a '" + string(statement.keyword) + "' statement");
+            return false;
+        }
+        // check if all the args have the expected types
+        for (size_t index = 0; index < statement.arguments.size(); ++index)
+        {
+            const Argument& arg = statement.arguments[index];
+            if (arg.value.type != schema.arguments[index].type)
+            {
+                DBG_ERROR(string(error_base) + ": argument " + to_string(index) + " in a '" + string(statement.keyword) + "' statement must be a " + typeToString(schema.arguments[index].type));
+                return false;
+            }
+            arguments.values[index] = &arg.value;
+        }
+        return true;
     }
 
-    extracted_args = extracted;
-
-    return true;
-}
-
-bool TokenReader::readStatement(const Statement& statement, bool children_allowed, bool requires_identifier, const std::map<std::string, std::pair<TokenType, bool>> expected_args, std::map<std::string, Token>& extracted_args, std::string error_base)
-{
-    // check if there are children
-    if (!statement.children.empty() && !children_allowed)
-    {
-        DBG_ERROR(error_base + ": children are not allowed in a '" + statement.keyword + "' statement");
-        return false;
-    }
-    // check if there is an identifier
-    if (statement.identifier.empty() && requires_identifier)
-    {
-        DBG_ERROR(error_base + ": an identifier is required in a '" + statement.keyword + "' statement");
-        return false;
-    }
     // check if there are non-named arguments (not allowed)
     if (!checkNamedArgs(statement, true))
     {
-        DBG_ERROR(error_base + ": only named arguments are allowed in a '" + statement.keyword + "' statement");
+        DBG_ERROR(string(error_base) + ": only named arguments are allowed in a '" + string(statement.keyword) + "' statement");
         return false;
     }
-    // for each arg, check if it is present, throw error if it is not present and required, or if it is the wrong type
-    // check for duplicate args, and unrecognised args
-    for (const auto& arg : statement.arguments)
+    // for each arg, check if it is expected, and not a duplicate or the wrong type. names were resolved to symbols
+    // when the statement was parsed, so each check is one lookup
+    for (const Argument& arg : statement.arguments)
     {
-        auto it = expected_args.find(arg.first);
-        if (it == expected_args.end())
+        int8_t slot = schema.slots[arg.name_symbol];
+        if (arg.name_symbol == NO_SYMBOL || slot < 0)
         {
-            DBG_ERROR(error_base + ": invalid argument '" + arg.first + "' in '" + statement.keyword + "' statement");
+            DBG_ERROR(string(error_base) + ": invalid argument '" + string(arg.name) + "' in '" + string(statement.keyword) + "' statement");
             return false;
         }
-        auto is_found = extracted_args.find(arg.first);
-        if (is_found != extracted_args.end())
+        if (arguments.values[slot] != nullptr)
         {
-            DBG_ERROR(error_base + ": duplicate argument '" + arg.first + "' in '" + statement.keyword + "' statement");
+            DBG_ERROR(string(error_base) + ": duplicate argument '" + string(arg.name) + "' in '" + string(statement.keyword) + "' statement");
             return false;
         }
-        if (arg.second.type != it->second.first)
+        if (arg.value.type != schema.arguments[slot].type)
         {
-            DBG_ERROR(error_base + ": argument '" + arg.first + "' has wrong type for '" + statement.keyword + "' statement, must be a " + typeToString(it->second.first));
+            DBG_ERROR(string(error_base) + ": argument '" + string(arg.name) + "' has wrong type for '" + string(statement.keyword) + "' statement, must be a " + typeToString(schema.arguments[slot].type));
             return false;
         }
-        extracted_args[arg.first] = arg.second;
+        arguments.values[slot] = &arg.value;
     }
     // check if all args are present
-    for (const auto& expected : expected_args)
+    for (size_t index = 0; index < schema.argument_count; ++index)
     {
-        if (expected.second.second)
+        const ArgumentSchema& expected = schema.arguments[index];
+        if (expected.required && arguments.values[index] == nullptr)
         {
-            auto is_found = extracted_args.find(expected.first);
-            if (is_found == extracted_args.end())
-            {
-                DBG_ERROR(error_base + ": argument '" + expected.first + "' is required for '" + statement.keyword + "' statement, must be a " + typeToString(expected.second.first));
-                return false;
-            }
+            DBG_ERROR(string(error_base) + ": argument '" + string(symbol_names[expected.name]) + "' is required for '" + string(statement.keyword) + "' statement, must be a " + typeToString(expected.type));
+            return false;
         }
     }
 
@@ -544,58 +676,54 @@ bool TokenReader::checkNamedArgs(const Statement& statement, bool named)
 {
     for (const auto& arg : statement.arguments)
     {
-        if (arg.first.empty() == named)
+        if (arg.name.empty() == named)
             return false;
     }
     return true;
 }
 
-glm::vec4 TokenReader::deserialiseVectorToken(string str, size_t offset, const string& original_content)
+glm::vec4 TokenReader::deserialiseVectorToken(string_view str, size_t offset, string_view original_content)
 {
-    vector<float> values;
-    
-    try
-    {
-        size_t next_comma = -1;
-        do
-        {
-            size_t last_comma = next_comma + 1;
-            next_comma = str.find(',', last_comma);
-            values.push_back(stof(str.substr(last_comma, next_comma - last_comma)));
-        } while (next_comma != string::npos);
-    }
-    catch (invalid_argument e)
-    {
-        reportError("invalid vector literal", offset, original_content);
-        return { 0, 0, 0, 0 };
-    }
-
-    if (values.size() > 4)
-    {
-        reportError("too many values in vector literal", offset, original_content);
-        return { 0, 0, 0, 0 };
-    }
-
     glm::vec4 value = { 0, 0, 0, 0 };
-    for (size_t i = 0; i < values.size(); ++i)
+    size_t count = 0;
+    size_t next_comma = -1;
+    do
     {
-        value[i] = values[i];
-    }
+        size_t last_comma = next_comma + 1;
+        next_comma = str.find(',', last_comma);
+        string_view element = str.substr(last_comma, next_comma - last_comma);
+        while (!element.empty() && getType(element.front()) == WHITESPACE)
+            element.remove_prefix(1);
+
+        float element_value = 0;
+        if (from_chars(element.data(), element.data() + element.size(), element_value).ec != errc())
+        {
+            reportError("invalid vector literal", offset, original_content);
+            return { 0, 0, 0, 0 };
+        }
+        if (count == 4)
+        {
+            reportError("too many values in vector literal", offset, original_content);
+            return { 0, 0, 0, 0 };
+        }
+        value[count++] = element_value;
+    } while (next_comma != string::npos);
 
     return value;
 }
 
-vector<pair<string, TokenReader::Token>> TokenReader::parseArguments(vector<Token>::const_iterator start, vector<Token>::const_iterator end, string original_content)
+// parses the arguments in tokens [start, end) onto the end of arguments
+bool TokenReader::parseArguments(const vector<Token>& tokens, size_t start, size_t end, string_view original_content, vector<Argument>& arguments)
 {
-    auto current = start + 1;
+    size_t current = start;
 
-    vector<pair<string, Token>> arguments;
     Token keyword_token(TEXT);
     int stage = 0;
 
     while (current != end)
     {
-        if (current->type == WHITESPACE || current->type == COMMENT || current->type == NEWLINE)
+        const Token& token = tokens[current];
+        if (token.type == WHITESPACE || token.type == COMMENT || token.type == NEWLINE)
         {
             ++current;
             continue;
@@ -604,11 +732,11 @@ vector<pair<string, TokenReader::Token>> TokenReader::parseArguments(vector<Toke
         switch (stage)
         {
         case 0: // looking for the argument identifier or value
-            switch (current->type)
+            switch (token.type)
             {
             case TEXT:
                 stage = 1;
-                keyword_token = *current;
+                keyword_token = token;
                 break;
             case VECTOR:
             case STRING:
@@ -616,31 +744,32 @@ vector<pair<string, TokenReader::Token>> TokenReader::parseArguments(vector<Toke
             case FLOAT:
             case IDENTIFIER:
                 keyword_token = Token(TEXT);
-                arguments.push_back({ "", *current });
+                arguments.push_back({ string_view(), NO_SYMBOL, token });
                 stage = 3;
                 break;
             default:
-                reportError("unexpected token", current->start_offset, original_content);
-                return { };
+                reportError("unexpected token", token.start_offset, original_content);
+                return false;
             }
             break;
         case 1: // looking for the equals sign
-            if (current->type == COMMA)
+            if (token.type == COMMA)
             {
-                arguments.push_back({ "", keyword_token });
+                keyword_token.symbol = findValue(keyword_token.s_value);
+                arguments.push_back({ string_view(), NO_SYMBOL, keyword_token });
                 keyword_token = Token(TEXT);
                 stage = 0;
             }
-            else if (current->type == EQUALS)
+            else if (token.type == EQUALS)
                 stage = 2;
             else
             {
-                reportError("unexpected token", current->start_offset, original_content);
-                return { };
+                reportError("unexpected token", token.start_offset, original_content);
+                return false;
             }
             break;
         case 2: // looking for the argument value
-            switch (current->type)
+            switch (token.type)
             {
             case TEXT:
             case VECTOR:
@@ -648,22 +777,24 @@ vector<pair<string, TokenReader::Token>> TokenReader::parseArguments(vector<Toke
             case INT:
             case FLOAT:
             case IDENTIFIER:
-                arguments.push_back({ keyword_token.s_value, *current });
+                arguments.push_back({ keyword_token.s_value, findArgumentName(keyword_token.s_value), token });
+                if (token.type == TEXT)
+                    arguments.back().value.symbol = findValue(token.s_value);
                 keyword_token = Token(TEXT);
                 stage = 3;
                 break;
             default:
-                reportError("unexpected token", current->start_offset, original_content);
-                return { };
+                reportError("unexpected token", token.start_offset, original_content);
+                return false;
             }
             break;
         case 3: // looking for comma
-            if (current->type == COMMA)
+            if (token.type == COMMA)
                 stage = 0;
             else
             {
-                reportError("unexpected token", current->start_offset, original_content);
-                return { };
+                reportError("unexpected token", token.start_offset, original_content);
+                return false;
             }
             break;
         }
@@ -671,10 +802,300 @@ vector<pair<string, TokenReader::Token>> TokenReader::parseArguments(vector<Toke
         ++current;
     }
 
-    return arguments;
+    return true;
+}
+
+// symbols are looked up through perfect hash tables, built at compile time by trying seeds until every word in a
+// group lands in its own slot. a lookup is then one hash and one comparison
+static constexpr size_t SYMBOL_SLOTS = 128;
+
+struct SymbolHashTable
+{
+    uint32_t seed = 0;
+    array<uint16_t, SYMBOL_SLOTS> slots = { };
+};
+
+static constexpr uint32_t hashWord(string_view word, uint32_t seed)
+{
+    uint32_t hash = 2166136261u ^ seed;
+    for (char c : word)
+    {
+        hash ^= (uint8_t)c;
+        hash *= 16777619u;
+    }
+    return hash ^ (hash >> 15);
+}
+
+static constexpr SymbolHashTable buildSymbolTable(uint16_t first, uint16_t end)
+{
+    SymbolHashTable table;
+    for (uint32_t seed = 0; ; ++seed)
+    {
+        table.seed = seed;
+        table.slots.fill(TokenReader::NO_SYMBOL);
+        bool collided = false;
+        for (uint16_t symbol = first; symbol < end && !collided; ++symbol)
+        {
+            uint16_t& slot = table.slots[hashWord(TokenReader::symbol_names[symbol], seed) % SYMBOL_SLOTS];
+            collided = (slot != TokenReader::NO_SYMBOL);
+            slot = symbol;
+        }
+        if (!collided)
+            return table;
+    }
+}
+
+static constexpr SymbolHashTable KEYWORD_TABLE = buildSymbolTable(TokenReader::KEYWORD_RESOURCE, TokenReader::ARGUMENT_OPERATION);
+static constexpr SymbolHashTable ARGUMENT_TABLE = buildSymbolTable(TokenReader::ARGUMENT_OPERATION, TokenReader::VALUE_SHADER);
+static constexpr SymbolHashTable VALUE_TABLE = buildSymbolTable(TokenReader::VALUE_SHADER, TokenReader::SYMBOL_COUNT);
+
+static inline TokenReader::Symbol findInTable(const SymbolHashTable& table, string_view word)
+{
+    uint16_t symbol = table.slots[hashWord(word, table.seed) % SYMBOL_SLOTS];
+    if (symbol != TokenReader::NO_SYMBOL && TokenReader::symbol_names[symbol] == word)
+        return (TokenReader::Symbol)symbol;
+    return TokenReader::NO_SYMBOL;
+}
+
+TokenReader::Symbol TokenReader::findKeyword(string_view word)
+{
+    return findInTable(KEYWORD_TABLE, word);
+}
+
+TokenReader::Symbol TokenReader::findArgumentName(string_view word)
+{
+    return findInTable(ARGUMENT_TABLE, word);
+}
+
+TokenReader::Symbol TokenReader::findValue(string_view word)
+{
+    return findInTable(VALUE_TABLE, word);
+}
+
+vector<uint8_t> TokenReader::compile(const SyntaxTree& tree)
+{
+    // each distinct string is only stored once
+    vector<CompiledString> strings;
+    string string_data;
+    unordered_map<string_view, uint32_t> string_indices;
+    auto addString = [&](string_view str, Symbol symbol)
+    {
+        if (str.empty() || symbol != NO_SYMBOL)
+            return no_string;
+        auto it = string_indices.find(str);
+        if (it == string_indices.end())
+        {
+            it = string_indices.insert({ str, (uint32_t)strings.size() }).first;
+            strings.push_back({ (uint32_t)string_data.size(), (uint32_t)str.size() });
+            string_data += str;
+        }
+        return it->second;
+    };
+
+    vector<CompiledStatement> statements(tree.statements.size());
+    for (size_t i = 0; i < tree.statements.size(); ++i)
+    {
+        const Statement& statement = tree.statements[i];
+        CompiledStatement& compiled = statements[i];
+        compiled.keyword_symbol = statement.keyword_symbol;
+        compiled.reserved = 0;
+        compiled.keyword = addString(statement.keyword, statement.keyword_symbol);
+        compiled.identifier = addString(statement.identifier, NO_SYMBOL);
+        compiled.argument_count = (uint32_t)statement.arguments.size();
+        compiled.child_count = (uint32_t)statement.children.size();
+    }
+
+    vector<CompiledArgument> arguments(tree.arguments.size());
+    vector<glm::vec4> vectors;
+    for (size_t i = 0; i < tree.arguments.size(); ++i)
+    {
+        const Argument& argument = tree.arguments[i];
+        CompiledArgument& compiled = arguments[i];
+        compiled.name_symbol = argument.name_symbol;
+        compiled.value_symbol = argument.value.symbol;
+        compiled.name = addString(argument.name, argument.name_symbol);
+        compiled.type = argument.value.type;
+        switch (argument.value.type)
+        {
+        case VECTOR:
+            compiled.value = (uint32_t)vectors.size();
+            vectors.push_back(argument.value.c_value);
+            break;
+        case INT:
+            memcpy(&compiled.value, &argument.value.i_value, sizeof(uint32_t));
+            break;
+        case FLOAT:
+            memcpy(&compiled.value, &argument.value.f_value, sizeof(uint32_t));
+            break;
+        default:
+            compiled.value = addString(argument.value.s_value, argument.value.symbol);
+            break;
+        }
+    }
+
+    CompiledTokenFileHeader header;
+    header.signature = compiled_signature;
+    header.version = compiled_version;
+    header.statement_count = (uint32_t)statements.size();
+    header.root_count = (uint32_t)tree.root_count;
+    header.argument_count = (uint32_t)arguments.size();
+    header.vector_count = (uint32_t)vectors.size();
+    header.string_count = (uint32_t)strings.size();
+    header.string_size = (uint32_t)string_data.size();
+
+    vector<uint8_t> output;
+    output.reserve(sizeof(CompiledTokenFileHeader) + (statements.size() * sizeof(CompiledStatement)) + (arguments.size() * sizeof(CompiledArgument))
+        + (vectors.size() * sizeof(glm::vec4)) + (strings.size() * sizeof(CompiledString)) + string_data.size());
+    auto append = [&output](const void* data, size_t size)
+    {
+        output.insert(output.end(), (const uint8_t*)data, (const uint8_t*)data + size);
+    };
+    append(&header, sizeof(CompiledTokenFileHeader));
+    append(statements.data(), statements.size() * sizeof(CompiledStatement));
+    append(arguments.data(), arguments.size() * sizeof(CompiledArgument));
+    append(vectors.data(), vectors.size() * sizeof(glm::vec4));
+    append(strings.data(), strings.size() * sizeof(CompiledString));
+    append(string_data.data(), string_data.size());
+    return output;
+}
+
+bool TokenReader::isCompiled(DataView data)
+{
+    uint32_t data_signature = 0;
+    if (data.size() < sizeof(CompiledTokenFileHeader))
+        return false;
+    memcpy(&data_signature, data.data(), sizeof(uint32_t));
+    return data_signature == compiled_signature;
+}
+
+TokenReader::SyntaxTree TokenReader::read(DataView data)
+{
+    if (isCompiled(data))
+        return loadCompiled(data);
+
+    string_view content((const char*)data.data(), data.size());
+    return extractSyntaxTree(tokenise(content), content);
+}
+
+// copies the statements and arguments straight into a SyntaxTree, checking every index so that a corrupt file
+// can't produce a tree which refers outside itself or loops (children always come after their parent)
+TokenReader::SyntaxTree TokenReader::loadCompiled(DataView data)
+{
+    CompiledTokenFileHeader header;
+    memcpy(&header, data.data(), sizeof(CompiledTokenFileHeader));
+    if (header.version != compiled_version)
+    {
+        DBG_WARNING("compiled token file was made by a different version of the engine");
+        return { };
+    }
+    size_t statements_offset = sizeof(CompiledTokenFileHeader);
+    size_t arguments_offset = statements_offset + ((size_t)header.statement_count * sizeof(CompiledStatement));
+    size_t vectors_offset = arguments_offset + ((size_t)header.argument_count * sizeof(CompiledArgument));
+    size_t strings_offset = vectors_offset + ((size_t)header.vector_count * sizeof(glm::vec4));
+    size_t string_data_offset = strings_offset + ((size_t)header.string_count * sizeof(CompiledString));
+    if (string_data_offset + header.string_size != data.size() || header.root_count > header.statement_count)
+    {
+        DBG_WARNING("compiled token file is truncated");
+        return { };
+    }
+
+    bool valid = true;
+    string_view string_data((const char*)data.data() + string_data_offset, header.string_size);
+    vector<string_view> strings(header.string_count);
+    for (size_t i = 0; i < strings.size(); ++i)
+    {
+        CompiledString compiled;
+        memcpy(&compiled, data.data() + strings_offset + (i * sizeof(CompiledString)), sizeof(CompiledString));
+        if ((size_t)compiled.offset + compiled.length > string_data.size())
+        {
+            valid = false;
+            break;
+        }
+        strings[i] = string_data.substr(compiled.offset, compiled.length);
+    }
+    auto getString = [&](uint32_t index, uint16_t symbol)
+    {
+        if (symbol >= SYMBOL_COUNT || (index != no_string && index >= strings.size()))
+        {
+            valid = false;
+            return string_view();
+        }
+        return (index == no_string) ? symbol_names[symbol] : strings[index];
+    };
+
+    SyntaxTree tree;
+    tree.root_count = header.root_count;
+    tree.arguments.resize(header.argument_count);
+    for (size_t i = 0; valid && i < tree.arguments.size(); ++i)
+    {
+        CompiledArgument compiled;
+        memcpy(&compiled, data.data() + arguments_offset + (i * sizeof(CompiledArgument)), sizeof(CompiledArgument));
+        Argument& argument = tree.arguments[i];
+        argument.name = getString(compiled.name, compiled.name_symbol);
+        argument.name_symbol = (Symbol)compiled.name_symbol;
+        switch (compiled.type)
+        {
+        case VECTOR:
+            if (compiled.value >= header.vector_count)
+            {
+                valid = false;
+                break;
+            }
+            memcpy(&argument.value.c_value, data.data() + vectors_offset + (compiled.value * sizeof(glm::vec4)), sizeof(glm::vec4));
+            break;
+        case INT:
+            memcpy(&argument.value.i_value, &compiled.value, sizeof(uint32_t));
+            break;
+        case FLOAT:
+            memcpy(&argument.value.f_value, &compiled.value, sizeof(uint32_t));
+            break;
+        case TEXT:
+        case STRING:
+        case IDENTIFIER:
+            argument.value.s_value = getString(compiled.value, compiled.value_symbol);
+            break;
+        default:
+            valid = false;
+            break;
+        }
+        argument.value.type = (TokenType)compiled.type;
+        argument.value.symbol = (Symbol)compiled.value_symbol;
+    }
+
+    // the arguments and children of each statement follow on from the previous statement's
+    size_t first_argument = 0;
+    size_t first_child = tree.root_count;
+    tree.statements.resize(header.statement_count);
+    for (size_t i = 0; valid && i < tree.statements.size(); ++i)
+    {
+        CompiledStatement compiled;
+        memcpy(&compiled, data.data() + statements_offset + (i * sizeof(CompiledStatement)), sizeof(CompiledStatement));
+        if (first_argument + compiled.argument_count > tree.arguments.size()
+            || first_child + compiled.child_count > tree.statements.size()
+            || (compiled.child_count > 0 && first_child <= i))
+        {
+            valid = false;
+            break;
+        }
+        Statement& statement = tree.statements[i];
+        statement.keyword = getString(compiled.keyword, compiled.keyword_symbol);
+        statement.keyword_symbol = (Symbol)compiled.keyword_symbol;
+        statement.identifier = getString(compiled.identifier, NO_SYMBOL);
+        statement.arguments = span<const Argument>(tree.arguments.data() + first_argument, compiled.argument_count);
+        statement.children = span<const Statement>(tree.statements.data() + first_child, compiled.child_count);
+        first_argument += compiled.argument_count;
+        first_child += compiled.child_count;
+    }
+
+    if (!valid || first_argument != tree.arguments.size() || first_child != tree.statements.size())
+    {
+        DBG_WARNING("compiled token file is corrupt");
+        return { };
+    }
+    return tree;
 }
 
-size_t TokenReader::reportError(const string err, size_t off, const string& str)
+size_t TokenReader::reportError(const string err, size_t off, string_view str)
 {
     int32_t extract_start = max(0, (int32_t)off - 16);
     int32_t extract_end = extract_start + 32;
@@ -690,7 +1111,7 @@ size_t TokenReader::reportError(const string err, size_t off, const string& str)
         if ((int32_t)find < extract_end)
             extract_end = (int32_t)find;
     }
-    string extract = str.substr(extract_start, extract_end - extract_start);
+    string_view extract = str.substr(extract_start, extract_end - extract_start);
 
     size_t ln = 0;
     size_t last = 0;
@@ -1,15 +1,65 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
+#include <span>
+#include <array>
 #include <glm/vec4.hpp>
-#include <map>
+#include <initializer_list>
 
 #include "common.h"
+#include "package.h"
 
 namespace HopEngine
 {
 
+// compiled token files are this header, followed by statement_count CompiledStatements (in the same order as the
+// statements in a SyntaxTree), argument_count CompiledArguments, vector_count vectors of 4 floats, string_count
+// CompiledStrings, and string_size bytes of strings. each statement's arguments and children follow on from the
+// previous statement's, so only the counts are stored. strings are indices into the CompiledStrings, and words
+// which are symbols aren't stored at all
+struct CompiledTokenFileHeader
+{
+    uint32_t signature;
+    uint32_t version;
+    uint32_t statement_count;
+    uint32_t root_count;
+    uint32_t argument_count;
+    uint32_t vector_count;
+    uint32_t string_count;
+    uint32_t string_size;
+};
+
+struct CompiledStatement
+{
+    uint16_t keyword_symbol;
+    uint16_t reserved;
+    uint32_t keyword;
+    uint32_t identifier;
+    uint32_t argument_count;
+    uint32_t child_count;
+};
+
+struct CompiledArgument
+{
+    uint16_t name_symbol;
+    uint16_t value_symbol;
+    uint32_t name;
+    uint32_t type;
+    // the bits of an INT or FLOAT, or the index of a string or vector
+    uint32_t value;
+};
+
+struct CompiledString
+{
+    uint32_t offset;
+    uint32_t length;
+};
+
+struct StatementSchema;
+struct StatementArguments;
+
 class TokenReader
 {
 public:
@@ -36,16 +86,116 @@ public:
         WHITESPACE
     };
 
+    // words which mean something to the engine. they're looked up once when a file is read, so that readers
+    // compare integers rather than strings. compiled files store these, so changing the list means changing
+    // compiled_version too
+    enum Symbol : uint16_t
+    {
+        NO_SYMBOL,
+
+        // statement keywords
+        KEYWORD_RESOURCE,
+        KEYWORD_DEPTH,
+        KEYWORD_CULLING,
+        KEYWORD_POLYGON,
+        KEYWORD_SHADER,
+        KEYWORD_UNIFORM,
+        KEYWORD_TEXTURE,
+        KEYWORD_VEC4,
+        KEYWORD_FLOAT,
+        KEYWORD_NODE,
+        KEYWORD_MESH_NODE,
+        KEYWORD_LIGHT_NODE,
+        KEYWORD_GIZMO_NODE,
+        KEYWORD_FLY_CAMERA_NODE,
+        KEYWORD_TEXT_NODE,
+
+        // argument names
+        ARGUMENT_OPERATION,
+        ARGUMENT_TEST,
+        ARGUMENT_WRITE,
+        ARGUMENT_MODE,
+        ARGUMENT_RESOURCE,
+        ARGUMENT_BINDING,
+        ARGUMENT_FILTER,
+        ARGUMENT_ADDRESS,
+        ARGUMENT_DATA,
+        ARGUMENT_MATERIAL,
+        ARGUMENT_POSITION,
+        ARGUMENT_ROTATION,
+        ARGUMENT_SCALE,
+        ARGUMENT_COLOUR,
+        ARGUMENT_DIRECTIONAL,
+        ARGUMENT_HALF_ANGLE,
+        ARGUMENT_BRIGHTNESS,
+        ARGUMENT_TEXT,
+        ARGUMENT_LINE_WIDTH,
+        ARGUMENT_TEXT_COLOUR,
+
+        // values of TEXT arguments
+        VALUE_SHADER,
+        VALUE_TEXTURE,
+        VALUE_MESH,
+        VALUE_MATERIAL,
+        VALUE_ALWAYS,
+        VALUE_EQUAL,
+        VALUE_GREATER,
+        VALUE_GREATER_EQUAL,
+        VALUE_LESS,
+        VALUE_LESS_EQUAL,
+        VALUE_NEVER,
+        VALUE_NOT_EQUAL,
+        VALUE_TRUE,
+        VALUE_FALSE,
+        VALUE_NONE,
+        VALUE_FRONT,
+        VALUE_BACK,
+        VALUE_FILL,
+        VALUE_LINE,
+        VALUE_POINT,
+        VALUE_LINEAR,
+        VALUE_NEAREST,
+        VALUE_REPEAT,
+        VALUE_MIRROR,
+        VALUE_CLAMP,
+
+        SYMBOL_COUNT
+    };
+
+    // the text of each symbol, in the same order
+    static constexpr std::string_view symbol_names[] =
+    {
+        "",
+
+        "Resource", "Depth", "Culling", "Polygon", "Shader", "Uniform", "Texture", "vec4", "float",
+        "Node", "MeshNode", "LightNode", "GizmoNode", "FlyCameraNode", "TextNode",
+
+        "operation", "test", "write", "mode", "resource", "binding", "filter", "address",
+        "data", "material", "position", "rotation", "scale", "colour", "directional", "half_angle", "brightness", "text", "line_width", "text_colour",
+
+        "shader", "texture", "mesh", "material",
+        "ALWAYS", "EQUAL", "GREATER", "GREATER_EQUAL", "LESS", "LESS_EQUAL", "NEVER", "NOT_EQUAL",
+        "TRUE", "FALSE",
+        "NONE", "FRONT", "BACK",
+        "FILL", "LINE", "POINT",
+        "LINEAR", "NEAREST",
+        "REPEAT", "MIRROR", "CLAMP"
+    };
+    static_assert(std::size(symbol_names) == SYMBOL_COUNT);
+
     struct Token
     {
         TokenType type = VECTOR;
+        // for TEXT tokens in arguments, which value this is
+        Symbol symbol = NO_SYMBOL;
+        // which value is valid depends on type. s_value refers into the tokenised content
         union
         {
             glm::vec4 c_value = { 0, 0, 0, 0 };
             int i_value;
             float f_value;
+            std::string_view s_value;
         };
-        std::string s_value = "";
         size_t start_offset = 0;
 
         inline Token()
@@ -58,114 +208,72 @@ public:
         {
             type = ttype;
         }
+    };
 
-        inline Token(const Token& other)
-        {
-            type = other.type;
-            start_offset = other.start_offset;
-
-            switch (type)
-            {
-            case TEXT:
-            case STRING:
-            case IDENTIFIER:
-            case COMMENT:
-                s_value = other.s_value;
-                break;
-            case VECTOR:
-                c_value = other.c_value;
-                break;
-            case INT:
-                i_value = other.i_value;
-                break;
-            case FLOAT:
-                f_value = other.f_value;
-                break;
-            default:
-                break;
-            }
-        }
-
-        inline Token operator=(const Token& other)
-        {
-            type = other.type;
-            start_offset = other.start_offset;
-
-            switch (type)
-            {
-            case IDENTIFIER:
-            case TEXT:
-            case STRING:
-            case COMMENT:
-                s_value = other.s_value;
-                break;
-            case VECTOR:
-                c_value = other.c_value;
-                break;
-            case INT:
-                i_value = other.i_value;
-                break;
-            case FLOAT:
-                f_value = other.f_value;
-                break;
-            default:
-                break;
-            }
-
-            return *this;
-        }
-
-        inline Token operator=(Token&& other) noexcept
-        {
-            type = other.type;
-            start_offset = other.start_offset;
-
-            switch (type)
-            {
-            case IDENTIFIER:
-            case TEXT:
-            case STRING:
-            case COMMENT:
-                s_value = other.s_value;
-                break;
-            case VECTOR:
-                c_value = other.c_value;
-                break;
-            case INT:
-                i_value = other.i_value;
-                break;
-            case FLOAT:
-                f_value = other.f_value;
-                break;
-            default:
-                break;
-            }
-
-            return *this;
-        }
+    // anonymous arguments have an empty name
+    struct Argument
+    {
+        std::string_view name;
+        Symbol name_symbol = NO_SYMBOL;
+        Token value;
     };
 
+    // statements refer into the SyntaxTree they belong to, and into the tokenised content
     struct Statement
     {
-        std::string keyword;
-        std::string identifier;
-        std::vector<std::pair<std::string, Token>> arguments;
-        std::vector<Statement> children;
+        std::string_view keyword;
+        Symbol keyword_symbol = NO_SYMBOL;
+        std::string_view identifier;
+        std::span<const Argument> arguments;
+        std::span<const Statement> children;
+    };
+
+    // every statement in a file sits in one array, top level statements first and the children of each statement
+    // next to each other, and every argument sits in another. iterating over the tree gives the top level statements
+    class SyntaxTree
+    {
+        friend class TokenReader;
+    public:
+        SyntaxTree() = default;
+        SyntaxTree(SyntaxTree&& other) = default;
+        SyntaxTree& operator=(SyntaxTree&& other) = default;
+        SyntaxTree(const SyntaxTree& other) = delete;
+        SyntaxTree& operator=(const SyntaxTree& other) = delete;
+
+        inline bool empty() const { return root_count == 0; }
+        inline size_t size() const { return root_count; }
+        inline std::vector<Statement>::const_iterator begin() const { return statements.begin(); }
+        inline std::vector<Statement>::const_iterator end() const { return statements.begin() + root_count; }
+
+    private:
+        std::vector<Statement> statements;
+        std::vector<Argument> arguments;
+        size_t root_count = 0;
     };
 
 public:
     DELETE_CONSTRUCTORS(TokenReader);
 
-    static std::vector<Token> tokenise(const std::string& content, bool trim_comments = true, bool trim_whitespace = true);
-    static size_t findClosingBrace(const std::vector<Token>& tokens, size_t open_index, const std::string& original_content);
-    static std::vector<Statement> extractSyntaxTree(const std::vector<Token>& tokens, const std::string& original_content);
+    static std::vector<Token> tokenise(std::string_view content, bool trim_comments = true, bool trim_whitespace = true);
+    static SyntaxTree extractSyntaxTree(const std::vector<Token>& tokens, std::string_view original_content);
+
+    static constexpr uint32_t compiled_signature = 0xC0DEF11E;
+    static constexpr uint32_t compiled_version = 1;
+    // string index for empty strings and symbols
+    static constexpr uint32_t no_string = 0xFFFFFFFF;
+
+    // package-builder compiles .hmat and .hscn files, so that loading them needs no text processing
+    static std::vector<uint8_t> compile(const SyntaxTree& tree);
+    static bool isCompiled(DataView data);
+    // reads a compiled or text token file. the tree refers into data, so data has to outlive it
+    static SyntaxTree read(DataView data);
 
-    static bool readStatement(const Statement& statement, bool children_allowed, bool requires_identifier, const std::vector<TokenType> expected_args, std::vector<Token>& extracted_args, std::string error_base);
-    static bool readStatement(const Statement& statement, bool children_allowed, bool requires_identifier, const std::map<std::string, std::pair<TokenType, bool>> expected_args, std::map<std::string, Token>& extracted_args, std::string error_base);
+    // checks a statement against a schema, and finds its arguments. reports what's wrong (after error_base) if it doesn't match
+    static bool readStatement(const Statement& statement, const StatementSchema& schema, StatementArguments& arguments, std::string_view error_base);
     static bool checkNamedArgs(const Statement& statement, bool named);
 
 private:
-    static inline bool isAlphabetic(const char c)
+    static constexpr bool isAlphabetic(const char c)
     {
         if (c >= 'a' && c <= 'z') return true;
         if (c >= 'A' && c <= 'Z') return true;
@@ -189,7 +297,7 @@ private:
         }
     }
 
-    static inline TokenType getType(const char c)
+    static constexpr TokenType getType(const char c)
     {
         if (isAlphabetic(c)) return TEXT;
         if (c == '-' || (c >= '0' && c <= '9')) return INT;
@@ -201,7 +309,6 @@ private:
         case '{': return OPEN_CURLY;
         case '}': return CLOSE_CURLY;
         case '\"': return STRING;
-        case '\r':
         case '\n':
             return NEWLINE;
         case ':': return COLON;
@@ -214,11 +321,40 @@ private:
         case ';': return SEMICOLON;
         case ' ':
         case '\t':
+        case '\r':
             return WHITESPACE;
         }
         return INVALID;
     }
 
+    // getType for every byte, so the tokeniser does one lookup per character
+    static const std::array<TokenType, 256> char_types;
+
+    // whether a character leaves a token of this type as it is, so that a run of them can be skipped without
+    // looking at each one. skipRun does the same test many characters at a time where it can
+    static inline bool continuesRun(TokenType type, const char c)
+    {
+        TokenType char_type = char_types[(uint8_t)c];
+        switch (type)
+        {
+        case WHITESPACE:
+            return char_type == WHITESPACE;
+        case STRING:
+            return char_type != STRING && char_type != END_VECTOR;
+        case COMMENT:
+            return char_type != NEWLINE && char_type != INVALID && char_type != END_VECTOR;
+        case VECTOR:
+            return char_type == WHITESPACE || char_type == INT || char_type == FLOAT || char_type == COMMA;
+        case TEXT:
+        case IDENTIFIER:
+            return char_type == TEXT || char_type == INT;
+        default:
+            return false;
+        }
+    }
+
+    static size_t skipRun(std::string_view content, size_t offset, TokenType type);
+
     static inline std::string typeToString(TokenType t)
     {
         switch (t)
@@ -240,10 +376,90 @@ private:
         }
     }
 
-    static glm::vec4 deserialiseVectorToken(std::string str, size_t offset, const std::string& original_content);
-    static std::vector<std::pair<std::string, HopEngine::TokenReader::Token>> parseArguments(std::vector<Token>::const_iterator start, std::vector<Token>::const_iterator end, std::string original_content);
+    static glm::vec4 deserialiseVectorToken(std::string_view str, size_t offset, std::string_view original_content);
+    struct StatementLayout
+    {
+        size_t first_argument = 0;
+        size_t argument_count = 0;
+        size_t first_child = 0;
+        size_t child_count = 0;
+        size_t children_start = 0;
+        size_t children_end = 0;
+    };
+
+    static bool matchBrackets(const std::vector<Token>& tokens, std::vector<size_t>& closing, std::string_view original_content);
+    static bool parseBlock(const std::vector<Token>& tokens, size_t start, size_t end, const std::vector<size_t>& closing, std::string_view original_content, SyntaxTree& tree, std::vector<StatementLayout>& layouts);
+    static bool parseArguments(const std::vector<Token>& tokens, size_t start, size_t end, std::string_view original_content, std::vector<Argument>& arguments);
+
+    static SyntaxTree loadCompiled(DataView data);
+    static Symbol findKeyword(std::string_view word);
+    static Symbol findArgumentName(std::string_view word);
+    static Symbol findValue(std::string_view word);
+
+    static size_t reportError(const std::string err, size_t off, std::string_view str);
+};
+
+// what a statement may contain. schemas are built at compile time, so reading a statement against one allocates nothing
+struct ArgumentSchema
+{
+    TokenReader::Symbol name = TokenReader::NO_SYMBOL;
+    TokenReader::TokenType type = TokenReader::TEXT;
+    bool required = true;
+};
+
+struct StatementSchema
+{
+    static constexpr size_t max_arguments = 8;
+
+    bool children_allowed = false;
+    bool requires_identifier = false;
+    // named statements take any of their arguments by name, in any order. the rest take all of them, in order, without names
+    bool named = false;
+    size_t argument_count = 0;
+    std::array<ArgumentSchema, max_arguments> arguments = { };
+    // where each argument name is in arguments (or -1), so that an argument is matched with one lookup
+    std::array<int8_t, TokenReader::SYMBOL_COUNT> slots = { };
+
+    constexpr StatementSchema(bool children_allowed, bool requires_identifier, bool named, std::initializer_list<ArgumentSchema> schema_arguments)
+        : children_allowed(children_allowed), requires_identifier(requires_identifier), named(named), argument_count(schema_arguments.size())
+    {
+        slots.fill(-1);
+        size_t index = 0;
+        for (const ArgumentSchema& argument : schema_arguments)
+        {
+            arguments[index] = argument;
+            if (argument.name != TokenReader::NO_SYMBOL)
+                slots[argument.name] = (int8_t)index;
+            ++index;
+        }
+    }
+};
+
+// the arguments found by readStatement, which refer into the syntax tree
+struct StatementArguments
+{
+    const StatementSchema* schema = nullptr;
+    std::array<const TokenReader::Token*, StatementSchema::max_arguments> values = { };
+
+    // by position, for statements which aren't named
+    inline const TokenReader::Token& operator[](size_t index) const
+    {
+        return *values[index];
+    }
 
-    static size_t reportError(const std::string err, size_t off, const std::string& str);
+    // by name, or nullptr if the argument was left out
+    inline const TokenReader::Token* find(TokenReader::Symbol name) const
+    {
+        int8_t slot = schema->slots[name];
+        return (slot < 0) ? nullptr : values[slot];
+    }
 };
 
+// Resource(type, "path") : identifier, which materials and scenes both use
+inline constexpr StatementSchema RESOURCE_STATEMENT(false, true, false,
+{
+    { TokenReader::NO_SYMBOL, TokenReader::TEXT },
+    { TokenReader::NO_SYMBOL, TokenReader::STRING }
+});
+
 }
@@ -6,6 +6,7 @@
 #include "buffer.h"
 #include "texture.h"
 #include "sampler.h"
+#include "resource_streamer.h"
 
 using namespace HopEngine;
 using namespace std;
@@ -68,12 +69,16 @@ void UniformBlock::setSampler(uint32_t binding, Ref<Sampler> sampler)
 
 void UniformBlock::pushToDescriptorSet(size_t index)
 {
+    // streamed textures have been uploaded into images which replaced the ones the descriptors point at
+    if (resource_generation != ResourceStreamer::getGeneration())
+        applyDescriptorBindings();
     memcpy(uniform_buffers[index]->mapMemory(), live_uniform_buffer.data(), live_uniform_buffer.size());
 }
 
 void UniformBlock::applyDescriptorBindings()
 {
     DBG_VERBOSE("uniform block " + PTR(this) + " updating " + to_string(layout.bindings.size()) + " descriptor bindings");
+    resource_generation = ResourceStreamer::getGeneration();
     for (size_t i = 0; i < descriptor_sets.size(); ++i)
     {
         VkDeviceSize offset = 0;
@@ -19,6 +19,7 @@ private:
 	std::vector<uint8_t> live_uniform_buffer;
 	VkDeviceSize size;
 	ShaderLayout layout;
+	uint64_t resource_generation = 0;
 
 public:
 	DELETE_CONSTRUCTORS(UniformBlock);